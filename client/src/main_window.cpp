@@ -20,11 +20,13 @@
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent), networkThread(new QThread(this)), worker(new NetworkWorker()), 
       requestSuccessful(false), loadingFormats(false) {
+    qRegisterMetaType<BlobCompressJob>();
     worker->moveToThread(networkThread);
     connect(networkThread, &QThread::finished, worker, &QObject::deleteLater);
     connect(this, &MainWindow::destroyed, networkThread, &QThread::quit);
     connect(this, &MainWindow::sendNetworkRequest, worker, &NetworkWorker::processRequest);
     connect(this, &MainWindow::sendMultipartRequest, worker, &NetworkWorker::processMultipartRequest);
+    connect(this, &MainWindow::sendBlobCompressRequest, worker, &NetworkWorker::processBlobCompressRequest);
     connect(this, &MainWindow::cancelNetworkRequest, worker, &NetworkWorker::cancelRequest);
     connect(worker, &NetworkWorker::dataReceived, this, &MainWindow::onDataReceived);
     connect(worker, &NetworkWorker::finished, this, &MainWindow::onRequestFinished);
@@ -107,7 +109,7 @@ void MainWindow::setupCompressTab() {
     archiveLayout->addWidget(new QLabel("Формат:"), 1, 0);
     formatComboBox = new QComboBox(archiveGroup);
     formatComboBox->setObjectName("formatComboBox");
-    formatComboBox->addItems({"zip", "tar.gz", "tar.bz2", "7z"});
+    formatComboBox->addItems({"zip", "tar.gz", "tar.bz2", "7z", "tar.zst", "tar.xz"});
     archiveLayout->addWidget(formatComboBox, 1, 1);
 
     layout->addWidget(archiveGroup);
@@ -236,6 +238,30 @@ QHttpMultiPart* MainWindow::createCompressMultipart() const {
     return multipart;
 }
 
+BlobCompressJob MainWindow::createBlobCompressJob() const {
+    BlobCompressJob job;
+    job.url = QUrl("http://localhost:8080/archive/compress");
+    job.fields.append({"operation", "compress"});
+    job.fields.append({"format", formatComboBox->currentText().toUtf8()});
+    job.fields.append({"archive_name", archiveNameEdit->text().toUtf8()});
+
+    for (int i = 0; i < filesList->count(); ++i) {
+        QListWidgetItem *item = filesList->item(i);
+        QString filePath = item->data(Qt::UserRole).toString();
+        QFileInfo fileInfo(filePath);
+
+        if (fileInfo.isFile()) {
+            BlobEntry entry;
+            entry.name = item->text();
+            entry.path = filePath;
+            entry.size = fileInfo.size();
+            job.entries.append(entry);
+        }
+    }
+
+    return job;
+}
+
 QByteArray MainWindow::createExtractData() const {
     QString archiveFile = archiveFileEdit->text();
     QFile file(archiveFile);
@@ -263,7 +289,7 @@ void MainWindow::browseDirectories() {
 
 void MainWindow::browseArchiveFile() {
     QString file = QFileDialog::getOpenFileName(this, "Выберите архивный файл", 
-        "", "Archives (*.zip *.tar.gz *.tar.bz2 *.7z)");
+        "", "Archives (*.zip *.tar.gz *.tar.bz2 *.7z *.tar.zst *.tar.xz)");
     if (!file.isEmpty()) {
         archiveFileEdit->setText(file);
     }
@@ -317,12 +343,9 @@ void MainWindow::sendCompressRequest() {
         return;
     }
 
-    QHttpMultiPart *multipart = createCompressMultipart();
-    QNetworkRequest request(QUrl("http://localhost:8080/archive/compress"));
-
     responseData.clear();
     requestSuccessful = false;
-    emit sendMultipartRequest(request, multipart);
+    emit sendBlobCompressRequest(createBlobCompressJob());
 
     compressButton->setText("Создание архива...");
     compressButton->setEnabled(false);
@@ -463,6 +486,9 @@ void MainWindow::onFormatsReceived(const QByteArray &data) {
         QJsonDocument doc = QJsonDocument::fromJson(data);
         QJsonObject obj = doc.object();
         QJsonArray formats = obj["supported_formats"].toArray();
+        if (formats.isEmpty()) {
+            return;
+        }
         
         formatComboBox->clear();
         for (const QJsonValue& format : formats) {
@@ -33,6 +33,7 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
     QHttpMultiPart* createCompressMultipart() const;
+    BlobCompressJob createBlobCompressJob() const;
     QByteArray createExtractData() const;
 
 protected:
@@ -60,6 +61,7 @@ protected:
     signals:
         void sendNetworkRequest(const QNetworkRequest &request, const QByteArray &data);
         void sendMultipartRequest(const QNetworkRequest &request, QHttpMultiPart *multipart);
+        void sendBlobCompressRequest(const BlobCompressJob &job);
     void cancelNetworkRequest();
 
     private slots:
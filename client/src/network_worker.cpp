@@ -1,6 +1,16 @@
 #include "network_worker.h"
+#include <QCryptographicHash>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 
-NetworkWorker::NetworkWorker(QObject *parent) : QObject(parent), m_currentMultipart(nullptr) {
+namespace {
+const char *kBlobReferenceType = "application/vnd.archiver.blob-ref";
+}
+
+NetworkWorker::NetworkWorker(QObject *parent)
+    : QObject(parent), m_currentMultipart(nullptr), m_blobRetryPending(false) {
     m_qnam.reset(new QNetworkAccessManager(this));
 }
 
@@ -40,6 +50,119 @@ void NetworkWorker::processMultipartRequest(const QNetworkRequest &request, QHtt
     connect(m_reply.get(), &QNetworkReply::finished, this, &NetworkWorker::onFinished);
 }
 
+void NetworkWorker::processBlobCompressRequest(const BlobCompressJob &job) {
+    m_blobJob = job;
+    m_blobRetryPending = false;
+
+    for (BlobEntry &entry : m_blobJob.entries) {
+        if (entry.digest.isEmpty()) {
+            entry.digest = blobDigest(entry.path);
+        }
+    }
+
+    QNetworkRequest request(m_blobJob.url.resolved(QUrl("/blobs/missing")));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "text/plain");
+
+    m_reply.reset();
+    m_reply.reset(m_qnam->post(request, createManifest(m_blobJob.entries)));
+    connect(m_reply.get(), &QNetworkReply::finished, this, &NetworkWorker::onManifestFinished);
+}
+
+void NetworkWorker::onManifestFinished() {
+    if (m_reply->error() == QNetworkReply::OperationCanceledError) {
+        emit finished();
+        return;
+    }
+
+    bool useReferences = m_reply->error() == QNetworkReply::NoError;
+    QSet<QString> missing;
+    if (useReferences) {
+        QJsonArray digests = QJsonDocument::fromJson(m_reply->readAll()).object()["missing"].toArray();
+        for (const QJsonValue &digest : digests) {
+            missing.insert(digest.toString());
+        }
+    }
+
+    m_reply.take()->deleteLater();
+    sendBlobUpload(useReferences, missing);
+}
+
+void NetworkWorker::sendBlobUpload(bool useReferences, const QSet<QString> &missing) {
+    m_blobRetryPending = useReferences;
+    processMultipartRequest(QNetworkRequest(m_blobJob.url),
+                            createBlobMultipart(m_blobJob, useReferences, missing));
+}
+
+bool NetworkWorker::isBlobConflict() const {
+    return m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 409;
+}
+
+QString NetworkWorker::blobDigest(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    if (!hash.addData(&file)) {
+        return QString();
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+QByteArray NetworkWorker::createManifest(const QList<BlobEntry> &entries) {
+    QByteArray manifest;
+    for (const BlobEntry &entry : entries) {
+        if (entry.digest.isEmpty()) {
+            continue;
+        }
+        manifest += entry.digest.toUtf8() + ' ' + QByteArray::number(entry.size) + ' ' +
+                    entry.name.toUtf8() + '\n';
+    }
+    return manifest;
+}
+
+QHttpMultiPart *NetworkWorker::createBlobMultipart(const BlobCompressJob &job, bool useReferences,
+                                                   const QSet<QString> &missing) {
+    QHttpMultiPart *multipart = new QHttpMultiPart(QHttpMultiPart::FormDataType);
+
+    for (const auto &field : job.fields) {
+        QHttpPart part;
+        part.setHeader(QNetworkRequest::ContentDispositionHeader,
+                       QVariant(QString("form-data; name=\"%1\"").arg(field.first)));
+        part.setBody(field.second);
+        multipart->append(part);
+    }
+
+    QHttpPart storePart;
+    storePart.setHeader(QNetworkRequest::ContentDispositionHeader,
+                        QVariant("form-data; name=\"store_blobs\""));
+    storePart.setBody("true");
+    multipart->append(storePart);
+
+    for (const BlobEntry &entry : job.entries) {
+        QHttpPart filePart;
+        filePart.setHeader(QNetworkRequest::ContentDispositionHeader,
+                           QVariant(QString("form-data; name=\"file\"; filename=\"%1\"").arg(entry.name)));
+
+        if (useReferences && !entry.digest.isEmpty() && !missing.contains(entry.digest)) {
+            filePart.setHeader(QNetworkRequest::ContentTypeHeader, QVariant(kBlobReferenceType));
+            filePart.setBody(entry.digest.toUtf8());
+        } else {
+            QFile *file = new QFile(entry.path, multipart);
+            if (!file->open(QIODevice::ReadOnly)) {
+                delete file;
+                continue;
+            }
+            filePart.setHeader(QNetworkRequest::ContentTypeHeader, QVariant("application/octet-stream"));
+            filePart.setBodyDevice(file);
+        }
+        multipart->append(filePart);
+    }
+
+    return multipart;
+}
+
 void NetworkWorker::cancelRequest() {
     if (m_reply) {
         m_reply->abort();
@@ -52,6 +175,9 @@ void NetworkWorker::cancelRequest() {
 }
 
 void NetworkWorker::onReadyRead() {
+    if (m_blobRetryPending && isBlobConflict()) {
+        return;
+    }
     emit dataReceived(m_reply->readAll());
 }
 
@@ -60,6 +186,17 @@ void NetworkWorker::onFinished() {
         emit finished();
         return;
     }
+    if (m_blobRetryPending && isBlobConflict()) {
+        QNetworkReply *reply = m_reply.take();
+        if (m_currentMultipart) {
+            m_currentMultipart->setParent(reply);
+            m_currentMultipart = nullptr;
+        }
+        reply->deleteLater();
+        sendBlobUpload(false, QSet<QString>());
+        return;
+    }
+    m_blobRetryPending = false;
     if (m_reply->error() != QNetworkReply::NoError) {
         emit errorOccurred(m_reply->errorString());
     }
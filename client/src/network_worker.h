@@ -5,6 +5,23 @@
 #include <QNetworkReply>
 #include <QScopedPointer>
 #include <QHttpMultiPart>
+#include <QSet>
+#include <QUrl>
+
+struct BlobEntry {
+    QString name;
+    QString path;
+    QString digest;
+    qint64 size = 0;
+};
+
+struct BlobCompressJob {
+    QUrl url;
+    QList<QPair<QString, QByteArray>> fields;
+    QList<BlobEntry> entries;
+};
+
+Q_DECLARE_METATYPE(BlobCompressJob)
 
 class NetworkWorker : public QObject {
     Q_OBJECT
@@ -13,9 +30,15 @@ public:
     NetworkWorker(QObject *parent = nullptr);
     ~NetworkWorker();
 
+    static QString blobDigest(const QString &path);
+    static QByteArray createManifest(const QList<BlobEntry> &entries);
+    static QHttpMultiPart *createBlobMultipart(const BlobCompressJob &job, bool useReferences,
+                                               const QSet<QString> &missing);
+
     public slots:
         void processRequest(const QNetworkRequest &request, const QByteArray &data = QByteArray());
         void processMultipartRequest(const QNetworkRequest &request, QHttpMultiPart *multipart);
+        void processBlobCompressRequest(const BlobCompressJob &job);
     void cancelRequest();
 
     signals:
@@ -26,9 +49,15 @@ public:
     private slots:
         void onReadyRead();
     void onFinished();
+    void onManifestFinished();
 
 private:
     QScopedPointer<QNetworkAccessManager, QScopedPointerDeleter<QNetworkAccessManager>> m_qnam;
     QScopedPointer<QNetworkReply, QScopedPointerDeleter<QNetworkReply>> m_reply;
     QHttpMultiPart *m_currentMultipart;
+    BlobCompressJob m_blobJob;
+    bool m_blobRetryPending;
+
+    void sendBlobUpload(bool useReferences, const QSet<QString> &missing);
+    bool isBlobConflict() const;
 };
\ No newline at end of file
@@ -263,8 +263,12 @@ private slots:
         
         QVERIFY(items.contains("zip"));
         QVERIFY(items.contains("tar.gz") || items.contains("tar.bz2") || items.contains("7z"));
+        QVERIFY(items.contains("tar.xz"));
         
         w.setLoadingFormats(true);
+        w.testOnDataReceived("not json");
+        QCOMPARE(formatComboBox->count(), items.size());
+        
         QByteArray formatsResponse = R"({"supported_formats": ["zip", "tar.gz", "tar.bz2", "7z"]})";
         w.testOnDataReceived(formatsResponse);
         w.testOnRequestFinished();
@@ -435,6 +439,47 @@ private slots:
         QCOMPARE(files.size(), 0);
     }
 
+    void testCreateBlobCompressJob() {
+        TestMainWindow w;
+
+        QLineEdit *archiveNameEdit = w.findChild<QLineEdit*>("archiveNameEdit");
+        QListWidget *filesList = w.findChild<QListWidget*>("filesList");
+        archiveNameEdit->setText("blobs.zip");
+
+        QTemporaryFile tempFile;
+        tempFile.open();
+        tempFile.write("Hello, World!");
+        tempFile.close();
+
+        QListWidgetItem *item = new QListWidgetItem("dir/hello.txt");
+        item->setData(Qt::UserRole, tempFile.fileName());
+        filesList->addItem(item);
+
+        BlobCompressJob job = w.createBlobCompressJob();
+        QCOMPARE(job.url.path(), QString("/archive/compress"));
+        QVERIFY(job.fields.contains(QPair<QString, QByteArray>("archive_name", "blobs.zip")));
+        QCOMPARE(job.entries.size(), 1);
+        QCOMPARE(job.entries[0].name, QString("dir/hello.txt"));
+        QCOMPARE(job.entries[0].size, qint64(13));
+    }
+
+    void testBlobDigestAndManifest() {
+        QTemporaryFile tempFile;
+        tempFile.open();
+        tempFile.write("Hello, World!");
+        tempFile.close();
+
+        BlobEntry entry;
+        entry.name = "hello.txt";
+        entry.path = tempFile.fileName();
+        entry.size = 13;
+        entry.digest = NetworkWorker::blobDigest(entry.path);
+
+        QCOMPARE(entry.digest, QString("dffd6021bb2bd5b0af676290809ec3a53191dd81c7f70a4b28688a362182986f"));
+        QCOMPARE(NetworkWorker::createManifest({entry}),
+                 QByteArray("dffd6021bb2bd5b0af676290809ec3a53191dd81c7f70a4b28688a362182986f 13 hello.txt\n"));
+    }
+
 private:
     QApplication *app = nullptr;
 };
@@ -0,0 +1,238 @@
+#include "appender.h"
+#include "../memory/memory_budget.h"
+#include "../store/archive_store.h"
+#include "../zip/zip_writer.h"
+#include <stdexcept>
+#include <unordered_set>
+#include <zlib.h>
+
+namespace {
+const int kGzipWindowBits = MAX_WBITS + 16;
+
+// Room a gzip member of size bytes can need, header and trailer included.
+size_t memberBound(size_t size) { return compressBound(size) + 18; }
+
+// Compresses data onto the end of output, whose capacity the caller sized
+// with memberBound so the prefix before it is not copied again.
+void deflateStream(z_stream &stream, const std::vector<uint8_t> &data,
+                   std::vector<uint8_t> &output) {
+  size_t start = output.size();
+  output.resize(start + deflateBound(&stream, data.size()) + 1);
+  stream.next_in = const_cast<Bytef *>(data.data());
+  stream.avail_in = data.size();
+  stream.next_out = output.data() + start;
+  stream.avail_out = output.size() - start;
+
+  int result = deflate(&stream, Z_FINISH);
+  output.resize(start + stream.total_out);
+  deflateEnd(&stream);
+
+  if (result != Z_STREAM_END) {
+    throw std::runtime_error("Failed to compress gzip member");
+  }
+}
+
+void gzipMember(const std::vector<uint8_t> &data,
+                std::vector<uint8_t> &output) {
+  z_stream stream{};
+  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                   kGzipWindowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    throw std::runtime_error("Failed to initialize gzip stream");
+  }
+  deflateStream(stream, data, output);
+}
+
+// Resumes a member's deflate stream at an access point: the bits of the
+// partial byte before it are re-emitted and its window becomes the dictionary.
+void continueMember(const GzipIndex::AccessPoint &point, uint64_t history,
+                    const uint8_t *data, const std::vector<uint8_t> &input,
+                    std::vector<uint8_t> &output) {
+  z_stream stream{};
+  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    throw std::runtime_error("Failed to initialize deflate stream");
+  }
+
+  size_t dictionary = std::min<uint64_t>(history, point.window.size());
+  if (dictionary > 0) {
+    deflateSetDictionary(&stream,
+                         point.window.data() + point.window.size() - dictionary,
+                         dictionary);
+  }
+  if (point.bits) {
+    int kept = 8 - point.bits;
+    deflatePrime(&stream, kept, data[point.in - 1] & ((1 << kept) - 1));
+  }
+  deflateStream(stream, input, output);
+}
+
+void append32(std::vector<uint8_t> &output, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    output.push_back((value >> (8 * i)) & 0xff);
+  }
+}
+
+la_ssize_t appendOutput(struct archive *, void *client, const void *buffer,
+                        size_t length) {
+  auto *output = static_cast<std::vector<uint8_t> *>(client);
+  const auto *bytes = static_cast<const uint8_t *>(buffer);
+  output->insert(output->end(), bytes, bytes + length);
+  return length;
+}
+} // namespace
+
+Appender::Appender(const StoredArchive &archive, time_t mtime,
+                   MemoryAccount *memory)
+    : archive_(archive), mtime_(mtime), memory_(memory) {
+  if (!supportsFormat(archive.getFormat())) {
+    throw std::runtime_error("Append requires a zip or tar.gz archive");
+  }
+}
+
+bool Appender::supportsFormat(CompressionFormat format) {
+  return format == CompressionFormat::ZIP ||
+         format == CompressionFormat::TAR_GZ;
+}
+
+std::vector<uint8_t> Appender::append(const std::vector<FileEntry> &files) {
+  if (files.empty()) {
+    throw std::runtime_error("No files specified for append");
+  }
+  checkNames(files);
+
+  std::vector<uint8_t> output = archive_.getFormat() == CompressionFormat::ZIP
+                                    ? appendZip(files)
+                                    : appendTarGz(files);
+  stats_.entries = files.size();
+  return output;
+}
+
+std::vector<uint8_t>
+Appender::appendZip(const std::vector<FileEntry> &files) {
+  const SharedBuffer &data = archive_.getData();
+  reserve(data->size());
+
+  ZipWriter writer(mtime_);
+  stats_.kept_bytes = writer.resume(data->data(), data->size());
+  for (const auto &file : files) {
+    reserve(file.data.size());
+    writer.addEntry(file.name, file.data);
+  }
+  return writer.finish();
+}
+
+std::vector<uint8_t>
+Appender::appendTarGz(const std::vector<FileEntry> &files) {
+  const SharedBuffer &data = archive_.getData();
+  const GzipIndex &index = archive_.getGzipIndex();
+  uint64_t tar_end = archive_.getTarEnd();
+  const GzipIndex::AccessPoint &point = index.pointFor(tar_end);
+
+  reserve(tar_end - point.out);
+  std::vector<uint8_t> tail =
+      index.read(data->data(), data->size(), point.out, tar_end - point.out);
+  stats_.recompressed_bytes = tail.size();
+
+  size_t trailer = 0;
+  std::vector<uint8_t> tar = writeTar(files, trailer);
+  tail.insert(tail.end(), tar.begin(), tar.end() - trailer);
+  tar.erase(tar.begin(), tar.end() - trailer);
+
+  stats_.kept_bytes = point.member_start || !point.bits ? point.in
+                                                        : point.in - 1;
+  size_t capacity = stats_.kept_bytes + memberBound(tail.size()) +
+                    memberBound(tar.size());
+  reserve(capacity);
+  std::vector<uint8_t> output;
+  output.reserve(capacity);
+  output.assign(data->begin(), data->begin() + stats_.kept_bytes);
+
+  if (point.member_start) {
+    gzipMember(tail, output);
+  } else {
+    // The member's trailer covers the kept history too; the index carries
+    // its CRC, so none of it is inflated again.
+    uint64_t history = point.out - index.memberFor(tar_end).out;
+    uLong crc = crc32_combine(point.crc, crc32(0L, tail.data(), tail.size()),
+                              tail.size());
+    continueMember(point, history, data->data(), tail, output);
+    append32(output, crc);
+    append32(output, static_cast<uint32_t>(history + tail.size()));
+  }
+  gzipMember(tar, output);
+  return output;
+}
+
+std::vector<uint8_t> Appender::writeTar(const std::vector<FileEntry> &files,
+                                        size_t &trailer) const {
+  std::vector<uint8_t> output;
+  struct archive *a = archive_write_new();
+  if (!a) {
+    throw std::runtime_error("Failed to create archive");
+  }
+
+  try {
+    archive_write_set_format_gnutar(a);
+    archive_write_add_filter_none(a);
+    archive_write_set_bytes_per_block(a, 0);
+    if (archive_write_open(a, &output, nullptr, appendOutput, nullptr) !=
+        ARCHIVE_OK) {
+      throw std::runtime_error("Failed to open archive for writing: " +
+                               std::string(archive_error_string(a)));
+    }
+
+    for (const auto &file : files) {
+      struct archive_entry *header = archive_entry_new();
+      archive_entry_set_pathname(header, file.name.c_str());
+      archive_entry_set_size(header, file.data.size());
+      archive_entry_set_mode(header, AE_IFREG | 0644);
+      archive_entry_set_mtime(header, mtime_, 0);
+
+      int status = archive_write_header(a, header);
+      archive_entry_free(header);
+      if (status != ARCHIVE_OK) {
+        throw std::runtime_error("Failed to write file header: " +
+                                 std::string(archive_error_string(a)));
+      }
+      if (!file.data.empty() &&
+          archive_write_data(a, file.data.data(), file.data.size()) < 0) {
+        throw std::runtime_error("Failed to write file data: " +
+                                 std::string(archive_error_string(a)));
+      }
+      if (archive_write_finish_entry(a) != ARCHIVE_OK) {
+        throw std::runtime_error("Failed to finish entry: " +
+                                 std::string(archive_error_string(a)));
+      }
+    }
+
+    size_t entries_end = output.size();
+    if (archive_write_close(a) != ARCHIVE_OK) {
+      throw std::runtime_error("Failed to close archive: " +
+                               std::string(archive_error_string(a)));
+    }
+    archive_write_free(a);
+    trailer = output.size() - entries_end;
+  } catch (...) {
+    archive_write_free(a);
+    throw;
+  }
+  return output;
+}
+
+void Appender::checkNames(const std::vector<FileEntry> &files) const {
+  std::unordered_set<std::string> names;
+  for (const auto &file : files) {
+    if (file.name.empty()) {
+      throw std::runtime_error("Entry name must not be empty");
+    }
+    if (archive_.find(file.name) || !names.insert(file.name).second) {
+      throw std::runtime_error("Entry already exists: " + file.name);
+    }
+  }
+}
+
+void Appender::reserve(size_t bytes) {
+  if (memory_) {
+    memory_->reserve(bytes);
+  }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "../compressor/compressor.h"
+#include <cstdint>
+#include <ctime>
+#include <vector>
+
+class MemoryAccount;
+class StoredArchive;
+
+struct AppendStats {
+  size_t entries = 0;
+  uint64_t kept_bytes = 0;
+  uint64_t recompressed_bytes = 0;
+};
+
+class Appender {
+public:
+  Appender(const StoredArchive &archive, time_t mtime,
+           MemoryAccount *memory = nullptr);
+
+  static bool supportsFormat(CompressionFormat format);
+
+  std::vector<uint8_t> append(const std::vector<FileEntry> &files);
+
+  const AppendStats &getStats() const { return stats_; }
+
+private:
+  const StoredArchive &archive_;
+  time_t mtime_;
+  MemoryAccount *memory_;
+  AppendStats stats_;
+
+  std::vector<uint8_t> appendZip(const std::vector<FileEntry> &files);
+  std::vector<uint8_t> appendTarGz(const std::vector<FileEntry> &files);
+  std::vector<uint8_t> writeTar(const std::vector<FileEntry> &files,
+                                size_t &trailer) const;
+  void checkNames(const std::vector<FileEntry> &files) const;
+  void reserve(size_t bytes);
+};
@@ -0,0 +1,31 @@
+#include "wait_list.h"
+#include <algorithm>
+
+uint64_t WaitList::getGeneration() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return generation_;
+}
+
+size_t WaitList::getWaiting() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return waiters_.size();
+}
+
+void WaitList::notifyAll() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++generation_;
+  for (auto &timer : waiters_) {
+    timer->cancel();
+  }
+}
+
+void WaitList::remove(boost::asio::steady_timer *timer) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = std::find_if(waiters_.begin(), waiters_.end(),
+                         [timer](const auto &waiter) {
+                           return waiter.get() == timer;
+                         });
+  if (it != waiters_.end()) {
+    waiters_.erase(it);
+  }
+}
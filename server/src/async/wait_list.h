@@ -0,0 +1,66 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Asynchronous waiters for a condition that other threads signal. A waiter
+// parks a timer on its own executor, so waiting never blocks a thread, and
+// notifyAll cancels the timers to resume the waiters there.
+//
+// To avoid missing a notification, read getGeneration() before checking the
+// condition and pass it to asyncWait: a wait completes at once if notifyAll
+// ran in between.
+class WaitList {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  uint64_t getGeneration() const;
+  size_t getWaiting() const;
+
+  // Completes with success once notified, or with error::timed_out at the
+  // deadline, on the handler's executor or else on executor.
+  template <typename Executor, typename CompletionToken>
+  auto asyncWait(const Executor &executor, uint64_t generation,
+                 Clock::time_point deadline, CompletionToken &&token) {
+    return boost::asio::async_initiate<CompletionToken,
+                                       void(boost::system::error_code)>(
+        [this, generation, deadline](auto handler, Executor io_executor) {
+          auto executor =
+              boost::asio::get_associated_executor(handler, io_executor);
+          std::lock_guard<std::mutex> lock(mutex_);
+          if (generation != generation_) {
+            boost::asio::post(executor,
+                              [handler = std::move(handler)]() mutable {
+                                handler(boost::system::error_code());
+                              });
+            return;
+          }
+
+          auto timer = std::make_shared<boost::asio::steady_timer>(executor);
+          timer->expires_at(deadline);
+          waiters_.push_back(timer);
+          timer->async_wait([this, timer, handler = std::move(handler)](
+                                boost::system::error_code ec) mutable {
+            remove(timer.get());
+            handler(ec == boost::asio::error::operation_aborted
+                        ? boost::system::error_code()
+                        : boost::system::error_code(
+                              boost::asio::error::timed_out));
+          });
+        },
+        token, executor);
+  }
+
+  void notifyAll();
+
+private:
+  mutable std::mutex mutex_;
+  uint64_t generation_ = 0;
+  std::vector<std::shared_ptr<boost::asio::steady_timer>> waiters_;
+
+  void remove(boost::asio::steady_timer *timer);
+};
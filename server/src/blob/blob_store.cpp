@@ -0,0 +1,171 @@
+#include "blob_store.h"
+#include "../memory/memory_budget.h"
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+std::atomic<uint64_t> temp_counter{0};
+
+std::string joinDigests(const std::vector<std::string> &digests) {
+  std::string joined;
+  for (const auto &digest : digests) {
+    joined += joined.empty() ? digest : ", " + digest;
+  }
+  return joined;
+}
+} // namespace
+
+BlobNotFound::BlobNotFound(std::vector<std::string> digests)
+    : std::runtime_error("Unknown blobs: " + joinDigests(digests)),
+      digests_(std::move(digests)) {}
+
+BlobStore::BlobStore(Config config) : config_(std::move(config)) {
+  std::error_code ec;
+  std::filesystem::create_directories(config_.directory, ec);
+
+  for (const auto &file :
+       std::filesystem::directory_iterator(config_.directory, ec)) {
+    std::string digest = file.path().filename().string();
+    if (file.is_regular_file(ec) && isValidDigest(digest)) {
+      index(digest, file.file_size(ec));
+    }
+  }
+  evict();
+}
+
+BlobStore &BlobStore::instance() {
+  static BlobStore store(Config{});
+  return store;
+}
+
+bool BlobStore::isValidDigest(const std::string &digest) {
+  if (digest.size() != 64) {
+    return false;
+  }
+  for (char c : digest) {
+    if (!std::isdigit(static_cast<unsigned char>(c)) && (c < 'a' || c > 'f')) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool BlobStore::contains(const std::string &digest) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return blobs_.count(digest) > 0;
+}
+
+std::vector<std::string>
+BlobStore::missing(const std::vector<std::string> &digests) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::vector<std::string> result;
+  for (const auto &digest : digests) {
+    if (!blobs_.count(digest)) {
+      result.push_back(digest);
+    }
+  }
+  return result;
+}
+
+void BlobStore::put(const std::string &digest,
+                    const std::vector<uint8_t> &data) {
+  if (!isValidDigest(digest)) {
+    throw std::runtime_error("Invalid blob digest: " + digest);
+  }
+  if (data.size() > config_.limit || contains(digest)) {
+    return;
+  }
+
+  std::string path = pathFor(digest);
+  std::string temp_path = path + ".tmp" + std::to_string(++temp_counter);
+  {
+    std::ofstream file(temp_path, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(data.data()), data.size());
+    if (!file) {
+      std::remove(temp_path.c_str());
+      throw std::runtime_error("Failed to store blob: " + digest);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::error_code ec;
+  std::filesystem::rename(temp_path, path, ec);
+  if (ec) {
+    std::remove(temp_path.c_str());
+    throw std::runtime_error("Failed to store blob: " + digest);
+  }
+  if (!blobs_.count(digest)) {
+    index(digest, data.size());
+    evict();
+  }
+}
+
+std::vector<uint8_t> BlobStore::get(const std::string &digest,
+                                    MemoryAccount *memory) {
+  size_t size = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = blobs_.find(digest);
+    if (it == blobs_.end()) {
+      throw BlobNotFound({digest});
+    }
+    lru_.splice(lru_.begin(), lru_, it->second.lru);
+    size = it->second.size;
+  }
+
+  if (memory) {
+    memory->reserve(size);
+  }
+
+  std::vector<uint8_t> data(size);
+  std::ifstream file(pathFor(digest), std::ios::binary);
+  if (!file || !file.read(reinterpret_cast<char *>(data.data()), size)) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    forget(digest);
+    throw BlobNotFound({digest});
+  }
+  return data;
+}
+
+size_t BlobStore::getCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return blobs_.size();
+}
+
+size_t BlobStore::getBytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_;
+}
+
+std::string BlobStore::pathFor(const std::string &digest) const {
+  return config_.directory + "/" + digest;
+}
+
+void BlobStore::index(const std::string &digest, size_t size) {
+  lru_.push_front(digest);
+  blobs_[digest] = Blob{size, lru_.begin()};
+  bytes_ += size;
+}
+
+void BlobStore::forget(const std::string &digest) {
+  auto it = blobs_.find(digest);
+  if (it == blobs_.end()) {
+    return;
+  }
+  bytes_ -= it->second.size;
+  lru_.erase(it->second.lru);
+  blobs_.erase(it);
+}
+
+void BlobStore::evict() {
+  while (bytes_ > config_.limit && !lru_.empty()) {
+    std::string victim = lru_.back();
+    forget(victim);
+    std::error_code ec;
+    std::filesystem::remove(pathFor(victim), ec);
+  }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class MemoryAccount;
+
+class BlobNotFound : public std::runtime_error {
+public:
+  explicit BlobNotFound(std::vector<std::string> digests);
+
+  const std::vector<std::string> &getDigests() const { return digests_; }
+
+private:
+  std::vector<std::string> digests_;
+};
+
+class BlobStore {
+public:
+  static constexpr const char *kReferenceContentType =
+      "application/vnd.archiver.blob-ref";
+
+  struct Config {
+    std::string directory = "/tmp/archiver_blobs";
+    size_t limit = 4ULL * 1024 * 1024 * 1024;
+  };
+
+  explicit BlobStore(Config config);
+
+  static BlobStore &instance();
+
+  static bool isValidDigest(const std::string &digest);
+
+  bool contains(const std::string &digest) const;
+  std::vector<std::string>
+  missing(const std::vector<std::string> &digests) const;
+
+  void put(const std::string &digest, const std::vector<uint8_t> &data);
+  std::vector<uint8_t> get(const std::string &digest,
+                           MemoryAccount *memory = nullptr);
+
+  size_t getCount() const;
+  size_t getBytes() const;
+  size_t getLimit() const { return config_.limit; }
+
+private:
+  struct Blob {
+    size_t size;
+    std::list<std::string>::iterator lru;
+  };
+
+  mutable std::mutex mutex_;
+  Config config_;
+  size_t bytes_ = 0;
+  std::list<std::string> lru_;
+  std::unordered_map<std::string, Blob> blobs_;
+
+  std::string pathFor(const std::string &digest) const;
+  void index(const std::string &digest, size_t size);
+  void forget(const std::string &digest);
+  void evict();
+};
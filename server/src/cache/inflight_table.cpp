@@ -0,0 +1,66 @@
+#include "inflight_table.h"
+
+SharedBuffer InflightTable::Flight::get() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (error_) {
+    std::rethrow_exception(error_);
+  }
+  return data_;
+}
+
+void InflightTable::Flight::finish(SharedBuffer data,
+                                   std::exception_ptr error) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    data_ = std::move(data);
+    error_ = error;
+  }
+  done_.notifyAll();
+}
+
+InflightTable &InflightTable::instance() {
+  static InflightTable table;
+  return table;
+}
+
+InflightTable::Shard &InflightTable::shardFor(const std::string &key) {
+  return shards_[std::hash<std::string>{}(key) % kShardCount];
+}
+
+std::shared_ptr<InflightTable::Flight>
+InflightTable::join(const std::string &key, bool &leader) {
+  Shard &shard = shardFor(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.flights.find(key);
+  if (it != shard.flights.end()) {
+    ++coalesced_;
+    leader = false;
+    return it->second;
+  }
+
+  ++leaders_;
+  leader = true;
+  auto flight = std::make_shared<Flight>();
+  shard.flights.emplace(key, flight);
+  return flight;
+}
+
+// A failed flight is dropped too, so the next request for key runs again.
+void InflightTable::land(const std::string &key, Flight &flight,
+                         SharedBuffer data, std::exception_ptr error) {
+  {
+    Shard &shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.flights.erase(key);
+  }
+  flight.finish(std::move(data), error);
+}
+
+size_t InflightTable::getInFlight() const {
+  size_t total = 0;
+  for (const auto &shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    total += shard.flights.size();
+  }
+  return total;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "../async/wait_list.h"
+#include "shared_buffer.h"
+#include <array>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class InflightTable {
+public:
+  using Producer = std::function<SharedBuffer()>;
+
+  struct Result {
+    SharedBuffer data;
+    bool coalesced = false;
+  };
+
+  // The result a leader is producing for one key.
+  class Flight {
+  public:
+    // Completes once the leader has finished, at once if it already has.
+    template <typename Executor, typename CompletionToken>
+    auto asyncWait(const Executor &executor, CompletionToken &&token) {
+      return done_.asyncWait(executor, 0, WaitList::Clock::time_point::max(),
+                             std::forward<CompletionToken>(token));
+    }
+
+    // The leader's result; rethrows what its producer threw.
+    SharedBuffer get() const;
+
+  private:
+    friend class InflightTable;
+
+    mutable std::mutex mutex_;
+    SharedBuffer data_;
+    std::exception_ptr error_;
+    WaitList done_;
+
+    void finish(SharedBuffer data, std::exception_ptr error);
+  };
+
+  static InflightTable &instance();
+
+  // Runs producer inline unless a flight for key is already running, in which
+  // case the caller waits for its result on the handler's executor instead of
+  // blocking a thread.
+  template <typename CompletionToken>
+  auto asyncRun(const std::string &key, const Producer &producer,
+                CompletionToken &&token) {
+    return boost::asio::async_initiate<CompletionToken,
+                                       void(std::exception_ptr, Result)>(
+        [this, &key, &producer](auto handler) {
+          auto executor = boost::asio::get_associated_executor(handler);
+          bool leader = false;
+          auto flight = join(key, leader);
+
+          if (!leader) {
+            flight->asyncWait(
+                executor, [flight, handler = std::move(handler)](
+                              boost::system::error_code) mutable {
+                  Result result{nullptr, true};
+                  std::exception_ptr error;
+                  try {
+                    result.data = flight->get();
+                  } catch (...) {
+                    error = std::current_exception();
+                  }
+                  handler(error, std::move(result));
+                });
+            return;
+          }
+
+          Result result;
+          std::exception_ptr error;
+          try {
+            result.data = producer();
+          } catch (...) {
+            error = std::current_exception();
+          }
+          land(key, *flight, result.data, error);
+          boost::asio::post(executor, [handler = std::move(handler), error,
+                                       result]() mutable {
+            handler(error, std::move(result));
+          });
+        },
+        token);
+  }
+
+  size_t getInFlight() const;
+  size_t getLeaderCount() const { return leaders_.load(); }
+  size_t getCoalescedCount() const { return coalesced_.load(); }
+
+private:
+  static constexpr size_t kShardCount = 16;
+
+  struct Shard {
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<Flight>> flights;
+  };
+
+  std::array<Shard, kShardCount> shards_;
+  std::atomic<size_t> leaders_{0};
+  std::atomic<size_t> coalesced_{0};
+
+  Shard &shardFor(const std::string &key);
+  std::shared_ptr<Flight> join(const std::string &key, bool &leader);
+  void land(const std::string &key, Flight &flight, SharedBuffer data,
+            std::exception_ptr error);
+};
@@ -0,0 +1,239 @@
+#include "result_cache.h"
+#include "../digest/digest.h"
+#include "../factory/factory.h"
+#include "../processor/processor.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+void hashOptions(ContentHasher &hasher, const CompressionOptions &options) {
+  hasher.update(static_cast<uint64_t>(options.level + 1));
+  hasher.update(static_cast<uint64_t>(options.block_size));
+  hasher.update(static_cast<uint64_t>(options.solid.value_or(true)));
+  hasher.update(options.archive_options);
+}
+} // namespace
+
+ResultCache::ResultCache(Config config) : config_(std::move(config)) {}
+
+ResultCache &ResultCache::instance() {
+  static ResultCache cache(Config{});
+  return cache;
+}
+
+std::string ResultCache::keyFor(const ArchiveRequest &request) {
+  ContentHasher hasher;
+  hasher.update(static_cast<uint64_t>(request.operation));
+  hasher.update(CompressorFactory::formatToString(request.format));
+
+  if (request.operation != ArchiveOperation::COMPRESS) {
+    if (request.operation == ArchiveOperation::CONVERT) {
+      hasher.update(static_cast<uint64_t>(request.reproducible));
+      hasher.update(static_cast<uint64_t>(request.mtime));
+      hasher.update(static_cast<uint64_t>(request.frame_size));
+      hashOptions(hasher, request.options);
+    }
+    hasher.update(request.extract_path);
+    hasher.update(static_cast<uint64_t>(request.filter.include.size()));
+    for (const auto &pattern : request.filter.include) {
+      hasher.update(pattern);
+    }
+    hasher.update(static_cast<uint64_t>(request.filter.exclude.size()));
+    for (const auto &pattern : request.filter.exclude) {
+      hasher.update(pattern);
+    }
+    hasher.update(request.filter.max_entry_size);
+    hasher.update(request.archive_data);
+    return hasher.finish();
+  }
+
+  hasher.update(static_cast<uint64_t>(request.reproducible));
+  hasher.update(static_cast<uint64_t>(request.mtime));
+  hasher.update(static_cast<uint64_t>(request.deduplicate));
+  hashOptions(hasher, request.options);
+  hasher.update(static_cast<uint64_t>(request.store_incompressible));
+  hasher.update(static_cast<uint64_t>(request.order_by_similarity));
+  if (request.format == CompressionFormat::TAR_ZST) {
+    hasher.update(static_cast<uint64_t>(request.frame_size));
+  }
+  hasher.update(static_cast<uint64_t>(request.files.size()));
+
+  // Reproducible archives list entries by name, so upload order must not
+  // change the key, or the ETag built from it.
+  std::vector<const FileEntry *> files;
+  for (const auto &file : request.files) {
+    files.push_back(&file);
+  }
+  if (request.reproducible) {
+    std::stable_sort(files.begin(), files.end(),
+                     [](const FileEntry *lhs, const FileEntry *rhs) {
+                       return lhs->name < rhs->name;
+                     });
+  }
+
+  for (const FileEntry *file : files) {
+    hasher.update(file->name);
+    hasher.update(file->digest.empty() ? ContentHasher::digest(file->data)
+                                       : file->digest);
+  }
+
+  return hasher.finish();
+}
+
+SharedBuffer ResultCache::get(const std::string &key, CompressStats *stats) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = memory_.find(key);
+  if (it != memory_.end()) {
+    memory_lru_.splice(memory_lru_.begin(), memory_lru_, it->second.lru);
+    ++stats_.memory_hits;
+    stats_.bytes_saved += it->second.data->size();
+    if (stats) {
+      *stats = it->second.stats;
+    }
+    return it->second.data;
+  }
+
+  SharedBuffer data = loadSpilled(key);
+  if (!data) {
+    ++stats_.misses;
+    return nullptr;
+  }
+
+  ++stats_.disk_hits;
+  stats_.bytes_saved += data->size();
+  CompressStats stored = disk_.at(key).stats;
+  if (stats) {
+    *stats = stored;
+  }
+  insertMemory(key, data, std::move(stored));
+  return data;
+}
+
+void ResultCache::put(const std::string &key, SharedBuffer data,
+                      CompressStats stats) {
+  if (!data || data->size() > config_.memory_limit) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (memory_.count(key)) {
+    return;
+  }
+  insertMemory(key, std::move(data), std::move(stats));
+}
+
+CompressStats ResultCache::statsFor(const std::string &key) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (auto it = memory_.find(key); it != memory_.end()) {
+    return it->second.stats;
+  }
+  if (auto it = disk_.find(key); it != disk_.end()) {
+    return it->second.stats;
+  }
+  return {};
+}
+
+void ResultCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  for (const auto &[key, entry] : disk_) {
+    std::error_code ec;
+    std::filesystem::remove(spillPath(key), ec);
+  }
+
+  memory_.clear();
+  memory_lru_.clear();
+  disk_.clear();
+  disk_lru_.clear();
+  stats_ = Stats{};
+}
+
+ResultCache::Stats ResultCache::getStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+std::string ResultCache::spillPath(const std::string &key) const {
+  return config_.spill_directory + "/" + key + ".archive";
+}
+
+void ResultCache::insertMemory(const std::string &key, SharedBuffer data,
+                               CompressStats stats) {
+  stats_.memory_bytes += data->size();
+  memory_lru_.push_front(key);
+  memory_[key] =
+      MemoryEntry{std::move(data), std::move(stats), memory_lru_.begin()};
+
+  while (stats_.memory_bytes > config_.memory_limit && !memory_lru_.empty()) {
+    const std::string victim = memory_lru_.back();
+    auto entry = memory_.find(victim);
+
+    stats_.memory_bytes -= entry->second.data->size();
+    ++stats_.evictions;
+    spill(victim, entry->second);
+
+    memory_.erase(entry);
+    memory_lru_.pop_back();
+  }
+}
+
+void ResultCache::spill(const std::string &key, const MemoryEntry &entry) {
+  const SharedBuffer &data = entry.data;
+  if (config_.disk_limit == 0 || data->size() > config_.disk_limit ||
+      disk_.count(key)) {
+    return;
+  }
+
+  std::error_code ec;
+  std::filesystem::create_directories(config_.spill_directory, ec);
+
+  std::ofstream file(spillPath(key), std::ios::binary);
+  if (!file) {
+    return;
+  }
+  file.write(reinterpret_cast<const char *>(data->data()), data->size());
+  if (!file) {
+    return;
+  }
+
+  disk_lru_.push_front(key);
+  disk_[key] = DiskEntry{data->size(), entry.stats, disk_lru_.begin()};
+  stats_.disk_bytes += data->size();
+  evictDisk();
+}
+
+void ResultCache::evictDisk() {
+  while (stats_.disk_bytes > config_.disk_limit && !disk_lru_.empty()) {
+    const std::string victim = disk_lru_.back();
+    auto entry = disk_.find(victim);
+
+    stats_.disk_bytes -= entry->second.size;
+    std::error_code ec;
+    std::filesystem::remove(spillPath(victim), ec);
+
+    disk_.erase(entry);
+    disk_lru_.pop_back();
+  }
+}
+
+SharedBuffer ResultCache::loadSpilled(const std::string &key) {
+  auto it = disk_.find(key);
+  if (it == disk_.end()) {
+    return nullptr;
+  }
+
+  std::ifstream file(spillPath(key), std::ios::binary);
+  auto data = std::make_shared<std::vector<uint8_t>>(it->second.size);
+  if (!file ||
+      !file.read(reinterpret_cast<char *>(data->data()), data->size())) {
+    stats_.disk_bytes -= it->second.size;
+    disk_lru_.erase(it->second.lru);
+    disk_.erase(it);
+    return nullptr;
+  }
+
+  disk_lru_.splice(disk_lru_.begin(), disk_lru_, it->second.lru);
+  return data;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "../compressor/compressor.h"
+#include "shared_buffer.h"
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+struct ArchiveRequest;
+
+class ResultCache {
+public:
+  struct Config {
+    size_t memory_limit = 256 * 1024 * 1024;
+    size_t disk_limit = 2ULL * 1024 * 1024 * 1024;
+    std::string spill_directory = "/tmp/archiver_cache";
+  };
+
+  struct Stats {
+    size_t memory_hits = 0;
+    size_t disk_hits = 0;
+    size_t misses = 0;
+    size_t bytes_saved = 0;
+    size_t memory_bytes = 0;
+    size_t disk_bytes = 0;
+    size_t evictions = 0;
+  };
+
+  explicit ResultCache(Config config);
+
+  static ResultCache &instance();
+
+  static std::string keyFor(const ArchiveRequest &request);
+
+  SharedBuffer get(const std::string &key, CompressStats *stats = nullptr);
+  void put(const std::string &key, SharedBuffer data,
+           CompressStats stats = {});
+  // The stats stored with key, without counting a hit.
+  CompressStats statsFor(const std::string &key) const;
+  void clear();
+
+  Stats getStats() const;
+
+private:
+  struct MemoryEntry {
+    SharedBuffer data;
+    CompressStats stats;
+    std::list<std::string>::iterator lru;
+  };
+
+  struct DiskEntry {
+    size_t size;
+    CompressStats stats;
+    std::list<std::string>::iterator lru;
+  };
+
+  mutable std::mutex mutex_;
+  Config config_;
+  Stats stats_;
+
+  std::list<std::string> memory_lru_;
+  std::unordered_map<std::string, MemoryEntry> memory_;
+  std::list<std::string> disk_lru_;
+  std::unordered_map<std::string, DiskEntry> disk_;
+
+  std::string spillPath(const std::string &key) const;
+  void insertMemory(const std::string &key, SharedBuffer data,
+                    CompressStats stats);
+  void spill(const std::string &key, const MemoryEntry &entry);
+  void evictDisk();
+  SharedBuffer loadSpilled(const std::string &key);
+};
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using SharedBuffer = std::shared_ptr<const std::vector<uint8_t>>;
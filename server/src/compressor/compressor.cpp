@@ -1,40 +1,230 @@
 #include "compressor.h"
 #include "archive.h"
+#include "../digest/digest.h"
+#include "../memory/memory_budget.h"
+#include "../order/similarity_order.h"
+#include "../sparse/sparse_map.h"
+#include "../xz/xz_writer.h"
+#include "../zip/zip_writer.h"
+#include "../zstd/seekable_zstd.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
 #include <cstring>
+#include <exception>
+#include <fnmatch.h>
 #include <fstream>
 #include <iostream>
+#include <optional>
 #include <stdexcept>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <zlib.h>
+#include <zstd.h>
+
+namespace {
+const size_t kConvertBlockSize = 64 * 1024;
+const size_t kIncompressibleSample = 64 * 1024;
+const size_t kIncompressibleWindows = 4;
+const double kIncompressibleRatio = 0.97;
+
+// Several compressors run at once, so every temp file needs its own name.
+std::atomic<uint64_t> temp_counter{0};
+
+// Collects libarchive's output, reserving each block before keeping it. A
+// failed reservation is kept so it can be rethrown once libarchive returns.
+struct ReservedOutput {
+  std::vector<uint8_t> data;
+  MemoryAccount *memory = nullptr;
+  std::exception_ptr error;
+  // Set when the output is compressed as it is written instead of kept;
+  // returns how much the compressed output grew.
+  std::function<size_t(const uint8_t *, size_t)> encode;
+};
+
+la_ssize_t appendReserved(struct archive *a, void *client, const void *buffer,
+                          size_t length) {
+  auto *output = static_cast<ReservedOutput *>(client);
+  try {
+    const auto *bytes = static_cast<const uint8_t *>(buffer);
+    if (output->encode) {
+      size_t grown = output->encode(bytes, length);
+      if (output->memory) {
+        output->memory->reserve(grown);
+      }
+      return length;
+    }
+    if (output->memory) {
+      output->memory->reserve(length);
+    }
+    output->data.insert(output->data.end(), bytes, bytes + length);
+  } catch (...) {
+    output->error = std::current_exception();
+    archive_set_error(a, ENOMEM, "Output reservation failed");
+    return -1;
+  }
+  return length;
+}
+
+// gnutar ignores sparse maps when writing, so archives with holes use pax,
+// which stores them as GNU sparse 1.0 entries.
+void setTarFormat(struct archive *a, bool sparse) {
+  if (sparse) {
+    archive_write_set_format_pax_restricted(a);
+  } else {
+    archive_write_set_format_gnutar(a);
+  }
+}
+} // namespace
 
 LibArchiveCompressor::LibArchiveCompressor(CompressionFormat format)
     : format_(format) {}
 
+std::vector<size_t>
+LibArchiveCompressor::entryOrder(const std::vector<FileEntry> &files,
+                                 std::map<std::string, size_t> *prefilters)
+    const {
+  std::vector<size_t> order(files.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  if (reproducible_) {
+    std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+      return files[lhs].name < files[rhs].name;
+    });
+  }
+
+  // zip compresses every entry on its own, so only solid formats gain from
+  // neighbouring similar files.
+  if (order_by_similarity_ && format_ != CompressionFormat::ZIP) {
+    std::vector<const FileEntry *> current;
+    for (size_t i : order) {
+      current.push_back(&files[i]);
+    }
+    std::vector<size_t> similar = SimilarityOrder::order(current);
+    for (size_t &position : similar) {
+      position = order[position];
+    }
+    order = std::move(similar);
+  }
+
+  // Entries sharing a prefilter go next to each other so each run becomes
+  // one xz block.
+  if (format_ == CompressionFormat::TAR_XZ) {
+    std::vector<PrefilterChoice> filters;
+    for (const auto &file : files) {
+      filters.push_back(XzWriter::detect(file.data.data(), file.data.size()));
+      if (prefilters) {
+        ++(*prefilters)[XzWriter::describe(filters.back())];
+      }
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+      return filters[lhs] < filters[rhs];
+    });
+  }
+  return order;
+}
+
 std::vector<uint8_t>
 LibArchiveCompressor::compress(const std::vector<FileEntry> &files) {
+  stats_ = CompressStats{};
+  stats_.entry_order = entryOrder(files, &stats_.prefilters);
+  std::vector<const FileEntry *> ordered;
+  for (size_t i : stats_.entry_order) {
+    ordered.push_back(&files[i]);
+  }
+
+  std::vector<long> duplicates(ordered.size(), -1);
+  if (deduplicate_ && supportsDeduplication(format_)) {
+    duplicates = findDuplicates(ordered);
+    for (size_t i = 0; i < ordered.size(); ++i) {
+      if (duplicates[i] >= 0) {
+        ++stats_.dedup.entries;
+        stats_.dedup.saved_bytes += ordered[i]->data.size();
+      }
+    }
+  }
+
+  if ((deduplicate_ || store_incompressible_) &&
+      format_ == CompressionFormat::ZIP) {
+    return compressZip(ordered, duplicates);
+  }
+
+  // Formats that cannot store single entries fall back to level 0 when
+  // nothing in the upload would shrink.
+  int level = options_.level;
+  if (store_incompressible_ && (format_ == CompressionFormat::TAR_GZ ||
+                                format_ == CompressionFormat::SEVEN_Z)) {
+    bool incompressible =
+        std::all_of(files.begin(), files.end(), [](const FileEntry &file) {
+          return isIncompressible(file.data);
+        });
+    if (incompressible) {
+      level = 0;
+    }
+  }
+
+  std::vector<std::vector<SparseRegion>> sparse(ordered.size());
+  bool has_sparse = false;
+  if (supportsSparse(format_)) {
+    for (size_t i = 0; i < ordered.size(); ++i) {
+      if (duplicates[i] < 0) {
+        const std::vector<uint8_t> &data = ordered[i]->data;
+        sparse[i] = SparseMap::scan(data.data(), data.size());
+        if (!sparse[i].empty()) {
+          has_sparse = true;
+          ++stats_.sparse.entries;
+          stats_.sparse.hole_bytes +=
+              data.size() - SparseMap::dataBytes(sparse[i]);
+        }
+      }
+    }
+  }
+
   struct archive *a = archive_write_new();
   if (!a) {
     throw std::runtime_error("Failed to create archive");
   }
 
   try {
-    setupArchiveFormat(a);
+    setupArchiveFormat(a, level, has_sparse);
 
-    std::string temp_filename =
-        "/tmp/libarchive_temp_" + std::to_string(time(nullptr)) + ".archive";
+    std::string temp_filename = "/tmp/libarchive_temp_" +
+                                std::to_string(getpid()) + "_" +
+                                std::to_string(temp_counter++) + ".archive";
 
     if (archive_write_open_filename(a, temp_filename.c_str()) != ARCHIVE_OK) {
       throw std::runtime_error("Failed to open archive for writing: " +
                                std::string(archive_error_string(a)));
     }
 
-    for (const auto &file : files) {
+    for (size_t i = 0; i < ordered.size(); ++i) {
+      const FileEntry *file = ordered[i];
       struct archive_entry *entry = archive_entry_new();
 
-      std::vector<uint8_t> file_data = file.data;
+      std::vector<uint8_t> file_data;
+      if (duplicates[i] < 0) {
+        file_data = file->data;
+      } else {
+        archive_entry_set_hardlink(entry,
+                                   ordered[duplicates[i]]->name.c_str());
+      }
 
-      archive_entry_set_pathname(entry, file.name.c_str());
+      archive_entry_set_pathname(entry, file->name.c_str());
       archive_entry_set_size(entry, file_data.size());
       archive_entry_set_mode(entry, AE_IFREG | 0644);
-      archive_entry_set_mtime(entry, time(nullptr), 0);
+      archive_entry_set_mtime(entry, entryTime(), 0);
+      if (reproducible_) {
+        archive_entry_set_uid(entry, 0);
+        archive_entry_set_gid(entry, 0);
+        archive_entry_set_uname(entry, "");
+        archive_entry_set_gname(entry, "");
+      }
+      // The writer skips the holes, so zero runs never reach the filter.
+      for (const auto &region : sparse[i]) {
+        archive_entry_sparse_add_entry(entry, region.offset, region.length);
+      }
 
       if (archive_write_header(a, entry) != ARCHIVE_OK) {
         archive_entry_free(entry);
@@ -66,6 +256,21 @@ LibArchiveCompressor::compress(const std::vector<FileEntry> &files) {
 
     std::remove(temp_filename.c_str());
 
+    if (format_ == CompressionFormat::TAR_ZST) {
+      std::vector<uint8_t> tar = std::move(result);
+      result = SeekableZstd::compress(tar, zstdFrameSize(), zstdLevel(),
+                                      options_.threads);
+      if (memory_) {
+        memory_->reserve(result.size());
+      }
+    } else if (format_ == CompressionFormat::TAR_XZ) {
+      std::vector<uint8_t> tar = std::move(result);
+      result = XzWriter::compress(tar, xzLevel());
+      if (memory_) {
+        memory_->reserve(result.size());
+      }
+    }
+
     return result;
 
   } catch (...) {
@@ -74,21 +279,422 @@ LibArchiveCompressor::compress(const std::vector<FileEntry> &files) {
   }
 }
 
+std::vector<uint8_t> LibArchiveCompressor::compressZip(
+    const std::vector<const FileEntry *> &files,
+    const std::vector<long> &duplicates) const {
+  ZipWriter writer(entryTime());
+  writer.setLevel(options_.level);
+  std::vector<size_t> written(files.size());
+
+  for (size_t i = 0; i < files.size(); ++i) {
+    const std::vector<uint8_t> &data = files[i]->data;
+    if (duplicates[i] < 0 && store_incompressible_ && isIncompressible(data)) {
+      writer.addRaw(files[i]->name, 0, crc32(0L, data.data(), data.size()),
+                    data.size(), data.data(), data.size());
+      written[i] = writer.getEntryCount() - 1;
+    } else if (duplicates[i] < 0) {
+      written[i] = writer.addEntry(files[i]->name, files[i]->data);
+    } else {
+      writer.addCopy(files[i]->name, written[duplicates[i]]);
+      written[i] = written[duplicates[i]];
+    }
+  }
+
+  std::vector<uint8_t> result = writer.finish();
+  if (memory_) {
+    memory_->reserve(result.size());
+  }
+  return result;
+}
+
+bool LibArchiveCompressor::supportsDeduplication(CompressionFormat format) {
+  return format != CompressionFormat::SEVEN_Z;
+}
+
+std::vector<long> LibArchiveCompressor::findDuplicates(
+    const std::vector<const FileEntry *> &files) {
+  std::vector<long> duplicates(files.size(), -1);
+  std::unordered_map<std::string, std::vector<size_t>> by_digest;
+
+  for (size_t i = 0; i < files.size(); ++i) {
+    const FileEntry *file = files[i];
+    if (file->data.empty()) {
+      continue;
+    }
+
+    std::string digest = file->digest.empty()
+                             ? ContentHasher::digest(file->data)
+                             : file->digest;
+    auto &candidates = by_digest[digest];
+    for (size_t candidate : candidates) {
+      if (files[candidate]->name != file->name &&
+          files[candidate]->data == file->data) {
+        duplicates[i] = static_cast<long>(candidate);
+        break;
+      }
+    }
+    if (duplicates[i] < 0) {
+      candidates.push_back(i);
+    }
+  }
+
+  return duplicates;
+}
+
+DedupStats
+LibArchiveCompressor::measureDuplicates(const std::vector<FileEntry> &files) {
+  std::vector<const FileEntry *> pointers;
+  for (const auto &file : files) {
+    pointers.push_back(&file);
+  }
+
+  DedupStats stats;
+  std::vector<long> duplicates = findDuplicates(pointers);
+  for (size_t i = 0; i < duplicates.size(); ++i) {
+    if (duplicates[i] >= 0) {
+      ++stats.entries;
+      stats.saved_bytes += files[i].data.size();
+    }
+  }
+  return stats;
+}
+
+bool LibArchiveCompressor::supportsSparse(CompressionFormat format) {
+  return format == CompressionFormat::TAR_GZ ||
+         format == CompressionFormat::TAR_BZ2 ||
+         format == CompressionFormat::TAR_ZST ||
+         format == CompressionFormat::TAR_XZ;
+}
+
+SparseStats
+LibArchiveCompressor::measureSparse(const std::vector<FileEntry> &files) {
+  SparseStats stats;
+  for (const auto &file : files) {
+    std::vector<SparseRegion> regions =
+        SparseMap::scan(file.data.data(), file.data.size());
+    if (!regions.empty()) {
+      ++stats.entries;
+      stats.hole_bytes += file.data.size() - SparseMap::dataBytes(regions);
+    }
+  }
+  return stats;
+}
+
+// Windows spread over the data must all fail to shrink, so a compressible
+// region anywhere keeps the entry compressed.
+bool LibArchiveCompressor::isIncompressible(const std::vector<uint8_t> &data) {
+  if (data.empty()) {
+    return false;
+  }
+
+  size_t sample = std::min(data.size(), kIncompressibleSample);
+  size_t windows = std::min(kIncompressibleWindows, data.size() / sample);
+  std::vector<uint8_t> compressed(compressBound(sample));
+  for (size_t i = 0; i < windows; ++i) {
+    size_t offset =
+        windows > 1 ? (data.size() - sample) * i / (windows - 1) : 0;
+    uLongf compressed_size = compressed.size();
+    if (compress2(compressed.data(), &compressed_size, data.data() + offset,
+                  sample, 1) != Z_OK ||
+        compressed_size < kIncompressibleRatio * sample) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool EntryFilter::matches(const std::string &name, int64_t size) const {
+  if (max_entry_size > 0 && size > 0 &&
+      static_cast<uint64_t>(size) > max_entry_size) {
+    return false;
+  }
+
+  auto matchesAny = [&name](const std::vector<std::string> &patterns) {
+    return std::any_of(patterns.begin(), patterns.end(),
+                       [&name](const std::string &pattern) {
+                         return fnmatch(pattern.c_str(), name.c_str(), 0) == 0;
+                       });
+  };
+
+  if (!include.empty() && !matchesAny(include)) {
+    return false;
+  }
+  return !matchesAny(exclude);
+}
+
 std::vector<FileEntry>
-LibArchiveCompressor::extract(const std::vector<uint8_t> &archive_data) {
-  std::string temp_filename =
-      "/tmp/libarchive_extract_" + std::to_string(time(nullptr)) + ".archive";
-  std::ofstream temp_file(temp_filename, std::ios::binary);
-  if (!temp_file) {
-    throw std::runtime_error("Cannot create temporary file for extraction");
+LibArchiveCompressor::extract(const std::vector<uint8_t> &input) {
+  std::vector<uint8_t> decoded;
+  if (format_ == CompressionFormat::TAR_ZST &&
+      SeekableZstd::hasSeekTable(input.data(), input.size())) {
+    SeekableZstd seekable(input.data(), input.size());
+    if (memory_) {
+      memory_->reserve(seekable.getDecompressedSize());
+    }
+    decoded = seekable.decompress();
   }
-  temp_file.write(reinterpret_cast<const char *>(archive_data.data()),
-                  archive_data.size());
-  temp_file.close();
+  const std::vector<uint8_t> &archive_data = decoded.empty() ? input : decoded;
+
+  std::vector<FileEntry> extracted_files;
+  std::unordered_map<std::string, std::vector<size_t>> skipped_targets;
+
+  readEntries(archive_data, [&](struct archive *a, struct archive_entry *entry) {
+    std::string name = archive_entry_pathname(entry);
+    la_int64_t file_size = archive_entry_size(entry);
+    const char *hardlink = archive_entry_hardlink(entry);
+    bool is_link = hardlink && file_size <= 0;
 
+    if (!filter_.matches(name, file_size)) {
+      archive_read_data_skip(a);
+      return;
+    }
+
+    FileEntry file;
+    file.name = name;
+
+    if (is_link) {
+      auto target = std::find_if(
+          extracted_files.rbegin(), extracted_files.rend(),
+          [hardlink](const FileEntry &f) { return f.name == hardlink; });
+      if (target != extracted_files.rend()) {
+        if (!filter_.matches(name, target->data.size())) {
+          return;
+        }
+        if (memory_) {
+          memory_->reserve(target->data.size());
+        }
+        file.data = target->data;
+      } else {
+        skipped_targets[hardlink].push_back(extracted_files.size());
+      }
+    } else if (file_size > 0) {
+      file.data = readData(a, file_size);
+    }
+
+    extracted_files.push_back(std::move(file));
+  });
+
+  if (!skipped_targets.empty()) {
+    std::vector<bool> oversized(extracted_files.size(), false);
+
+    readEntries(archive_data, [&](struct archive *a,
+                                  struct archive_entry *entry) {
+      auto it = skipped_targets.find(archive_entry_pathname(entry));
+      la_int64_t file_size = archive_entry_size(entry);
+      if (it == skipped_targets.end() || file_size <= 0) {
+        archive_read_data_skip(a);
+        return;
+      }
+
+      if (filter_.max_entry_size > 0 &&
+          static_cast<uint64_t>(file_size) > filter_.max_entry_size) {
+        for (size_t index : it->second) {
+          oversized[index] = true;
+        }
+        archive_read_data_skip(a);
+      } else {
+        std::vector<uint8_t> data = readData(a, file_size);
+        for (size_t index : it->second) {
+          if (memory_) {
+            memory_->reserve(data.size());
+          }
+          extracted_files[index].data = data;
+        }
+      }
+      skipped_targets.erase(it);
+    });
+
+    size_t kept = 0;
+    for (size_t i = 0; i < extracted_files.size(); ++i) {
+      if (oversized[i]) {
+        continue;
+      }
+      if (kept != i) {
+        extracted_files[kept] = std::move(extracted_files[i]);
+      }
+      ++kept;
+    }
+    extracted_files.resize(kept);
+  }
+
+  return extracted_files;
+}
+
+// tar.zst and tar.xz are compressed as libarchive writes the tar, so the
+// whole tar is never held.
+std::vector<uint8_t>
+LibArchiveCompressor::convert(const std::vector<uint8_t> &source) {
+  ReservedOutput output;
+  output.memory = memory_;
+  std::optional<SeekableZstd::Writer> zstd;
+  std::optional<XzWriter::Stream> xz;
+  if (format_ == CompressionFormat::TAR_ZST) {
+    zstd.emplace(zstdFrameSize(), zstdLevel(), options_.threads);
+    output.encode = [&zstd](const uint8_t *data, size_t size) {
+      size_t before = zstd->getOutputSize();
+      zstd->write(data, size);
+      return zstd->getOutputSize() - before;
+    };
+  } else if (format_ == CompressionFormat::TAR_XZ) {
+    xz.emplace(xzLevel());
+    output.encode = [&xz](const uint8_t *data, size_t size) {
+      size_t before = xz->getOutputSize();
+      xz->write(data, size);
+      return xz->getOutputSize() - before;
+    };
+  }
+
+  struct archive *a = archive_write_new();
+  if (!a) {
+    throw std::runtime_error("Failed to create archive");
+  }
+
+  try {
+    setupArchiveFormat(a, options_.level);
+    // Unblocked, every entry's header reaches the xz stream only after its
+    // prefilter has been set.
+    if (xz) {
+      archive_write_set_bytes_per_block(a, 0);
+    }
+    if (archive_write_open(a, &output, nullptr, appendReserved, nullptr) !=
+        ARCHIVE_OK) {
+      throw std::runtime_error("Failed to open archive for writing: " +
+                               std::string(archive_error_string(a)));
+    }
+
+    if (memory_) {
+      memory_->reserve(kConvertBlockSize);
+    }
+    std::vector<uint8_t> block(kConvertBlockSize);
+    bool tar_output = format_ != CompressionFormat::ZIP &&
+                      format_ != CompressionFormat::SEVEN_Z;
+    // Links are only written as links when their target made it into the
+    // output; the rest become regular files in a second pass.
+    std::unordered_set<std::string> written;
+    std::unordered_map<std::string, std::vector<std::string>> links;
+
+    readEntries(source, [&](struct archive *in, struct archive_entry *entry) {
+      std::string name = archive_entry_pathname(entry);
+      const char *hardlink = archive_entry_hardlink(entry);
+      if (!filter_.matches(name, archive_entry_size(entry))) {
+        archive_read_data_skip(in);
+        return;
+      }
+      if (hardlink && archive_entry_size(entry) <= 0 &&
+          (!tar_output || !written.count(hardlink))) {
+        links[hardlink].push_back(name);
+        return;
+      }
+      size_t head = 0;
+      if (xz) {
+        la_ssize_t bytes_read =
+            archive_read_data(in, block.data(), block.size());
+        if (bytes_read < 0) {
+          throw std::runtime_error("Failed to read file data: " +
+                                   std::string(archive_error_string(in)));
+        }
+        head = bytes_read;
+        xz->setFilter(XzWriter::detect(block.data(), head));
+      }
+      writeHeader(a, entry);
+      copyData(in, a, block, head);
+      written.insert(name);
+    });
+
+    if (!links.empty()) {
+      readEntries(source, [&](struct archive *in,
+                              struct archive_entry *entry) {
+        auto it = links.find(archive_entry_pathname(entry));
+        if (it == links.end() || archive_entry_hardlink(entry)) {
+          archive_read_data_skip(in);
+          return;
+        }
+
+        std::vector<uint8_t> data = readData(in, archive_entry_size(entry));
+        if (xz) {
+          xz->setFilter(XzWriter::detect(data.data(), data.size()));
+        }
+        for (const auto &name : it->second) {
+          if (!filter_.matches(name, data.size())) {
+            continue;
+          }
+          archive_entry_set_pathname(entry, name.c_str());
+          writeHeader(a, entry);
+          if (!data.empty() &&
+              archive_write_data(a, data.data(), data.size()) < 0) {
+            throw std::runtime_error("Failed to write file data: " +
+                                     std::string(archive_error_string(a)));
+          }
+        }
+      });
+    }
+
+    if (archive_write_close(a) != ARCHIVE_OK) {
+      throw std::runtime_error("Failed to close archive: " +
+                               std::string(archive_error_string(a)));
+    }
+    archive_write_free(a);
+  } catch (...) {
+    archive_write_free(a);
+    if (output.error) {
+      std::rethrow_exception(output.error);
+    }
+    throw;
+  }
+
+  if (zstd) {
+    return zstd->finish();
+  }
+  if (xz) {
+    return xz->finish();
+  }
+  return std::move(output.data);
+}
+
+void LibArchiveCompressor::writeHeader(struct archive *a,
+                                       struct archive_entry *entry) const {
+  archive_entry_sparse_clear(entry);
+  if (reproducible_) {
+    archive_entry_set_mtime(entry, mtime_, 0);
+    archive_entry_set_uid(entry, 0);
+    archive_entry_set_gid(entry, 0);
+    archive_entry_set_uname(entry, "");
+    archive_entry_set_gname(entry, "");
+  }
+
+  if (archive_write_header(a, entry) != ARCHIVE_OK) {
+    throw std::runtime_error("Failed to write file header: " +
+                             std::string(archive_error_string(a)));
+  }
+}
+
+void LibArchiveCompressor::copyData(struct archive *in, struct archive *out,
+                                    std::vector<uint8_t> &block,
+                                    size_t buffered) const {
+  if (buffered > 0 && archive_write_data(out, block.data(), buffered) < 0) {
+    throw std::runtime_error("Failed to write file data: " +
+                             std::string(archive_error_string(out)));
+  }
+  la_ssize_t bytes_read;
+  while ((bytes_read = archive_read_data(in, block.data(), block.size())) >
+         0) {
+    if (archive_write_data(out, block.data(), bytes_read) < 0) {
+      throw std::runtime_error("Failed to write file data: " +
+                               std::string(archive_error_string(out)));
+    }
+  }
+  if (bytes_read < 0) {
+    throw std::runtime_error("Failed to read file data: " +
+                             std::string(archive_error_string(in)));
+  }
+}
+
+void LibArchiveCompressor::readEntries(
+    const std::vector<uint8_t> &archive_data,
+    const std::function<void(struct archive *, struct archive_entry *)>
+        &visit) const {
   struct archive *a = archive_read_new();
   if (!a) {
-    std::remove(temp_filename.c_str());
     throw std::runtime_error("Failed to create archive reader");
   }
 
@@ -96,71 +702,164 @@ LibArchiveCompressor::extract(const std::vector<uint8_t> &archive_data) {
     archive_read_support_format_all(a);
     archive_read_support_filter_all(a);
 
-    if (archive_read_open_filename(a, temp_filename.c_str(), 65536) !=
+    if (archive_read_open_memory(a, archive_data.data(), archive_data.size()) !=
         ARCHIVE_OK) {
       throw std::runtime_error("Failed to open archive for reading: " +
                                std::string(archive_error_string(a)));
     }
 
-    std::vector<FileEntry> extracted_files;
     struct archive_entry *entry;
-
     while (archive_read_next_header(a, &entry) == ARCHIVE_OK) {
-      FileEntry file;
-      file.name = archive_entry_pathname(entry);
-
-      la_int64_t file_size = archive_entry_size(entry);
-      if (file_size > 0) {
-        file.data.resize(file_size);
-
-        la_ssize_t bytes_read =
-            archive_read_data(a, file.data.data(), file_size);
-        if (bytes_read < 0) {
-          throw std::runtime_error("Failed to read file data: " +
-                                   std::string(archive_error_string(a)));
-        }
-
-        file.data.resize(bytes_read);
-      }
-
-      extracted_files.push_back(std::move(file));
+      visit(a, entry);
     }
 
     archive_read_free(a);
-    std::remove(temp_filename.c_str());
-    return extracted_files;
-
   } catch (...) {
     archive_read_free(a);
-    std::remove(temp_filename.c_str());
     throw;
   }
 }
 
-void LibArchiveCompressor::setupArchiveFormat(struct archive *a) const {
+std::vector<uint8_t> LibArchiveCompressor::readData(struct archive *a,
+                                                    la_int64_t size) const {
+  if (memory_) {
+    memory_->reserve(size);
+  }
+  std::vector<uint8_t> data(size);
+
+  // Copy block by block at the offsets the reader reports: holes in sparse
+  // entries are skipped and stay zero in the buffer.
+  const void *block;
+  size_t length;
+  la_int64_t offset;
+  int status;
+  while ((status = archive_read_data_block(a, &block, &length, &offset)) ==
+         ARCHIVE_OK) {
+    if (offset < 0 || static_cast<uint64_t>(offset) + length > data.size()) {
+      throw std::runtime_error("File data exceeds entry size");
+    }
+    std::memcpy(data.data() + offset, block, length);
+  }
+  if (status != ARCHIVE_EOF) {
+    throw std::runtime_error("Failed to read file data: " +
+                             std::string(archive_error_string(a)));
+  }
+
+  return data;
+}
+
+int LibArchiveCompressor::zstdLevel() const {
+  if (options_.level < 0) {
+    return SeekableZstd::kDefaultLevel;
+  }
+  if (options_.level > ZSTD_maxCLevel()) {
+    throw std::runtime_error("Invalid compression level " +
+                             std::to_string(options_.level) + " for TAR.ZST");
+  }
+  return options_.level;
+}
+
+int LibArchiveCompressor::xzLevel() const {
+  if (options_.level < 0) {
+    return XzWriter::kDefaultLevel;
+  }
+  if (options_.level > 9) {
+    throw std::runtime_error("Invalid compression level " +
+                             std::to_string(options_.level) + " for TAR.XZ");
+  }
+  return options_.level;
+}
+
+size_t LibArchiveCompressor::zstdFrameSize() const {
+  return options_.block_size ? options_.block_size : frame_size_;
+}
+
+void LibArchiveCompressor::setupArchiveFormat(struct archive *a, int level,
+                                              bool sparse) const {
+  std::string level_option = std::to_string(level);
+  int status = ARCHIVE_OK;
+
   switch (format_) {
   case CompressionFormat::ZIP:
     archive_write_set_format_zip(a);
     archive_write_zip_set_compression_deflate(a);
+    if (level >= 0) {
+      status = archive_write_set_format_option(a, "zip", "compression-level",
+                                               level_option.c_str());
+    }
     break;
 
   case CompressionFormat::TAR_GZ:
-    archive_write_set_format_gnutar(a);
+    setTarFormat(a, sparse);
     archive_write_add_filter_gzip(a);
+    if (reproducible_) {
+      archive_write_set_filter_option(a, "gzip", "timestamp", nullptr);
+    }
+    if (level >= 0) {
+      status = archive_write_set_filter_option(a, "gzip", "compression-level",
+                                               level_option.c_str());
+    }
     break;
 
   case CompressionFormat::TAR_BZ2:
-    archive_write_set_format_gnutar(a);
+    setTarFormat(a, sparse);
     archive_write_add_filter_bzip2(a);
+    // bzip2 levels are its block size in units of 100 kB.
+    if (options_.block_size) {
+      level_option = std::to_string(options_.block_size / 100000);
+    }
+    if (level >= 0 || options_.block_size) {
+      status = archive_write_set_filter_option(a, "bzip2", "compression-level",
+                                               level_option.c_str());
+    }
     break;
 
   case CompressionFormat::SEVEN_Z:
     archive_write_set_format_7zip(a);
+    if (level >= 0) {
+      status = archive_write_set_format_option(a, "7zip", "compression-level",
+                                               level_option.c_str());
+    }
+    break;
+
+  case CompressionFormat::TAR_ZST:
+  case CompressionFormat::TAR_XZ:
+    setTarFormat(a, sparse);
     break;
 
   default:
     throw std::runtime_error("Unsupported compression format");
   }
+
+  if (status != ARCHIVE_OK) {
+    throw std::runtime_error("Invalid compression level " + level_option +
+                             " for " +
+                             getFormatString());
+  }
+
+  if (!options_.archive_options.empty() &&
+      archive_write_set_options(a, options_.archive_options.c_str()) !=
+          ARCHIVE_OK) {
+    const char *error = archive_error_string(a);
+    throw std::runtime_error("Invalid archive options for " +
+                             std::string(getFormatString()) + ": " +
+                             (error ? error : options_.archive_options));
+  }
+}
+
+void LibArchiveCompressor::checkOptions() const {
+  struct archive *a = archive_write_new();
+  if (!a) {
+    throw std::runtime_error("Failed to create archive");
+  }
+
+  try {
+    setupArchiveFormat(a, options_.level);
+  } catch (...) {
+    archive_write_free(a);
+    throw;
+  }
+  archive_write_free(a);
 }
 
 std::string LibArchiveCompressor::getFormatName() const {
@@ -177,6 +876,10 @@ std::string LibArchiveCompressor::getFileExtension() const {
     return ".tar.bz2";
   case CompressionFormat::SEVEN_Z:
     return ".7z";
+  case CompressionFormat::TAR_ZST:
+    return ".tar.zst";
+  case CompressionFormat::TAR_XZ:
+    return ".tar.xz";
   default:
     return ".archive";
   }
@@ -192,6 +895,10 @@ const char *LibArchiveCompressor::getFormatString() const {
     return "TAR.BZ2";
   case CompressionFormat::SEVEN_Z:
     return "7Z";
+  case CompressionFormat::TAR_ZST:
+    return "TAR.ZST";
+  case CompressionFormat::TAR_XZ:
+    return "TAR.XZ";
   default:
     return "UNKNOWN";
   }
@@ -208,6 +915,10 @@ LibArchiveCompressor::loadFileFromDisk(const std::string &path) const {
   size_t file_size = file.tellg();
   file.seekg(0, std::ios::beg);
 
+  if (memory_) {
+    memory_->reserve(file_size);
+  }
+
   std::vector<uint8_t> data(file_size);
   file.read(reinterpret_cast<char *>(data.data()), file_size);
 
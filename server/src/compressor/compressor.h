@@ -1,15 +1,22 @@
 #pragma once
 #include <archive.h>
 #include <archive_entry.h>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <optional>
 #include <string>
 #include <vector>
 
-enum class CompressionFormat { ZIP, TAR_GZ, TAR_BZ2, SEVEN_Z };
+class MemoryAccount;
+
+enum class CompressionFormat { ZIP, TAR_GZ, TAR_BZ2, SEVEN_Z, TAR_ZST, TAR_XZ };
 
 struct FileEntry {
   std::string name;
   std::string source_path;
   std::vector<uint8_t> data;
+  std::string digest;
 
   FileEntry() = default;
   FileEntry(const std::string &name, const std::vector<uint8_t> &data)
@@ -18,6 +25,40 @@ struct FileEntry {
       : name(name), source_path(source_path) {}
 };
 
+struct EntryFilter {
+  std::vector<std::string> include;
+  std::vector<std::string> exclude;
+  uint64_t max_entry_size = 0;
+
+  bool matches(const std::string &name, int64_t size) const;
+};
+
+struct CompressionOptions {
+  int level = -1;
+  int threads = 0;
+  size_t block_size = 0;
+  std::optional<bool> solid;
+  std::string archive_options;
+};
+
+struct DedupStats {
+  size_t entries = 0;
+  size_t saved_bytes = 0;
+};
+
+struct SparseStats {
+  size_t entries = 0;
+  uint64_t hole_bytes = 0;
+};
+
+// What compress() learned about the files while writing them.
+struct CompressStats {
+  std::vector<size_t> entry_order;
+  std::map<std::string, size_t> prefilters;
+  DedupStats dedup;
+  SparseStats sparse;
+};
+
 class LibArchiveCompressor {
 public:
   explicit LibArchiveCompressor(CompressionFormat format);
@@ -25,13 +66,71 @@ public:
 
   std::vector<uint8_t> compress(const std::vector<FileEntry> &files);
   std::vector<FileEntry> extract(const std::vector<uint8_t> &archive_data);
+  std::vector<uint8_t> convert(const std::vector<uint8_t> &source);
   std::string getFormatName() const;
   std::string getFileExtension() const;
+  void checkOptions() const;
+
+  void setMemoryAccount(MemoryAccount *account) { memory_ = account; }
+  void setReproducible(bool reproducible, time_t mtime) {
+    reproducible_ = reproducible;
+    mtime_ = mtime;
+  }
+  // Where entry times come from outside reproducible mode.
+  void setClock(std::function<time_t()> clock) { clock_ = std::move(clock); }
+  void setDeduplicate(bool deduplicate) { deduplicate_ = deduplicate; }
+  void setEntryFilter(EntryFilter filter) { filter_ = std::move(filter); }
+  void setFrameSize(size_t frame_size) { frame_size_ = frame_size; }
+  void setOptions(CompressionOptions options) { options_ = std::move(options); }
+  void setLevel(int level) { options_.level = level; }
+  void setStoreIncompressible(bool store) { store_incompressible_ = store; }
+  void setOrderBySimilarity(bool enabled) { order_by_similarity_ = enabled; }
+
+  std::vector<size_t>
+  entryOrder(const std::vector<FileEntry> &files,
+             std::map<std::string, size_t> *prefilters = nullptr) const;
+  const CompressStats &getStats() const { return stats_; }
+
+  static bool supportsDeduplication(CompressionFormat format);
+  static DedupStats measureDuplicates(const std::vector<FileEntry> &files);
+  static bool supportsSparse(CompressionFormat format);
+  static SparseStats measureSparse(const std::vector<FileEntry> &files);
+  static bool isIncompressible(const std::vector<uint8_t> &data);
 
 private:
   CompressionFormat format_;
+  MemoryAccount *memory_ = nullptr;
+  bool reproducible_ = false;
+  time_t mtime_ = 0;
+  std::function<time_t()> clock_ = []() { return time(nullptr); };
+  bool deduplicate_ = false;
+  EntryFilter filter_;
+  size_t frame_size_ = 1024 * 1024;
+  CompressionOptions options_;
+  bool store_incompressible_ = false;
+  bool order_by_similarity_ = false;
+  CompressStats stats_;
 
-  void setupArchiveFormat(struct archive *a) const;
+  time_t entryTime() const { return reproducible_ ? mtime_ : clock_(); }
+  void setupArchiveFormat(struct archive *a, int level,
+                          bool sparse = false) const;
+  int zstdLevel() const;
+  int xzLevel() const;
+  size_t zstdFrameSize() const;
   const char *getFormatString() const;
   std::vector<uint8_t> loadFileFromDisk(const std::string &path) const;
+  void readEntries(const std::vector<uint8_t> &archive_data,
+                   const std::function<void(struct archive *,
+                                            struct archive_entry *)> &visit)
+      const;
+  std::vector<uint8_t> readData(struct archive *a, la_int64_t size) const;
+  void writeHeader(struct archive *a, struct archive_entry *entry) const;
+  void copyData(struct archive *in, struct archive *out,
+                std::vector<uint8_t> &block, size_t buffered = 0) const;
+  std::vector<uint8_t>
+  compressZip(const std::vector<const FileEntry *> &files,
+              const std::vector<long> &duplicates) const;
+
+  static std::vector<long>
+  findDuplicates(const std::vector<const FileEntry *> &files);
 };
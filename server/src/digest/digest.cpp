@@ -0,0 +1,76 @@
+#include "digest.h"
+#include <cstdio>
+#include <openssl/evp.h>
+#include <stdexcept>
+#include <xxhash.h>
+
+namespace {
+std::string toHex(const XXH128_hash_t &hash) {
+  char hex[33];
+  std::snprintf(hex, sizeof(hex), "%016llx%016llx",
+                static_cast<unsigned long long>(hash.high64),
+                static_cast<unsigned long long>(hash.low64));
+  return std::string(hex, 32);
+}
+} // namespace
+
+ContentHasher::ContentHasher() : state_(XXH3_createState()) {
+  if (!state_) {
+    throw std::runtime_error("Failed to create hash state");
+  }
+  XXH3_128bits_reset(state_);
+}
+
+ContentHasher::~ContentHasher() { XXH3_freeState(state_); }
+
+ContentHasher &ContentHasher::update(const void *data, size_t size) {
+  XXH3_128bits_update(state_, data, size);
+  return *this;
+}
+
+ContentHasher &ContentHasher::update(const std::string &value) {
+  update(static_cast<uint64_t>(value.size()));
+  return update(value.data(), value.size());
+}
+
+ContentHasher &ContentHasher::update(const std::vector<uint8_t> &value) {
+  update(static_cast<uint64_t>(value.size()));
+  return update(value.data(), value.size());
+}
+
+ContentHasher &ContentHasher::update(uint64_t value) {
+  return update(&value, sizeof(value));
+}
+
+std::string ContentHasher::finish() const {
+  return toHex(XXH3_128bits_digest(state_));
+}
+
+std::string ContentHasher::digest(const void *data, size_t size) {
+  return toHex(XXH3_128bits(data, size));
+}
+
+std::string ContentHasher::digest(const std::vector<uint8_t> &data) {
+  return digest(data.data(), data.size());
+}
+
+std::string ContentHasher::sha256(const void *data, size_t size) {
+  unsigned char hash[EVP_MAX_MD_SIZE];
+  unsigned int length = 0;
+  if (!EVP_Digest(data, size, hash, &length, EVP_sha256(), nullptr)) {
+    throw std::runtime_error("Failed to compute SHA-256");
+  }
+
+  std::string hex;
+  hex.reserve(length * 2);
+  for (unsigned int i = 0; i < length; ++i) {
+    char byte[3];
+    std::snprintf(byte, sizeof(byte), "%02x", hash[i]);
+    hex.append(byte, 2);
+  }
+  return hex;
+}
+
+std::string ContentHasher::sha256(const std::vector<uint8_t> &data) {
+  return sha256(data.data(), data.size());
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct XXH3_state_s;
+
+class ContentHasher {
+public:
+  ContentHasher();
+  ~ContentHasher();
+
+  ContentHasher(const ContentHasher &) = delete;
+  ContentHasher &operator=(const ContentHasher &) = delete;
+
+  ContentHasher &update(const void *data, size_t size);
+  ContentHasher &update(const std::string &value);
+  ContentHasher &update(const std::vector<uint8_t> &value);
+  ContentHasher &update(uint64_t value);
+
+  std::string finish() const;
+
+  static std::string digest(const void *data, size_t size);
+  static std::string digest(const std::vector<uint8_t> &data);
+
+  // SHA-256, for keys that clients choose and that other clients' data
+  // is looked up by.
+  static std::string sha256(const void *data, size_t size);
+  static std::string sha256(const std::vector<uint8_t> &data);
+
+private:
+  XXH3_state_s *state_;
+};
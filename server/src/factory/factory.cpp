@@ -1,7 +1,14 @@
 #include "factory.h"
 #include "../compressor/compressor.h"
+#include "../zstd/seekable_zstd.h"
 #include <boost/algorithm/string.hpp>
 #include <stdexcept>
+#include <zstd.h>
+
+namespace {
+const int kMaxThreads = 256;
+const size_t kBzip2BlockUnit = 100000;
+} // namespace
 
 std::shared_ptr<LibArchiveCompressor>
 CompressorFactory::createCompressor(CompressionFormat format) {
@@ -20,6 +27,10 @@ CompressorFactory::formatFromString(const std::string &format_str) {
     return CompressionFormat::TAR_BZ2;
   if (lower_format == "7z" || lower_format == "7zip")
     return CompressionFormat::SEVEN_Z;
+  if (lower_format == "tar.zst" || lower_format == "tarzst")
+    return CompressionFormat::TAR_ZST;
+  if (lower_format == "tar.xz" || lower_format == "tarxz")
+    return CompressionFormat::TAR_XZ;
 
   throw std::runtime_error("Unknown compression format: " + format_str);
 }
@@ -34,13 +45,17 @@ std::string CompressorFactory::formatToString(CompressionFormat format) {
     return "tar.bz2";
   case CompressionFormat::SEVEN_Z:
     return "7z";
+  case CompressionFormat::TAR_ZST:
+    return "tar.zst";
+  case CompressionFormat::TAR_XZ:
+    return "tar.xz";
   default:
     return "unknown";
   }
 }
 
 std::vector<std::string> CompressorFactory::getSupportedFormats() {
-  return {"zip", "tar.gz", "tar.bz2", "7z"};
+  return {"zip", "tar.gz", "tar.bz2", "7z", "tar.zst", "tar.xz"};
 }
 
 bool CompressorFactory::isFormatSupported(const std::string &format_str) {
@@ -52,6 +67,69 @@ bool CompressorFactory::isFormatSupported(const std::string &format_str) {
   }
 }
 
+void CompressorFactory::validateOptions(CompressionFormat format,
+                                        const CompressionOptions &options) {
+  std::string name = formatToString(format);
+
+  int min_level = format == CompressionFormat::TAR_BZ2 ||
+                          format == CompressionFormat::TAR_ZST
+                      ? 1
+                      : 0;
+  int max_level = format == CompressionFormat::TAR_ZST ? ZSTD_maxCLevel() : 9;
+  if (options.level != -1 &&
+      (options.level < min_level || options.level > max_level)) {
+    throw std::runtime_error("Invalid level " + std::to_string(options.level) +
+                             " for " + name + ": expected " +
+                             std::to_string(min_level) + "-" +
+                             std::to_string(max_level));
+  }
+
+  if (options.threads < 0 || options.threads > kMaxThreads) {
+    throw std::runtime_error("Invalid threads: " +
+                             std::to_string(options.threads));
+  }
+  if (options.threads > 1 && format != CompressionFormat::TAR_ZST) {
+    throw std::runtime_error("threads is only supported for tar.zst, " + name +
+                             " compresses on one thread");
+  }
+
+  if (options.block_size) {
+    if (format == CompressionFormat::TAR_BZ2) {
+      if (options.block_size % kBzip2BlockUnit != 0 ||
+          options.block_size > 9 * kBzip2BlockUnit) {
+        throw std::runtime_error(
+            "Invalid block_size for tar.bz2: expected a multiple of 100000 "
+            "up to 900000");
+      }
+      if (options.level != -1) {
+        throw std::runtime_error(
+            "tar.bz2 takes either level or block_size, not both");
+      }
+    } else if (format == CompressionFormat::TAR_ZST) {
+      if (options.block_size < SeekableZstd::kMinFrameSize ||
+          options.block_size > SeekableZstd::kMaxFrameSize) {
+        throw std::runtime_error("Invalid block_size for tar.zst: " +
+                                 std::to_string(options.block_size));
+      }
+    } else {
+      throw std::runtime_error("block_size is not supported for " + name);
+    }
+  }
+
+  // libarchive writes every 7z archive as a single solid folder.
+  if (options.solid) {
+    bool solid = format != CompressionFormat::ZIP;
+    if (*options.solid != solid) {
+      throw std::runtime_error(std::string(solid ? "Non-solid" : "Solid") +
+                               " mode is not supported for " + name);
+    }
+  }
+
+  LibArchiveCompressor compressor(format);
+  compressor.setOptions(options);
+  compressor.checkOptions();
+}
+
 CompressionFormat CompressorFactory::detectFormatFromData(const std::vector<uint8_t> &data) {
   if (data.size() < 4) {
     throw std::runtime_error("Archive data too small to detect format");
@@ -74,6 +152,18 @@ CompressionFormat CompressorFactory::detectFormatFromData(const std::vector<uint
     return CompressionFormat::TAR_GZ;
   }
   
+  // Zstandard format - starts with 0x28B52FFD (for .tar.zst)
+  if (data[0] == 0x28 && data[1] == 0xB5 && data[2] == 0x2F &&
+      data[3] == 0xFD) {
+    return CompressionFormat::TAR_ZST;
+  }
+
+  // XZ format - starts with 0xFD377A585A00 (for .tar.xz)
+  if (data.size() >= 6 && data[0] == 0xFD && data[1] == 0x37 &&
+      data[2] == 0x7A && data[3] == 0x58 && data[4] == 0x5A && data[5] == 0) {
+    return CompressionFormat::TAR_XZ;
+  }
+
   // BZIP2 format - starts with BZ (0x425A) (for .tar.bz2)
   if (data[0] == 0x42 && data[1] == 0x5A) {
     return CompressionFormat::TAR_BZ2;
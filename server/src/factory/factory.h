@@ -15,6 +15,9 @@ public:
   static std::vector<std::string> getSupportedFormats();
 
   static bool isFormatSupported(const std::string &format_str);
+
+  static void validateOptions(CompressionFormat format,
+                              const CompressionOptions &options);
   
   static CompressionFormat detectFormatFromData(const std::vector<uint8_t> &data);
 };
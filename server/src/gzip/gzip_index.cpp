@@ -0,0 +1,287 @@
+#include "gzip_index.h"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <zlib.h>
+
+namespace {
+const size_t kChunkSize = 1 << 20;
+const int kGzipWindowBits = 15 + 16;
+const int kRawWindowBits = -15;
+const size_t kGzipTrailerSize = 8;
+
+class InflateStream {
+public:
+  InflateStream(const uint8_t *data, size_t size, uint64_t offset,
+                int window_bits)
+      : data_(data), size_(size) {
+    if (inflateInit2(&stream_, window_bits) != Z_OK) {
+      throw std::runtime_error("Failed to initialize inflate stream");
+    }
+    stream_.next_in = const_cast<Bytef *>(data_ + offset);
+  }
+
+  ~InflateStream() { inflateEnd(&stream_); }
+
+  InflateStream(const InflateStream &) = delete;
+  InflateStream &operator=(const InflateStream &) = delete;
+
+  z_stream &get() { return stream_; }
+  uint64_t position() const { return stream_.next_in - data_; }
+  bool exhausted() const {
+    return stream_.avail_in == 0 && position() == size_;
+  }
+
+  void refill() {
+    if (stream_.avail_in == 0) {
+      stream_.avail_in = std::min<uint64_t>(size_ - position(), kChunkSize);
+    }
+  }
+
+  void seek(uint64_t offset) {
+    stream_.next_in =
+        const_cast<Bytef *>(data_ + std::min<uint64_t>(offset, size_));
+    stream_.avail_in = 0;
+  }
+
+private:
+  z_stream stream_{};
+  const uint8_t *data_;
+  size_t size_;
+};
+} // namespace
+
+struct GzipIndex::Builder::State {
+  State(const uint8_t *data, size_t size, uint64_t span)
+      : data(data), size(size), span(span),
+        inflater(data, size, 0, kGzipWindowBits), window(kWindowSize, 0) {}
+
+  const uint8_t *data;
+  size_t size;
+  uint64_t span;
+  InflateStream inflater;
+  std::vector<uint8_t> window;
+  uint64_t out = 0;
+  uint64_t last = 0;
+  bool done = false;
+  GzipIndex index;
+};
+
+GzipIndex::Builder::Builder(const uint8_t *data, size_t size, uint64_t span)
+    : state_(std::make_unique<State>(data, size, span)) {
+  AccessPoint first;
+  first.member_start = true;
+  state_->index.points_.push_back(std::move(first));
+}
+
+GzipIndex::Builder::~Builder() = default;
+
+std::span<const uint8_t> GzipIndex::Builder::next() {
+  State &state = *state_;
+  z_stream &stream = state.inflater.get();
+
+  while (!state.done) {
+    state.inflater.refill();
+    if (stream.avail_out == 0) {
+      stream.next_out = state.window.data();
+      stream.avail_out = kWindowSize;
+    }
+
+    const uint8_t *begin = stream.next_out;
+    uInt before = stream.avail_out;
+    int result = inflate(&stream, Z_BLOCK);
+    size_t produced = before - stream.avail_out;
+    state.out += produced;
+
+    if (result == Z_STREAM_END) {
+      uint64_t next = state.inflater.position();
+      if (next + 1 >= state.size || state.data[next] != 0x1f ||
+          state.data[next + 1] != 0x8b) {
+        state.done = true;
+      } else {
+        inflateReset(&stream);
+
+        AccessPoint point;
+        point.in = next;
+        point.out = state.out;
+        point.member_start = true;
+        state.index.points_.push_back(std::move(point));
+        state.last = state.out;
+      }
+    } else {
+      if (result != Z_OK && result != Z_BUF_ERROR) {
+        throw std::runtime_error("Corrupt gzip stream while building index");
+      }
+      if (result == Z_BUF_ERROR && state.inflater.exhausted()) {
+        throw std::runtime_error("Truncated gzip stream while building index");
+      }
+
+      bool block_boundary =
+          (stream.data_type & 128) && !(stream.data_type & 64);
+      if (block_boundary && state.out - state.last >= state.span) {
+        AccessPoint point;
+        point.in = state.inflater.position();
+        point.out = state.out;
+        point.bits = stream.data_type & 7;
+        point.crc = static_cast<uint32_t>(stream.adler);
+        point.window.resize(kWindowSize);
+
+        size_t left = stream.avail_out;
+        std::copy(state.window.end() - left, state.window.end(),
+                  point.window.begin());
+        std::copy(state.window.begin(), state.window.end() - left,
+                  point.window.begin() + left);
+
+        state.index.points_.push_back(std::move(point));
+        state.last = state.out;
+      }
+    }
+
+    if (produced > 0) {
+      return {begin, produced};
+    }
+  }
+  return {};
+}
+
+GzipIndex GzipIndex::Builder::finish() {
+  while (!next().empty()) {
+  }
+  state_->index.uncompressed_size_ = state_->out;
+  return std::move(state_->index);
+}
+
+GzipIndex GzipIndex::build(const uint8_t *data, size_t size, uint64_t span) {
+  return Builder(data, size, span).finish();
+}
+
+std::vector<uint8_t> GzipIndex::read(const uint8_t *data, size_t size,
+                                     uint64_t offset, size_t length) const {
+  std::vector<uint8_t> output;
+  output.reserve(length);
+  inflateRange(data, size, offset, length,
+               [&output](const uint8_t *chunk, size_t count) {
+                 output.insert(output.end(), chunk, chunk + count);
+               });
+  return output;
+}
+
+void GzipIndex::inflateRange(
+    const uint8_t *data, size_t size, uint64_t offset, uint64_t length,
+    const std::function<void(const uint8_t *, size_t)> &sink) const {
+  if (offset > uncompressed_size_ || length > uncompressed_size_ - offset) {
+    throw std::runtime_error("Read beyond the end of the gzip stream");
+  }
+  if (length == 0) {
+    return;
+  }
+
+  const AccessPoint &point = pointFor(offset);
+  bool raw = !point.member_start;
+  InflateStream inflater(data, size, point.in,
+                         raw ? kRawWindowBits : kGzipWindowBits);
+  z_stream &stream = inflater.get();
+
+  if (raw) {
+    if (point.bits) {
+      inflatePrime(&stream, point.bits,
+                   data[point.in - 1] >> (8 - point.bits));
+    }
+    inflateSetDictionary(&stream, point.window.data(), point.window.size());
+  }
+
+  uint64_t skip = offset - point.out;
+  std::vector<uint8_t> buffer(
+      std::min<uint64_t>(std::max<uint64_t>(length, kWindowSize), kChunkSize));
+  uint64_t produced = 0;
+
+  while (produced < length) {
+    inflater.refill();
+    stream.next_out = buffer.data();
+    stream.avail_out = std::min<uint64_t>(skip > 0 ? skip : length - produced,
+                                          buffer.size());
+
+    uInt before = stream.avail_out;
+    int result = inflate(&stream, Z_NO_FLUSH);
+    uInt got = before - stream.avail_out;
+    if (skip > 0) {
+      skip -= got;
+    } else if (got > 0) {
+      sink(buffer.data(), got);
+      produced += got;
+    }
+
+    if (result == Z_STREAM_END) {
+      if (raw) {
+        inflater.seek(inflater.position() + kGzipTrailerSize);
+        inflateReset2(&stream, kGzipWindowBits);
+        raw = false;
+      } else {
+        inflateReset(&stream);
+      }
+      continue;
+    }
+    if (result != Z_OK && result != Z_BUF_ERROR) {
+      throw std::runtime_error("Corrupt gzip stream at offset " +
+                               std::to_string(offset));
+    }
+    if (result == Z_BUF_ERROR && inflater.exhausted()) {
+      throw std::runtime_error("Truncated gzip stream");
+    }
+  }
+}
+
+bool GzipIndex::findMember(uint64_t out_begin, uint64_t out_end,
+                           uint64_t &in_begin, uint64_t &in_end) const {
+  auto first = std::find_if(points_.begin(), points_.end(),
+                            [out_begin](const AccessPoint &point) {
+                              return point.member_start &&
+                                     point.out == out_begin;
+                            });
+  if (first == points_.end()) {
+    return false;
+  }
+
+  auto next = std::find_if(std::next(first), points_.end(),
+                           [](const AccessPoint &point) {
+                             return point.member_start;
+                           });
+  if (next == points_.end() || next->out != out_end) {
+    return false;
+  }
+
+  in_begin = first->in;
+  in_end = next->in;
+  return true;
+}
+
+size_t GzipIndex::getMemoryUsage() const {
+  size_t bytes = points_.size() * sizeof(AccessPoint);
+  for (const auto &point : points_) {
+    bytes += point.window.size();
+  }
+  return bytes;
+}
+
+const GzipIndex::AccessPoint &GzipIndex::memberFor(uint64_t offset) const {
+  auto it = std::find_if(points_.rbegin(), points_.rend(),
+                         [offset](const AccessPoint &point) {
+                           return point.member_start && point.out <= offset;
+                         });
+  if (it == points_.rend()) {
+    throw std::runtime_error("Gzip index has no access point");
+  }
+  return *it;
+}
+
+const GzipIndex::AccessPoint &GzipIndex::pointFor(uint64_t offset) const {
+  auto it = std::upper_bound(points_.begin(), points_.end(), offset,
+                             [](uint64_t value, const AccessPoint &point) {
+                               return value < point.out;
+                             });
+  if (it == points_.begin()) {
+    throw std::runtime_error("Gzip index has no access point");
+  }
+  return *std::prev(it);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+
+class GzipIndex {
+public:
+  static constexpr size_t kWindowSize = 32768;
+
+  struct AccessPoint {
+    uint64_t in = 0;
+    uint64_t out = 0;
+    int bits = 0;
+    bool member_start = false;
+    // CRC-32 of the member's data before this point.
+    uint32_t crc = 0;
+    std::vector<uint8_t> window;
+  };
+
+  // Inflates the stream once, recording access points on the way and handing
+  // the inflated bytes to the caller, so readers of the contents need no
+  // second pass.
+  class Builder {
+  public:
+    Builder(const uint8_t *data, size_t size, uint64_t span);
+    ~Builder();
+
+    Builder(const Builder &) = delete;
+    Builder &operator=(const Builder &) = delete;
+
+    // The next inflated bytes, valid until the next call; empty at the end.
+    std::span<const uint8_t> next();
+    // Inflates whatever is left and returns the index.
+    GzipIndex finish();
+
+  private:
+    struct State;
+    std::unique_ptr<State> state_;
+  };
+
+  GzipIndex() = default;
+
+  static GzipIndex build(const uint8_t *data, size_t size, uint64_t span);
+
+  std::vector<uint8_t> read(const uint8_t *data, size_t size, uint64_t offset,
+                            size_t length) const;
+
+  bool findMember(uint64_t out_begin, uint64_t out_end, uint64_t &in_begin,
+                  uint64_t &in_end) const;
+
+  const AccessPoint &pointFor(uint64_t offset) const;
+  const AccessPoint &memberFor(uint64_t offset) const;
+
+  bool empty() const { return points_.empty(); }
+  size_t getPointCount() const { return points_.size(); }
+  uint64_t getUncompressedSize() const { return uncompressed_size_; }
+  size_t getMemoryUsage() const;
+
+private:
+  std::vector<AccessPoint> points_;
+  uint64_t uncompressed_size_ = 0;
+
+  void inflateRange(const uint8_t *data, size_t size, uint64_t offset,
+                    uint64_t length,
+                    const std::function<void(const uint8_t *, size_t)> &sink)
+      const;
+};
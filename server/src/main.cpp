@@ -1,11 +1,29 @@
 #include "server/server.h"
+#include <algorithm>
 #include <iostream>
+#include <string>
+#include <thread>
 
-int main() {
-    std::cout << "Starting server on port 8080" << std::endl;
+int main(int argc, char **argv) {
+    ServerConfig config;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--per-core") {
+            config.mode = ServerMode::PER_CORE;
+            config.thread_count =
+                std::max(1u, std::thread::hardware_concurrency());
+        } else if (arg == "--pin-threads") {
+            config.pin_threads = true;
+        } else if (arg == "--latency-target-ms" && i + 1 < argc) {
+            config.latency_target_ms = std::stoi(argv[++i]);
+        }
+    }
+
+    std::cout << "Starting server on port " << config.port << std::endl;
     
     try {
-        start_server(8080, 4);
+        start_server(config);
     } catch (const std::exception& e) {
         std::cerr << "Server error: " << e.what() << std::endl;
         return 1;
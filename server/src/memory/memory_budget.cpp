@@ -0,0 +1,141 @@
+#include "memory_budget.h"
+#include <algorithm>
+
+MemoryBudget::MemoryBudget(size_t limit, size_t request_limit,
+                           std::chrono::milliseconds queue_timeout)
+    : limit_(limit), request_limit_(request_limit),
+      queue_timeout_(queue_timeout) {}
+
+MemoryBudget &MemoryBudget::instance() {
+  static MemoryBudget budget(2ULL * 1024 * 1024 * 1024, 1024ULL * 1024 * 1024,
+                             std::chrono::milliseconds(5000));
+  return budget;
+}
+
+void MemoryBudget::configure(size_t limit, size_t request_limit,
+                             std::chrono::milliseconds queue_timeout) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  limit_ = limit;
+  request_limit_ = request_limit;
+  queue_timeout_ = queue_timeout;
+}
+
+void MemoryBudget::reserve(size_t bytes) {
+  if (!tryReserve(bytes)) {
+    throw reject();
+  }
+}
+
+bool MemoryBudget::tryReserve(size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (bytes > limit_) {
+    ++rejected_;
+    throw RequestTooLarge("Request needs " + std::to_string(bytes) +
+                          " bytes, which exceeds the memory budget");
+  }
+  if (!fits(bytes)) {
+    return false;
+  }
+  commit(bytes);
+  return true;
+}
+
+void MemoryBudget::release(size_t bytes) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    usage_ = bytes > usage_ ? 0 : usage_ - bytes;
+  }
+  released_.notifyAll();
+}
+
+MemoryBudgetExceeded MemoryBudget::reject() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++rejected_;
+  int retry_after = static_cast<int>(
+      std::chrono::duration_cast<std::chrono::seconds>(queue_timeout_)
+          .count());
+  return MemoryBudgetExceeded("Server memory budget exhausted",
+                              retry_after > 0 ? retry_after : 1);
+}
+
+size_t MemoryBudget::getUsage() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return usage_;
+}
+
+size_t MemoryBudget::getHighWaterMark() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return high_water_mark_;
+}
+
+size_t MemoryBudget::getLimit() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return limit_;
+}
+
+size_t MemoryBudget::getRequestLimit() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return request_limit_;
+}
+
+size_t MemoryBudget::getRejectedCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return rejected_;
+}
+
+std::chrono::milliseconds MemoryBudget::getQueueTimeout() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return queue_timeout_;
+}
+
+bool MemoryBudget::fits(size_t bytes) const {
+  return usage_ + bytes <= limit_;
+}
+
+void MemoryBudget::commit(size_t bytes) {
+  usage_ += bytes;
+  if (usage_ > high_water_mark_) {
+    high_water_mark_ = usage_;
+  }
+}
+
+MemoryAccount::MemoryAccount(MemoryBudget &budget) : budget_(budget) {}
+
+MemoryAccount::~MemoryAccount() {
+  if (reserved_ > 0) {
+    budget_.release(reserved_);
+  }
+}
+
+void MemoryAccount::reserve(size_t bytes) {
+  if (!tryReserve(bytes)) {
+    throw budget_.reject();
+  }
+}
+
+bool MemoryAccount::tryReserve(size_t bytes) {
+  if (bytes == 0) {
+    return true;
+  }
+
+  if (reserved_ + bytes > budget_.getRequestLimit()) {
+    throw RequestTooLarge("Request exceeds the per-request memory limit of " +
+                          std::to_string(budget_.getRequestLimit()) +
+                          " bytes");
+  }
+
+  if (!budget_.tryReserve(bytes)) {
+    return false;
+  }
+  reserved_ += bytes;
+  return true;
+}
+
+void MemoryAccount::release(size_t bytes) {
+  bytes = std::min(bytes, reserved_.load());
+  if (bytes == 0) {
+    return;
+  }
+  reserved_ -= bytes;
+  budget_.release(bytes);
+}
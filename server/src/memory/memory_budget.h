@@ -0,0 +1,98 @@
+#pragma once
+
+#include "../async/wait_list.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+class MemoryBudgetExceeded : public std::runtime_error {
+public:
+  MemoryBudgetExceeded(const std::string &message, int retry_after)
+      : std::runtime_error(message), retry_after_(retry_after) {}
+
+  int getRetryAfter() const { return retry_after_; }
+
+private:
+  int retry_after_;
+};
+
+class RequestTooLarge : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+class MemoryBudget {
+public:
+  MemoryBudget(size_t limit, size_t request_limit,
+               std::chrono::milliseconds queue_timeout);
+
+  static MemoryBudget &instance();
+
+  void configure(size_t limit, size_t request_limit,
+                 std::chrono::milliseconds queue_timeout);
+
+  // Takes bytes if they fit now and throws MemoryBudgetExceeded otherwise;
+  // callers that can wait queue with asyncWaitForRelease instead.
+  void reserve(size_t bytes);
+  bool tryReserve(size_t bytes);
+  void release(size_t bytes);
+
+  // Counts a rejection and describes it, with the queue timeout as the
+  // Retry-After hint.
+  MemoryBudgetExceeded reject();
+
+  uint64_t getReleaseGeneration() const { return released_.getGeneration(); }
+
+  template <typename Executor, typename CompletionToken>
+  auto asyncWaitForRelease(const Executor &executor, uint64_t generation,
+                           WaitList::Clock::time_point deadline,
+                           CompletionToken &&token) {
+    return released_.asyncWait(executor, generation, deadline,
+                               std::forward<CompletionToken>(token));
+  }
+
+  size_t getUsage() const;
+  size_t getHighWaterMark() const;
+  size_t getLimit() const;
+  size_t getRequestLimit() const;
+  size_t getRejectedCount() const;
+  std::chrono::milliseconds getQueueTimeout() const;
+
+private:
+  mutable std::mutex mutex_;
+  WaitList released_;
+  size_t limit_;
+  size_t request_limit_;
+  std::chrono::milliseconds queue_timeout_;
+  size_t usage_ = 0;
+  size_t high_water_mark_ = 0;
+  size_t rejected_ = 0;
+
+  bool fits(size_t bytes) const;
+  void commit(size_t bytes);
+};
+
+class MemoryAccount {
+public:
+  explicit MemoryAccount(MemoryBudget &budget = MemoryBudget::instance());
+  ~MemoryAccount();
+
+  MemoryAccount(const MemoryAccount &) = delete;
+  MemoryAccount &operator=(const MemoryAccount &) = delete;
+
+  void reserve(size_t bytes);
+  // Like reserve, but returns false instead of throwing when the budget is
+  // full right now.
+  bool tryReserve(size_t bytes);
+  void release(size_t bytes);
+
+  size_t getReserved() const { return reserved_.load(); }
+  MemoryBudget &getBudget() { return budget_; }
+
+private:
+  MemoryBudget &budget_;
+  std::atomic<size_t> reserved_{0};
+};
@@ -0,0 +1,119 @@
+#include "similarity_order.h"
+#include <algorithm>
+#include <boost/algorithm/string.hpp>
+#include <limits>
+#include <map>
+#include <string>
+#include <xxhash.h>
+
+namespace {
+uint64_t mix(uint64_t value) {
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9ULL;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111ebULL;
+  return value ^ (value >> 31);
+}
+
+std::string extensionOf(const std::string &name) {
+  size_t slash = name.find_last_of('/');
+  size_t dot = name.find_last_of('.');
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+    return "";
+  }
+  return boost::algorithm::to_lower_copy(name.substr(dot + 1));
+}
+} // namespace
+
+SimilarityOrder::Signature
+SimilarityOrder::signature(const std::vector<uint8_t> &data) {
+  Signature minimums;
+  minimums.fill(std::numeric_limits<uint64_t>::max());
+
+  size_t size = std::min(data.size(), kSampleBytes);
+  size_t shingles = size >= kShingleBytes ? size - kShingleBytes + 1 : 1;
+  size_t width = std::min(size, kShingleBytes);
+
+  for (size_t i = 0; i < shingles; ++i) {
+    uint64_t hash = XXH64(data.data() + i, width, 0);
+    for (size_t k = 0; k < kSignatureSize; ++k) {
+      minimums[k] = std::min(minimums[k], mix(hash + k));
+    }
+  }
+  return minimums;
+}
+
+double SimilarityOrder::similarity(const Signature &lhs,
+                                   const Signature &rhs) {
+  size_t matches = 0;
+  for (size_t k = 0; k < kSignatureSize; ++k) {
+    matches += lhs[k] == rhs[k];
+  }
+  return static_cast<double>(matches) / kSignatureSize;
+}
+
+std::vector<size_t>
+SimilarityOrder::order(const std::vector<const FileEntry *> &files) {
+  std::vector<std::string> extensions;
+  std::map<std::string, std::vector<size_t>> groups;
+  for (size_t i = 0; i < files.size(); ++i) {
+    std::string extension = extensionOf(files[i]->name);
+    auto &group = groups[extension];
+    if (group.empty()) {
+      extensions.push_back(extension);
+    }
+    group.push_back(i);
+  }
+
+  std::vector<size_t> result;
+  result.reserve(files.size());
+
+  for (const auto &extension : extensions) {
+    const std::vector<size_t> &group = groups[extension];
+    std::vector<Signature> signatures;
+    signatures.reserve(group.size());
+    for (size_t i : group) {
+      signatures.push_back(signature(files[i]->data));
+    }
+
+    // Large groups fall back to bucketing on the first MinHash slot, which
+    // still puts likely near-duplicates together.
+    if (group.size() > kGreedyLimit) {
+      std::vector<size_t> positions(group.size());
+      for (size_t i = 0; i < positions.size(); ++i) {
+        positions[i] = i;
+      }
+      std::stable_sort(positions.begin(), positions.end(),
+                       [&](size_t lhs, size_t rhs) {
+                         return signatures[lhs][0] < signatures[rhs][0];
+                       });
+      for (size_t position : positions) {
+        result.push_back(group[position]);
+      }
+      continue;
+    }
+
+    // Greedy nearest-neighbour chain starting from the first upload.
+    std::vector<bool> placed(group.size(), false);
+    size_t current = 0;
+    for (size_t step = 0; step < group.size(); ++step) {
+      placed[current] = true;
+      result.push_back(group[current]);
+
+      double best = -1.0;
+      size_t next = current;
+      for (size_t candidate = 0; candidate < group.size(); ++candidate) {
+        if (placed[candidate]) {
+          continue;
+        }
+        double score = similarity(signatures[current], signatures[candidate]);
+        if (score > best) {
+          best = score;
+          next = candidate;
+        }
+      }
+      current = next;
+    }
+  }
+  return result;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "../compressor/compressor.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Orders entries so similar files sit next to each other inside a solid
+// stream: first by extension, then by MinHash similarity of their contents.
+class SimilarityOrder {
+public:
+  static constexpr size_t kSignatureSize = 16;
+  static constexpr size_t kSampleBytes = 64 * 1024;
+  static constexpr size_t kShingleBytes = 8;
+  static constexpr size_t kGreedyLimit = 1024;
+
+  using Signature = std::array<uint64_t, kSignatureSize>;
+
+  static Signature signature(const std::vector<uint8_t> &data);
+  static double similarity(const Signature &lhs, const Signature &rhs);
+
+  static std::vector<size_t>
+  order(const std::vector<const FileEntry *> &files);
+};
@@ -0,0 +1,196 @@
+#include "codec_planner.h"
+#include "codec_trial.h"
+#include "../factory/factory.h"
+#include <algorithm>
+#include <boost/algorithm/string.hpp>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+namespace {
+std::vector<uint8_t> calibrationData(size_t size) {
+  static const char *words[] = {"archive", "entry",  "header", "stream",
+                                "block",   "offset", "level",  "format"};
+  std::mt19937 gen(1);
+  std::vector<uint8_t> data;
+  data.reserve(size);
+
+  while (data.size() < size / 2) {
+    const char *word = words[gen() % 8];
+    data.insert(data.end(), word, word + std::char_traits<char>::length(word));
+    data.push_back(gen() % 5 ? ' ' : '\n');
+  }
+  while (data.size() < size * 3 / 4) {
+    data.push_back(gen() & 0xff);
+  }
+  data.resize(size, 0);
+  return data;
+}
+} // namespace
+
+CodecPlanner::CodecPlanner(Config config)
+    : config_(config),
+      candidates_({{CompressionFormat::TAR_GZ, 1, 60e6},
+                   {CompressionFormat::TAR_GZ, 6, 25e6},
+                   {CompressionFormat::TAR_ZST, 1, 300e6},
+                   {CompressionFormat::TAR_ZST, 3, 180e6},
+                   {CompressionFormat::TAR_ZST, 9, 50e6},
+                   {CompressionFormat::TAR_BZ2, 9, 12e6},
+                   {CompressionFormat::SEVEN_Z, 5, 4e6}}) {}
+
+CodecPlanner &CodecPlanner::instance() {
+  static CodecPlanner planner(Config{});
+  return planner;
+}
+
+Objective CodecPlanner::objectiveFromString(const std::string &name) {
+  std::string lower = boost::algorithm::to_lower_copy(name);
+  if (lower == "min_time") {
+    return Objective::MIN_TIME;
+  }
+  if (lower == "min_size") {
+    return Objective::MIN_SIZE;
+  }
+  if (lower == "balanced" || lower.empty()) {
+    return Objective::BALANCED;
+  }
+  throw std::runtime_error("Unknown objective: " + name);
+}
+
+std::string CodecPlanner::objectiveToString(Objective objective) {
+  switch (objective) {
+  case Objective::MIN_TIME:
+    return "min_time";
+  case Objective::MIN_SIZE:
+    return "min_size";
+  default:
+    return "balanced";
+  }
+}
+
+void CodecPlanner::calibrate(size_t sample_size) {
+  std::vector<uint8_t> data = calibrationData(sample_size);
+  std::vector<CodecCandidate> calibrated = getCandidates();
+
+  for (auto &candidate : calibrated) {
+    try {
+      auto start = std::chrono::steady_clock::now();
+      encodedSize(candidate, data);
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      if (elapsed.count() > 0) {
+        candidate.bytes_per_second = data.size() / elapsed.count();
+      }
+    } catch (const std::exception &e) {
+      std::cerr << "Codec calibration failed for "
+                << CompressorFactory::formatToString(candidate.format) << ": "
+                << e.what() << std::endl;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  candidates_ = std::move(calibrated);
+}
+
+CodecPlan CodecPlanner::plan(const std::vector<FileEntry> &files,
+                             Objective objective) const {
+  uint64_t total = 0;
+  for (const auto &file : files) {
+    total += file.data.size();
+  }
+
+  std::vector<CodecCandidate> candidates = getCandidates();
+  if (objective == Objective::MIN_TIME) {
+    auto fastest = std::max_element(
+        candidates.begin(), candidates.end(),
+        [](const CodecCandidate &lhs, const CodecCandidate &rhs) {
+          return lhs.bytes_per_second < rhs.bytes_per_second;
+        });
+    candidates = {*fastest};
+  }
+
+  std::vector<uint8_t> data = sample(files, total);
+  CodecPlan best;
+  best.objective = objective;
+  double best_score = std::numeric_limits<double>::infinity();
+
+  for (const auto &candidate : candidates) {
+    double ratio = 1.0;
+    if (!data.empty()) {
+      try {
+        ratio = static_cast<double>(encodedSize(candidate, data)) / data.size();
+      } catch (const std::exception &) {
+        continue;
+      }
+    }
+
+    double seconds = total / candidate.bytes_per_second;
+    double size = ratio * total;
+    double score = seconds;
+    if (objective == Objective::MIN_SIZE) {
+      score = size;
+    } else if (objective == Objective::BALANCED) {
+      score = seconds + size / config_.link_bytes_per_second;
+    }
+
+    if (score < best_score) {
+      best_score = score;
+      best.format = candidate.format;
+      best.level = candidate.level;
+      best.predicted_ratio = ratio;
+      best.predicted_seconds = seconds;
+    }
+  }
+
+  if (best_score == std::numeric_limits<double>::infinity()) {
+    throw std::runtime_error("No codec available for format=auto");
+  }
+  return best;
+}
+
+std::vector<CodecCandidate> CodecPlanner::getCandidates() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return candidates_;
+}
+
+std::vector<uint8_t> CodecPlanner::sample(const std::vector<FileEntry> &files,
+                                          uint64_t total) const {
+  size_t limit = config_.sample_block * config_.sample_blocks;
+  std::vector<uint8_t> data;
+  data.reserve(std::min<uint64_t>(total, limit));
+
+  auto copy = [&files, &data](uint64_t offset, uint64_t length) {
+    for (const auto &file : files) {
+      if (length == 0) {
+        break;
+      }
+      if (offset >= file.data.size()) {
+        offset -= file.data.size();
+        continue;
+      }
+      uint64_t count = std::min<uint64_t>(length, file.data.size() - offset);
+      data.insert(data.end(), file.data.begin() + offset,
+                  file.data.begin() + offset + count);
+      length -= count;
+      offset = 0;
+    }
+  };
+
+  if (total <= limit || config_.sample_blocks < 2) {
+    copy(0, std::min<uint64_t>(total, limit));
+    return data;
+  }
+
+  uint64_t last = total - config_.sample_block;
+  for (size_t i = 0; i < config_.sample_blocks; ++i) {
+    copy(last * i / (config_.sample_blocks - 1), config_.sample_block);
+  }
+  return data;
+}
+
+size_t CodecPlanner::encodedSize(const CodecCandidate &candidate,
+                                 const std::vector<uint8_t> &data) {
+  return encodeSample(candidate.format, candidate.level, data).size();
+}
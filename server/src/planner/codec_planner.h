@@ -0,0 +1,54 @@
+#pragma once
+
+#include "../compressor/compressor.h"
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class Objective { MIN_TIME, MIN_SIZE, BALANCED };
+
+struct CodecCandidate {
+  CompressionFormat format;
+  int level;
+  double bytes_per_second;
+};
+
+struct CodecPlan {
+  CompressionFormat format = CompressionFormat::TAR_GZ;
+  int level = -1;
+  Objective objective = Objective::BALANCED;
+  double predicted_ratio = 1.0;
+  double predicted_seconds = 0.0;
+};
+
+class CodecPlanner {
+public:
+  struct Config {
+    size_t sample_block = 64 * 1024;
+    size_t sample_blocks = 4;
+    double link_bytes_per_second = 12.5e6;
+  };
+
+  explicit CodecPlanner(Config config);
+
+  static CodecPlanner &instance();
+
+  static Objective objectiveFromString(const std::string &name);
+  static std::string objectiveToString(Objective objective);
+
+  void calibrate(size_t sample_size = 512 * 1024);
+  CodecPlan plan(const std::vector<FileEntry> &files,
+                 Objective objective) const;
+
+  std::vector<CodecCandidate> getCandidates() const;
+
+private:
+  Config config_;
+  mutable std::mutex mutex_;
+  std::vector<CodecCandidate> candidates_;
+
+  std::vector<uint8_t> sample(const std::vector<FileEntry> &files,
+                              uint64_t total) const;
+  static size_t encodedSize(const CodecCandidate &candidate,
+                            const std::vector<uint8_t> &data);
+};
@@ -0,0 +1,117 @@
+#include "codec_trial.h"
+#include <archive.h>
+#include <archive_entry.h>
+#include <stdexcept>
+#include <string>
+
+namespace {
+la_ssize_t appendOutput(struct archive *, void *client, const void *buffer,
+                        size_t length) {
+  auto *output = static_cast<std::vector<uint8_t> *>(client);
+  const auto *bytes = static_cast<const uint8_t *>(buffer);
+  output->insert(output->end(), bytes, bytes + length);
+  return length;
+}
+
+int addFilter(struct archive *a, CompressionFormat format) {
+  switch (format) {
+  case CompressionFormat::ZIP:
+  case CompressionFormat::TAR_GZ:
+    return archive_write_add_filter_gzip(a);
+  case CompressionFormat::TAR_BZ2:
+    return archive_write_add_filter_bzip2(a);
+  case CompressionFormat::TAR_ZST:
+    return archive_write_add_filter_zstd(a);
+  case CompressionFormat::SEVEN_Z:
+  case CompressionFormat::TAR_XZ:
+    return archive_write_add_filter_xz(a);
+  default:
+    return ARCHIVE_FATAL;
+  }
+}
+
+std::string errorOf(struct archive *a) {
+  const char *error = archive_error_string(a);
+  return error ? error : "unknown error";
+}
+} // namespace
+
+std::vector<uint8_t> encodeSample(CompressionFormat format, int level,
+                                  const std::vector<uint8_t> &data) {
+  std::vector<uint8_t> encoded;
+  struct archive *a = archive_write_new();
+  if (!a) {
+    throw std::runtime_error("Failed to create archive");
+  }
+
+  try {
+    std::string level_option = std::to_string(level);
+    archive_write_set_format_raw(a);
+    if (addFilter(a, format) != ARCHIVE_OK ||
+        (level >= 0 &&
+         archive_write_set_filter_option(a, nullptr, "compression-level",
+                                         level_option.c_str()) != ARCHIVE_OK)) {
+      throw std::runtime_error("Codec is not available: " + errorOf(a));
+    }
+    archive_write_set_bytes_per_block(a, 0);
+    if (archive_write_open(a, &encoded, nullptr, appendOutput, nullptr) !=
+        ARCHIVE_OK) {
+      throw std::runtime_error("Failed to open archive for writing: " +
+                               errorOf(a));
+    }
+
+    struct archive_entry *entry = archive_entry_new();
+    archive_entry_set_pathname(entry, "sample");
+    archive_entry_set_size(entry, data.size());
+    archive_entry_set_mode(entry, AE_IFREG | 0644);
+    int status = archive_write_header(a, entry);
+    archive_entry_free(entry);
+
+    if (status != ARCHIVE_OK ||
+        archive_write_data(a, data.data(), data.size()) < 0 ||
+        archive_write_close(a) != ARCHIVE_OK) {
+      throw std::runtime_error("Failed to encode sample: " + errorOf(a));
+    }
+    archive_write_free(a);
+  } catch (...) {
+    archive_write_free(a);
+    throw;
+  }
+  return encoded;
+}
+
+std::vector<uint8_t> decodeSample(const std::vector<uint8_t> &encoded,
+                                  size_t size_hint) {
+  std::vector<uint8_t> decoded;
+  decoded.reserve(size_hint);
+
+  struct archive *a = archive_read_new();
+  if (!a) {
+    throw std::runtime_error("Failed to create archive reader");
+  }
+
+  try {
+    archive_read_support_filter_all(a);
+    archive_read_support_format_raw(a);
+    struct archive_entry *entry = nullptr;
+    if (archive_read_open_memory(a, encoded.data(), encoded.size()) !=
+            ARCHIVE_OK ||
+        archive_read_next_header(a, &entry) != ARCHIVE_OK) {
+      throw std::runtime_error("Failed to decode sample: " + errorOf(a));
+    }
+
+    std::vector<uint8_t> block(64 * 1024);
+    la_ssize_t read;
+    while ((read = archive_read_data(a, block.data(), block.size())) > 0) {
+      decoded.insert(decoded.end(), block.begin(), block.begin() + read);
+    }
+    if (read < 0) {
+      throw std::runtime_error("Failed to decode sample: " + errorOf(a));
+    }
+    archive_read_free(a);
+  } catch (...) {
+    archive_read_free(a);
+    throw;
+  }
+  return decoded;
+}
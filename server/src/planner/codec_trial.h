@@ -0,0 +1,13 @@
+#pragma once
+
+#include "../compressor/compressor.h"
+#include <cstdint>
+#include <vector>
+
+// Runs the codec behind a format over a bare byte stream, without the
+// container. 7z is approximated with xz and zip with gzip; tar.xz prefilters
+// are not applied.
+std::vector<uint8_t> encodeSample(CompressionFormat format, int level,
+                                  const std::vector<uint8_t> &data);
+std::vector<uint8_t> decodeSample(const std::vector<uint8_t> &encoded,
+                                  size_t size_hint);
@@ -0,0 +1,210 @@
+#include "size_estimator.h"
+#include "codec_trial.h"
+#include "../factory/factory.h"
+#include "../server/cpu_pool.h"
+#include <algorithm>
+#include <boost/algorithm/string.hpp>
+#include <chrono>
+#include <cmath>
+#include <map>
+
+namespace {
+struct Observation {
+  double bytes = 0.0;
+  double encoded = 0.0;
+  double compress_seconds = 0.0;
+  double extract_seconds = 0.0;
+};
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+} // namespace
+
+SizeEstimator::SizeEstimator(Config config) : config_(config) {
+  if (config_.fraction <= 0.0 || config_.fraction > 1.0) {
+    throw std::runtime_error("Invalid sample fraction: " +
+                             std::to_string(config_.fraction));
+  }
+}
+
+std::string SizeEstimator::stratumOf(const std::string &name) {
+  size_t slash = name.find_last_of('/');
+  std::string base = slash == std::string::npos ? name : name.substr(slash + 1);
+  size_t dot = base.find_last_of('.');
+  if (dot == std::string::npos || dot == 0) {
+    return "";
+  }
+  return boost::algorithm::to_lower_copy(base.substr(dot + 1));
+}
+
+EstimateReport
+SizeEstimator::estimate(const std::vector<FileEntry> &files) const {
+  std::map<std::string, Stratum> by_type;
+  for (const auto &file : files) {
+    Stratum &stratum = by_type[stratumOf(file.name)];
+    stratum.files.push_back(&file);
+    stratum.bytes += file.data.size();
+  }
+
+  std::vector<Stratum> strata;
+  for (auto &[type, stratum] : by_type) {
+    strata.push_back(std::move(stratum));
+  }
+  std::vector<Chunk> chunks = sample(strata);
+  for (const auto &chunk : chunks) {
+    strata[chunk.stratum].sampled += chunk.data.size();
+  }
+
+  EstimateReport report;
+  report.strata = strata.size();
+  for (const auto &stratum : strata) {
+    report.input_bytes += stratum.bytes;
+    report.sampled_bytes += stratum.sampled;
+  }
+
+  std::vector<std::string> names = CompressorFactory::getSupportedFormats();
+  report.formats.resize(names.size());
+  auto run = [&](size_t i) {
+    CompressionFormat format = CompressorFactory::formatFromString(names[i]);
+    try {
+      report.formats[i] = project(format, files, strata, chunks);
+    } catch (const std::exception &e) {
+      report.formats[i].format = format;
+      report.formats[i].error = e.what();
+    }
+  };
+
+  CpuPool::instance().parallelFor(names.size(), 0, run);
+  return report;
+}
+
+std::vector<SizeEstimator::Chunk>
+SizeEstimator::sample(const std::vector<Stratum> &strata) const {
+  std::vector<Chunk> chunks;
+
+  for (size_t s = 0; s < strata.size(); ++s) {
+    const Stratum &stratum = strata[s];
+    if (stratum.bytes == 0) {
+      continue;
+    }
+
+    uint64_t budget = std::min<uint64_t>(
+        stratum.bytes,
+        std::max<uint64_t>(config_.min_stratum_sample,
+                           std::ceil(stratum.bytes * config_.fraction)));
+    uint64_t chunk_size = std::min<uint64_t>(config_.chunk_size, stratum.bytes);
+    size_t count = std::max<uint64_t>(
+        stratum.bytes > chunk_size ? 2 : 1,
+        (budget + chunk_size - 1) / chunk_size);
+
+    // Chunks are spread evenly over the stratum as if its files were one
+    // stream, so large files get proportionally more of them.
+    uint64_t last = stratum.bytes - chunk_size;
+    for (size_t i = 0; i < count; ++i) {
+      uint64_t offset = count > 1 ? last * i / (count - 1) : 0;
+      uint64_t length = chunk_size;
+      Chunk chunk{s, {}};
+      chunk.data.reserve(length);
+      for (const FileEntry *file : stratum.files) {
+        if (length == 0) {
+          break;
+        }
+        if (offset >= file->data.size()) {
+          offset -= file->data.size();
+          continue;
+        }
+        uint64_t take = std::min<uint64_t>(length, file->data.size() - offset);
+        chunk.data.insert(chunk.data.end(), file->data.begin() + offset,
+                          file->data.begin() + offset + take);
+        length -= take;
+        offset = 0;
+      }
+      chunks.push_back(std::move(chunk));
+    }
+  }
+  return chunks;
+}
+
+FormatEstimate SizeEstimator::project(CompressionFormat format,
+                                      const std::vector<FileEntry> &files,
+                                      const std::vector<Stratum> &strata,
+                                      const std::vector<Chunk> &chunks) const {
+  std::vector<std::vector<Observation>> observed(strata.size());
+  for (const auto &chunk : chunks) {
+    Observation observation;
+    observation.bytes = chunk.data.size();
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<uint8_t> encoded = encodeSample(format, -1, chunk.data);
+    observation.compress_seconds = secondsSince(start);
+    observation.encoded = encoded.size();
+
+    start = std::chrono::steady_clock::now();
+    decodeSample(encoded, chunk.data.size());
+    observation.extract_seconds = secondsSince(start);
+
+    observed[chunk.stratum].push_back(observation);
+  }
+
+  // Each metric is projected with a ratio estimator per stratum; the
+  // variances of the strata add up to the variance of the total.
+  auto projectMetric = [&](double Observation::*metric) {
+    double total = 0.0;
+    double variance = 0.0;
+    for (size_t s = 0; s < strata.size(); ++s) {
+      const auto &samples = observed[s];
+      if (samples.empty()) {
+        continue;
+      }
+
+      double x = 0.0;
+      double y = 0.0;
+      for (const auto &sample : samples) {
+        x += sample.bytes;
+        y += sample.*metric;
+      }
+      double ratio = y / x;
+      total += ratio * strata[s].bytes;
+
+      size_t n = samples.size();
+      double covered = std::min(1.0, x / strata[s].bytes);
+      if (n < 2 || covered >= 1.0) {
+        continue;
+      }
+      double residuals = 0.0;
+      for (const auto &sample : samples) {
+        double residual = sample.*metric - ratio * sample.bytes;
+        residuals += residual * residual;
+      }
+      double mean_bytes = x / n;
+      double ratio_variance = (1.0 - covered) * residuals / (n - 1) /
+                              (n * mean_bytes * mean_bytes);
+      variance += ratio_variance * strata[s].bytes * strata[s].bytes;
+    }
+
+    double margin = config_.confidence_z * std::sqrt(variance);
+    return Interval{total, std::max(0.0, total - margin), total + margin};
+  };
+
+  FormatEstimate estimate;
+  estimate.format = format;
+  estimate.size = projectMetric(&Observation::encoded);
+  estimate.compress_seconds = projectMetric(&Observation::compress_seconds);
+  estimate.extract_seconds = projectMetric(&Observation::extract_seconds);
+
+  // Headers and directories are measured exactly on an archive of empty
+  // entries with the real names.
+  std::vector<FileEntry> headers;
+  headers.reserve(files.size());
+  for (const auto &file : files) {
+    headers.emplace_back(file.name, std::vector<uint8_t>());
+  }
+  double overhead = LibArchiveCompressor(format).compress(headers).size();
+  estimate.size.estimate += overhead;
+  estimate.size.low += overhead;
+  estimate.size.high += overhead;
+  return estimate;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "../compressor/compressor.h"
+#include <string>
+#include <vector>
+
+struct Interval {
+  double estimate = 0.0;
+  double low = 0.0;
+  double high = 0.0;
+};
+
+struct FormatEstimate {
+  CompressionFormat format = CompressionFormat::ZIP;
+  Interval size;
+  Interval compress_seconds;
+  Interval extract_seconds;
+  std::string error;
+};
+
+struct EstimateReport {
+  uint64_t input_bytes = 0;
+  uint64_t sampled_bytes = 0;
+  size_t strata = 0;
+  std::vector<FormatEstimate> formats;
+};
+
+class SizeEstimator {
+public:
+  struct Config {
+    double fraction = 0.05;
+    size_t chunk_size = 16 * 1024;
+    size_t min_stratum_sample = 64 * 1024;
+    double confidence_z = 1.96;
+  };
+
+  explicit SizeEstimator(Config config);
+
+  EstimateReport estimate(const std::vector<FileEntry> &files) const;
+
+private:
+  struct Chunk {
+    size_t stratum;
+    std::vector<uint8_t> data;
+  };
+
+  struct Stratum {
+    std::vector<const FileEntry *> files;
+    uint64_t bytes = 0;
+    uint64_t sampled = 0;
+  };
+
+  Config config_;
+
+  static std::string stratumOf(const std::string &name);
+  std::vector<Chunk> sample(const std::vector<Stratum> &strata) const;
+  FormatEstimate project(CompressionFormat format,
+                         const std::vector<FileEntry> &files,
+                         const std::vector<Stratum> &strata,
+                         const std::vector<Chunk> &chunks) const;
+};
@@ -1,4 +1,6 @@
 #include "processor.h"
+#include "../factory/factory.h"
+#include "../server/cpu_pool.h"
 #include <iostream>
 #include <stdexcept>
 
@@ -7,6 +9,44 @@ ArchiveProcessor::ArchiveProcessor(
     std::shared_ptr<LibArchiveCompressor> compressor)
     : request_(request), compressor_(std::move(compressor)) {
   validateRequest();
+  configure(*compressor_, request_);
+}
+
+std::vector<std::vector<uint8_t>>
+ArchiveProcessor::compressFormats(const ArchiveRequest &request,
+                                  const std::vector<CompressionFormat> &formats) {
+  if (request.files.empty()) {
+    throw std::runtime_error("No files specified for compression");
+  }
+
+  std::vector<std::vector<uint8_t>> archives(formats.size());
+  CpuPool::instance().parallelFor(formats.size(), 0, [&](size_t i) {
+    auto compressor = CompressorFactory::createCompressor(formats[i]);
+    configure(*compressor, request);
+    archives[i] = compressor->compress(request.files);
+  });
+
+  std::cout << "Compressed " << request.files.size() << " files into "
+            << formats.size() << " formats" << std::endl;
+  return archives;
+}
+
+std::vector<size_t> ArchiveProcessor::entryOrder(const ArchiveRequest &request) {
+  auto compressor = CompressorFactory::createCompressor(request.format);
+  configure(*compressor, request);
+  return compressor->entryOrder(request.files);
+}
+
+void ArchiveProcessor::configure(LibArchiveCompressor &compressor,
+                                 const ArchiveRequest &request) {
+  compressor.setMemoryAccount(request.memory);
+  compressor.setReproducible(request.reproducible, request.mtime);
+  compressor.setDeduplicate(request.deduplicate);
+  compressor.setEntryFilter(request.filter);
+  compressor.setFrameSize(request.frame_size);
+  compressor.setOptions(request.options);
+  compressor.setStoreIncompressible(request.store_incompressible);
+  compressor.setOrderBySimilarity(request.order_by_similarity);
 }
 
 void ArchiveProcessor::process() {
@@ -24,6 +64,10 @@ void ArchiveProcessor::process() {
       performExtraction();
       break;
 
+    case ArchiveOperation::CONVERT:
+      performConversion();
+      break;
+
     default:
       throw std::runtime_error("Unknown archive operation");
     }
@@ -57,6 +101,12 @@ void ArchiveProcessor::validateRequest() {
     }
     break;
 
+  case ArchiveOperation::CONVERT:
+    if (request_.archive_data.empty()) {
+      throw std::runtime_error("No archive data specified for conversion");
+    }
+    break;
+
   default:
     throw std::runtime_error("Unknown archive operation");
   }
@@ -79,3 +129,13 @@ void ArchiveProcessor::performExtraction() {
   std::cout << "Extraction completed. Extracted " << extracted_files_.size()
             << " files" << std::endl;
 }
+
+void ArchiveProcessor::performConversion() {
+  std::cout << "Converting archive (" << request_.archive_data.size()
+            << " bytes) to " << compressor_->getFormatName() << "..."
+            << std::endl;
+
+  archive_data_ = compressor_->convert(request_.archive_data);
+  std::cout << "Conversion completed. Archive size: " << archive_data_.size()
+            << std::endl;
+}
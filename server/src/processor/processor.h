@@ -1,11 +1,12 @@
 #pragma once
 
 #include "../compressor/compressor.h"
+#include "../memory/memory_budget.h"
 #include <memory>
 #include <string>
 #include <vector>
 
-enum class ArchiveOperation { COMPRESS, EXTRACT };
+enum class ArchiveOperation { COMPRESS, EXTRACT, CONVERT };
 
 struct ArchiveRequest {
   ArchiveOperation operation;
@@ -14,6 +15,16 @@ struct ArchiveRequest {
   std::vector<FileEntry> files;
   std::vector<uint8_t> archive_data;
   std::string extract_path;
+  MemoryAccount *memory = nullptr;
+  bool reproducible = false;
+  time_t mtime = 315532800;
+  bool deduplicate = false;
+  EntryFilter filter;
+  size_t frame_size = 1024 * 1024;
+  CompressionOptions options;
+  bool store_incompressible = false;
+  bool order_by_similarity = false;
+  std::vector<CompressionFormat> formats;
 
   ArchiveRequest()
       : operation(ArchiveOperation::COMPRESS), format(CompressionFormat::ZIP) {}
@@ -35,6 +46,14 @@ public:
   ArchiveOperation getOperation() const { return request_.operation; }
 
   size_t getInputFilesCount() const { return request_.files.size(); }
+  const CompressStats &getCompressStats() const {
+    return compressor_->getStats();
+  }
+
+  static std::vector<std::vector<uint8_t>>
+  compressFormats(const ArchiveRequest &request,
+                  const std::vector<CompressionFormat> &formats);
+  static std::vector<size_t> entryOrder(const ArchiveRequest &request);
 
 private:
   ArchiveRequest request_;
@@ -44,7 +63,10 @@ private:
 
   bool processed_ = false;
 
+  static void configure(LibArchiveCompressor &compressor,
+                        const ArchiveRequest &request);
   void validateRequest();
   void performCompression();
   void performExtraction();
+  void performConversion();
 };
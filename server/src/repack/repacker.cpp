@@ -0,0 +1,185 @@
+#include "repacker.h"
+#include "../memory/memory_budget.h"
+#include "../store/archive_store.h"
+#include <stdexcept>
+#include <zlib.h>
+
+namespace {
+const int kGzipWindowBits = MAX_WBITS + 16;
+
+std::vector<uint8_t> gzipMember(const std::vector<uint8_t> &data) {
+  z_stream stream{};
+  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                   kGzipWindowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    throw std::runtime_error("Failed to initialize gzip stream");
+  }
+
+  std::vector<uint8_t> output(deflateBound(&stream, data.size()));
+  stream.next_in = const_cast<Bytef *>(data.data());
+  stream.avail_in = data.size();
+  stream.next_out = output.data();
+  stream.avail_out = output.size();
+
+  int result = deflate(&stream, Z_FINISH);
+  output.resize(stream.total_out);
+  deflateEnd(&stream);
+
+  if (result != Z_STREAM_END) {
+    throw std::runtime_error("Failed to compress gzip member");
+  }
+  return output;
+}
+} // namespace
+
+Repacker::Repacker(CompressionFormat format, time_t mtime,
+                   MemoryAccount *memory)
+    : format_(format), mtime_(mtime), memory_(memory) {
+  if (!supportsFormat(format)) {
+    throw std::runtime_error("Repack output must be zip or tar.gz");
+  }
+
+  if (format_ == CompressionFormat::ZIP) {
+    zip_ = std::make_unique<ZipWriter>(mtime_);
+    return;
+  }
+
+  tar_ = archive_write_new();
+  if (!tar_) {
+    throw std::runtime_error("Failed to create archive");
+  }
+  archive_write_set_format_gnutar(tar_);
+  archive_write_add_filter_none(tar_);
+  archive_write_set_bytes_per_block(tar_, 0);
+
+  if (archive_write_open(tar_, this, nullptr, writeTar, nullptr) !=
+      ARCHIVE_OK) {
+    std::string error = archive_error_string(tar_);
+    archive_write_free(tar_);
+    throw std::runtime_error("Failed to open archive for writing: " + error);
+  }
+}
+
+Repacker::~Repacker() {
+  if (tar_) {
+    archive_write_free(tar_);
+  }
+}
+
+bool Repacker::supportsFormat(CompressionFormat format) {
+  return format == CompressionFormat::ZIP ||
+         format == CompressionFormat::TAR_GZ;
+}
+
+bool Repacker::add(const StoredArchive &archive,
+                   const ArchiveEntryInfo &entry) {
+  if (!names_.insert(entry.name).second) {
+    return false;
+  }
+
+  if (zip_) {
+    addZip(archive, entry);
+  } else {
+    addTarGz(archive, entry);
+  }
+  ++stats_.entries;
+  return true;
+}
+
+std::vector<uint8_t> Repacker::finish() {
+  if (zip_) {
+    return zip_->finish();
+  }
+
+  if (archive_write_close(tar_) != ARCHIVE_OK) {
+    throw std::runtime_error("Failed to close archive: " +
+                             std::string(archive_error_string(tar_)));
+  }
+  flushMember();
+  return std::move(output_);
+}
+
+void Repacker::addZip(const StoredArchive &archive,
+                      const ArchiveEntryInfo &entry) {
+  const ZipEntry *source = archive.findZipEntry(entry);
+  if (source && ZipReader::canRead(*source)) {
+    const SharedBuffer &data = archive.getData();
+    ZipReader reader(data->data(), data->size());
+    uint64_t payload = reader.payloadOffset(*source);
+
+    reserve(source->compressed_size);
+    zip_->addRaw(entry.name, source->method, source->crc, source->size,
+                 data->data() + payload, source->compressed_size);
+    ++stats_.copied;
+    stats_.copied_bytes += source->compressed_size;
+    return;
+  }
+
+  zip_->addEntry(entry.name, archive.readEntry(entry, memory_));
+  ++stats_.recompressed;
+}
+
+void Repacker::addTarGz(const StoredArchive &archive,
+                        const ArchiveEntryInfo &entry) {
+  uint64_t begin = 0;
+  uint64_t end = 0;
+  if (archive.findGzipMember(entry, begin, end)) {
+    const uint8_t *member = archive.getData()->data();
+    reserve(end - begin);
+    output_.insert(output_.end(), member + begin, member + end);
+    ++stats_.copied;
+    stats_.copied_bytes += end - begin;
+    return;
+  }
+
+  std::vector<uint8_t> data = archive.readEntry(entry, memory_);
+
+  struct archive_entry *header = archive_entry_new();
+  archive_entry_set_pathname(header, entry.name.c_str());
+  archive_entry_set_size(header, data.size());
+  archive_entry_set_mode(header, AE_IFREG | 0644);
+  archive_entry_set_mtime(header, mtime_, 0);
+
+  int status = archive_write_header(tar_, header);
+  archive_entry_free(header);
+  if (status != ARCHIVE_OK) {
+    throw std::runtime_error("Failed to write file header: " +
+                             std::string(archive_error_string(tar_)));
+  }
+  if (!data.empty() &&
+      archive_write_data(tar_, data.data(), data.size()) < 0) {
+    throw std::runtime_error("Failed to write file data: " +
+                             std::string(archive_error_string(tar_)));
+  }
+  if (archive_write_finish_entry(tar_) != ARCHIVE_OK) {
+    throw std::runtime_error("Failed to finish entry: " +
+                             std::string(archive_error_string(tar_)));
+  }
+
+  flushMember();
+  ++stats_.recompressed;
+}
+
+void Repacker::flushMember() {
+  if (pending_.empty()) {
+    return;
+  }
+
+  std::vector<uint8_t> member = gzipMember(pending_);
+  pending_.clear();
+  reserve(member.size());
+  output_.insert(output_.end(), member.begin(), member.end());
+}
+
+void Repacker::reserve(size_t bytes) {
+  if (memory_) {
+    memory_->reserve(bytes);
+  }
+}
+
+la_ssize_t Repacker::writeTar(struct archive *, void *client,
+                              const void *data, size_t size) {
+  auto *repacker = static_cast<Repacker *>(client);
+  const auto *bytes = static_cast<const uint8_t *>(data);
+  repacker->pending_.insert(repacker->pending_.end(), bytes, bytes + size);
+  return size;
+}
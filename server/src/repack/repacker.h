@@ -0,0 +1,57 @@
+#pragma once
+
+#include "../compressor/compressor.h"
+#include "../zip/zip_writer.h"
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+struct ArchiveEntryInfo;
+class MemoryAccount;
+class StoredArchive;
+
+struct RepackStats {
+  size_t entries = 0;
+  size_t copied = 0;
+  size_t recompressed = 0;
+  uint64_t copied_bytes = 0;
+};
+
+class Repacker {
+public:
+  Repacker(CompressionFormat format, time_t mtime,
+           MemoryAccount *memory = nullptr);
+  ~Repacker();
+
+  Repacker(const Repacker &) = delete;
+  Repacker &operator=(const Repacker &) = delete;
+
+  static bool supportsFormat(CompressionFormat format);
+
+  bool add(const StoredArchive &archive, const ArchiveEntryInfo &entry);
+  std::vector<uint8_t> finish();
+
+  const RepackStats &getStats() const { return stats_; }
+
+private:
+  CompressionFormat format_;
+  time_t mtime_;
+  MemoryAccount *memory_;
+  std::unique_ptr<ZipWriter> zip_;
+  struct archive *tar_ = nullptr;
+  std::vector<uint8_t> pending_;
+  std::vector<uint8_t> output_;
+  std::unordered_set<std::string> names_;
+  RepackStats stats_;
+
+  void addZip(const StoredArchive &archive, const ArchiveEntryInfo &entry);
+  void addTarGz(const StoredArchive &archive, const ArchiveEntryInfo &entry);
+  void flushMember();
+  void reserve(size_t bytes);
+
+  static la_ssize_t writeTar(struct archive *a, void *client, const void *data,
+                             size_t size);
+};
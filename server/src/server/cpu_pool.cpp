@@ -0,0 +1,92 @@
+#include "cpu_pool.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+CpuPool::CpuPool(int thread_count)
+    : pool_(std::make_unique<boost::asio::thread_pool>(thread_count)),
+      thread_count_(thread_count) {}
+
+CpuPool::~CpuPool() { pool_->join(); }
+
+CpuPool &CpuPool::instance() {
+  static CpuPool pool(
+      static_cast<int>(std::max(1u, std::thread::hardware_concurrency())));
+  return pool;
+}
+
+void CpuPool::configure(int thread_count) {
+  if (thread_count == thread_count_) {
+    return;
+  }
+  pool_->join();
+  pool_ = std::make_unique<boost::asio::thread_pool>(thread_count);
+  thread_count_ = thread_count;
+}
+
+namespace {
+// Shared with the helpers. A helper that starts after the caller has returned
+// finds no index left, so it never touches the task.
+struct ParallelFor {
+  const std::function<void(size_t)> *task;
+  size_t count;
+  std::atomic<size_t> next{0};
+  std::mutex mutex;
+  std::condition_variable idle;
+  size_t active = 0;
+  std::exception_ptr error;
+
+  void work() {
+    for (size_t i; (i = next++) < count;) {
+      try {
+        (*task)(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        next = count;
+      }
+    }
+  }
+};
+} // namespace
+
+void CpuPool::parallelFor(size_t count, size_t max_workers,
+                          const std::function<void(size_t)> &task) {
+  size_t workers =
+      std::min(count, max_workers ? max_workers : thread_count_ + size_t(1));
+  if (workers <= 1) {
+    for (size_t i = 0; i < count; ++i) {
+      task(i);
+    }
+    return;
+  }
+
+  auto state = std::make_shared<ParallelFor>();
+  state->task = &task;
+  state->count = count;
+  for (size_t i = 1; i < workers; ++i) {
+    boost::asio::post(*pool_, [state]() {
+      {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        ++state->active;
+      }
+      state->work();
+      std::lock_guard<std::mutex> lock(state->mutex);
+      if (--state->active == 0) {
+        state->idle.notify_all();
+      }
+    });
+  }
+  state->work();
+
+  // Only helpers that started can still hold an index; the rest will find
+  // none left.
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->idle.wait(lock, [&state]() { return state->active == 0; });
+  if (state->error) {
+    std::rethrow_exception(state->error);
+  }
+}
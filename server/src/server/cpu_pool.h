@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <functional>
+#include <memory>
+
+class CpuPool {
+public:
+  explicit CpuPool(int thread_count);
+  ~CpuPool();
+
+  static CpuPool &instance();
+
+  void configure(int thread_count);
+
+  // Runs the coroutine function returns on the pool; the caller resumes on
+  // its own executor once it has finished, with its exception if it threw.
+  template <typename Function>
+  boost::asio::awaitable<void> run(Function function) {
+    ++pending_;
+    struct Done {
+      std::atomic<size_t> &pending;
+      ~Done() { --pending; }
+    } done{pending_};
+
+    co_await boost::asio::co_spawn(pool_->get_executor(), std::move(function),
+                                   boost::asio::use_awaitable);
+  }
+
+  // Calls task(0) .. task(count - 1) on up to max_workers threads, all of
+  // the pool's when 0, and rethrows the first exception. The calling thread
+  // takes indices too, so this finishes even when every pool thread is busy,
+  // including when it is called from one of them.
+  void parallelFor(size_t count, size_t max_workers,
+                   const std::function<void(size_t)> &task);
+
+  boost::asio::thread_pool::executor_type getExecutor() const {
+    return pool_->get_executor();
+  }
+
+  size_t getPending() const { return pending_.load(); }
+  int getThreadCount() const { return thread_count_; }
+
+private:
+  std::unique_ptr<boost::asio::thread_pool> pool_;
+  int thread_count_;
+  std::atomic<size_t> pending_{0};
+};
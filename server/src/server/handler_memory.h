@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <new>
+
+// Per-connection memory for the response's header fields. Freed blocks go
+// back to a free list for their size class, so once a connection has served a
+// request, later responses of the same shape reuse the same blocks instead of
+// touching the heap. Not thread-safe: only one thread may fill or write the
+// response at a time.
+class HandlerMemory {
+public:
+  static constexpr std::size_t kMinBlock = 64;
+  static constexpr std::size_t kClassCount = 11; // 64 B .. 64 KiB
+
+  HandlerMemory() = default;
+
+  HandlerMemory(const HandlerMemory &) = delete;
+  HandlerMemory &operator=(const HandlerMemory &) = delete;
+
+  ~HandlerMemory() {
+    for (auto *&head : free_) {
+      while (head) {
+        FreeBlock *next = head->next;
+        ::operator delete(head);
+        head = next;
+      }
+    }
+  }
+
+  void *allocate(std::size_t size) {
+    std::size_t index = classFor(size);
+    if (index == kClassCount) {
+      ++fallbacks_;
+      return ::operator new(size);
+    }
+    if (FreeBlock *block = free_[index]) {
+      free_[index] = block->next;
+      return block;
+    }
+    return ::operator new(kMinBlock << index);
+  }
+
+  void deallocate(void *pointer, std::size_t size) {
+    std::size_t index = classFor(size);
+    if (index == kClassCount) {
+      ::operator delete(pointer);
+      return;
+    }
+    free_[index] = ::new (pointer) FreeBlock{free_[index]};
+  }
+
+  // Allocations too large for any size class.
+  std::size_t getFallbackCount() const { return fallbacks_; }
+
+private:
+  struct FreeBlock {
+    FreeBlock *next;
+  };
+
+  static std::size_t classFor(std::size_t size) {
+    std::size_t index = 0;
+    while (index < kClassCount && (kMinBlock << index) < size) {
+      ++index;
+    }
+    return index;
+  }
+
+  std::array<FreeBlock *, kClassCount> free_{};
+  std::size_t fallbacks_ = 0;
+};
+
+// Allocates from a HandlerMemory, or from the heap when there is none.
+template <typename T> class HandlerAllocator {
+public:
+  using value_type = T;
+
+  HandlerAllocator() noexcept : memory_(nullptr) {}
+  explicit HandlerAllocator(HandlerMemory *memory) noexcept : memory_(memory) {}
+
+  template <typename U>
+  HandlerAllocator(const HandlerAllocator<U> &other) noexcept
+      : memory_(other.memory_) {}
+
+  T *allocate(std::size_t n) const {
+    std::size_t size = sizeof(T) * n;
+    return static_cast<T *>(memory_ ? memory_->allocate(size)
+                                    : ::operator new(size));
+  }
+
+  void deallocate(T *pointer, std::size_t n) const {
+    if (memory_) {
+      memory_->deallocate(pointer, sizeof(T) * n);
+    } else {
+      ::operator delete(pointer);
+    }
+  }
+
+  bool operator==(const HandlerAllocator &other) const noexcept {
+    return memory_ == other.memory_;
+  }
+
+  bool operator!=(const HandlerAllocator &other) const noexcept {
+    return memory_ != other.memory_;
+  }
+
+private:
+  template <typename> friend class HandlerAllocator;
+
+  HandlerMemory *memory_;
+};
@@ -0,0 +1,130 @@
+#include "level_governor.h"
+#include "../factory/factory.h"
+#include "../zstd/seekable_zstd.h"
+#include <algorithm>
+
+namespace {
+const double kSmoothing = 0.2;
+
+// Seconds per input byte at the default level, before anything is measured.
+double baseSecondsPerByte(CompressionFormat format) {
+  switch (format) {
+  case CompressionFormat::TAR_BZ2:
+    return 60e-9;
+  case CompressionFormat::SEVEN_Z:
+  case CompressionFormat::TAR_XZ:
+    return 80e-9;
+  case CompressionFormat::TAR_ZST:
+    return 5e-9;
+  default:
+    return 20e-9;
+  }
+}
+} // namespace
+
+LevelGovernor::LevelGovernor(Config config) : config_(config) {}
+
+LevelGovernor &LevelGovernor::instance() {
+  static LevelGovernor governor(Config{});
+  return governor;
+}
+
+void LevelGovernor::configure(Config config) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  config_ = config;
+}
+
+int LevelGovernor::defaultLevel(CompressionFormat format) {
+  switch (format) {
+  case CompressionFormat::TAR_BZ2:
+    return 9;
+  case CompressionFormat::TAR_ZST:
+    return SeekableZstd::kDefaultLevel;
+  default:
+    return 6;
+  }
+}
+
+int LevelGovernor::minLevel(CompressionFormat format) {
+  return format == CompressionFormat::SEVEN_Z ||
+                 format == CompressionFormat::TAR_XZ
+             ? 0
+             : 1;
+}
+
+std::string LevelGovernor::keyOf(CompressionFormat format, int level) {
+  return CompressorFactory::formatToString(format) + ":" +
+         std::to_string(level);
+}
+
+double LevelGovernor::costOf(CompressionFormat format, int level) const {
+  auto it = seconds_per_byte_.find(keyOf(format, level));
+  if (it != seconds_per_byte_.end()) {
+    return it->second;
+  }
+  double scale = static_cast<double>(level + 1) / (defaultLevel(format) + 1);
+  return baseSecondsPerByte(format) * std::max(scale, 0.25);
+}
+
+double LevelGovernor::secondsPerByte(CompressionFormat format,
+                                     int level) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return costOf(format, level);
+}
+
+LevelDecision LevelGovernor::choose(CompressionFormat format, int requested,
+                                    size_t input_bytes, const PoolLoad &load) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  LevelDecision decision;
+  decision.level = requested >= 0 ? requested : defaultLevel(format);
+
+  int threads = std::max(load.threads, 1);
+  double wait = load.pending > static_cast<size_t>(threads)
+                    ? load.backlog_seconds / threads
+                    : 0.0;
+  double budget =
+      std::chrono::duration<double>(config_.latency_target).count() - wait;
+
+  decision.predicted_seconds =
+      wait + input_bytes * costOf(format, decision.level);
+  while (decision.level > minLevel(format) &&
+         input_bytes * costOf(format, decision.level) > budget) {
+    --decision.level;
+    decision.degraded = true;
+    decision.predicted_seconds =
+        wait + input_bytes * costOf(format, decision.level);
+  }
+  decision.store_incompressible = decision.degraded;
+
+  ++stats_.adaptive;
+  if (decision.degraded) {
+    ++stats_.degraded;
+  }
+  ++stats_.levels[keyOf(format, decision.level)];
+  return decision;
+}
+
+void LevelGovernor::record(CompressionFormat format, int level,
+                           size_t input_bytes,
+                           std::chrono::duration<double> elapsed) {
+  if (input_bytes == 0) {
+    return;
+  }
+  if (level < 0) {
+    level = defaultLevel(format);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  double observed = elapsed.count() / input_bytes;
+  auto [it, inserted] =
+      seconds_per_byte_.emplace(keyOf(format, level), observed);
+  if (!inserted) {
+    it->second = (1.0 - kSmoothing) * it->second + kSmoothing * observed;
+  }
+}
+
+LevelStats LevelGovernor::getStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "../compressor/compressor.h"
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+
+struct PoolLoad {
+  size_t pending = 0;
+  int threads = 1;
+  double backlog_seconds = 0.0;
+};
+
+struct LevelDecision {
+  int level = -1;
+  bool degraded = false;
+  bool store_incompressible = false;
+  double predicted_seconds = 0.0;
+};
+
+struct LevelStats {
+  size_t adaptive = 0;
+  size_t degraded = 0;
+  std::map<std::string, size_t> levels;
+};
+
+class LevelGovernor {
+public:
+  struct Config {
+    std::chrono::milliseconds latency_target{0};
+  };
+
+  explicit LevelGovernor(Config config);
+
+  static LevelGovernor &instance();
+
+  void configure(Config config);
+  const Config &getConfig() const { return config_; }
+  bool isEnabled() const { return config_.latency_target.count() > 0; }
+
+  LevelDecision choose(CompressionFormat format, int requested,
+                       size_t input_bytes, const PoolLoad &load);
+  void record(CompressionFormat format, int level, size_t input_bytes,
+              std::chrono::duration<double> elapsed);
+
+  double secondsPerByte(CompressionFormat format, int level) const;
+  LevelStats getStats() const;
+
+  static int defaultLevel(CompressionFormat format);
+  static int minLevel(CompressionFormat format);
+
+private:
+  mutable std::mutex mutex_;
+  Config config_;
+  std::map<std::string, double> seconds_per_byte_;
+  LevelStats stats_;
+
+  static std::string keyOf(CompressionFormat format, int level);
+  double costOf(CompressionFormat format, int level) const;
+};
@@ -0,0 +1,185 @@
+#include "load_shedder.h"
+#include "../memory/memory_budget.h"
+#include <boost/algorithm/string.hpp>
+#include <cmath>
+
+namespace {
+const double kCompressSecondsPerByte = 20e-9;
+const double kExtractSecondsPerByte = 5e-9;
+const double kRequestOverheadSeconds = 0.001;
+const double kSmoothing = 0.2;
+} // namespace
+
+LoadShedder::Ticket::Ticket(LoadShedder &shedder, RequestCost cost)
+    : shedder_(shedder), cost_(std::move(cost)),
+      started_(std::chrono::steady_clock::now()) {}
+
+LoadShedder::Ticket::~Ticket() {
+  shedder_.complete(cost_, std::chrono::steady_clock::now() - started_);
+}
+
+LoadShedder::LoadShedder(Config config) : config_(config) {}
+
+LoadShedder &LoadShedder::instance() {
+  static LoadShedder shedder(Config{});
+  return shedder;
+}
+
+void LoadShedder::configure(Config config) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  config_ = config;
+}
+
+std::string LoadShedder::endpointOf(const HttpRequestHeader &header) {
+  std::string target(header.target());
+  size_t query = target.find('?');
+  if (query != std::string::npos) {
+    target.resize(query);
+  }
+  return target;
+}
+
+double LoadShedder::memoryFactor(const std::string &endpoint) {
+  if (endpoint == "/archive/compress") {
+    return 3.0;
+  }
+  if (endpoint == "/archive/extract") {
+    return 4.0;
+  }
+  if (endpoint == "/archive/convert") {
+    return 3.0;
+  }
+  if (endpoint == "/archive/estimate") {
+    return 2.0;
+  }
+  if (endpoint == "/archives") {
+    return 2.0;
+  }
+  return 1.0;
+}
+
+double LoadShedder::secondsPerByte(const std::string &key,
+                                   const std::string &endpoint) const {
+  auto it = seconds_per_byte_.find(key);
+  if (it != seconds_per_byte_.end()) {
+    return it->second;
+  }
+  if (endpoint == "/archive/compress") {
+    return kCompressSecondsPerByte;
+  }
+  if (endpoint == "/archive/extract") {
+    return kExtractSecondsPerByte;
+  }
+  if (endpoint == "/archive/convert") {
+    return kExtractSecondsPerByte + kCompressSecondsPerByte;
+  }
+  return 0.0;
+}
+
+RequestCost LoadShedder::estimateCost(const HttpRequestHeader &header) const {
+  RequestCost cost;
+  std::string endpoint = endpointOf(header);
+
+  std::string format =
+      boost::algorithm::to_lower_copy(std::string(header["X-Archive-Format"]));
+  cost.key = format.empty() ? endpoint : endpoint + ":" + format;
+
+  auto content_length = header[http::field::content_length];
+  if (!content_length.empty()) {
+    try {
+      cost.body_bytes = std::stoull(std::string(content_length));
+    } catch (const std::exception &) {
+      cost.body_bytes = 0;
+    }
+  }
+
+  cost.memory_bytes =
+      static_cast<size_t>(cost.body_bytes * memoryFactor(endpoint));
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  cost.seconds = kRequestOverheadSeconds +
+                 cost.body_bytes * secondsPerByte(cost.key, endpoint);
+  return cost;
+}
+
+Admission LoadShedder::admit(const RequestCost &cost) {
+  Admission admission;
+  auto &budget = MemoryBudget::instance();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (cost.body_bytes > config_.max_body_size ||
+      cost.body_bytes > budget.getRequestLimit()) {
+    ++too_large_;
+    admission.decision = AdmissionDecision::TOO_LARGE;
+    admission.reason = "Request body exceeds the server limit";
+    return admission;
+  }
+
+  double slo = std::chrono::duration<double>(config_.latency_slo).count();
+  double wait = backlog_seconds_ / std::max(config_.workers, 1);
+  bool queue_full = cost.body_bytes > 0 && in_flight_ >= config_.max_in_flight;
+  bool over_slo = cost.body_bytes > 0 && in_flight_ > 0 &&
+                  wait + cost.seconds > slo;
+  bool over_memory =
+      budget.getUsage() + cost.memory_bytes > budget.getLimit();
+
+  if (queue_full || over_slo || over_memory) {
+    ++overloaded_;
+    admission.decision = AdmissionDecision::OVERLOADED;
+    admission.retry_after =
+        std::max(1, static_cast<int>(std::ceil(std::min(wait, slo))));
+    admission.reason = over_memory ? "Server memory budget exhausted"
+                                   : "Server is overloaded";
+    return admission;
+  }
+
+  ++accepted_;
+  ++in_flight_;
+  backlog_seconds_ += cost.seconds;
+  return admission;
+}
+
+void LoadShedder::complete(const RequestCost &cost,
+                           std::chrono::duration<double> elapsed) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  in_flight_ = in_flight_ > 0 ? in_flight_ - 1 : 0;
+  backlog_seconds_ = std::max(0.0, backlog_seconds_ - cost.seconds);
+
+  if (cost.body_bytes > 0) {
+    double observed = std::max(0.0, elapsed.count() - kRequestOverheadSeconds) /
+                      cost.body_bytes;
+    auto it = seconds_per_byte_.find(cost.key);
+    if (it == seconds_per_byte_.end()) {
+      seconds_per_byte_[cost.key] = observed;
+    } else {
+      it->second = (1.0 - kSmoothing) * it->second + kSmoothing * observed;
+    }
+  }
+}
+
+size_t LoadShedder::getInFlight() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return in_flight_;
+}
+
+double LoadShedder::getBacklogSeconds() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return backlog_seconds_;
+}
+
+size_t LoadShedder::getAcceptedCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return accepted_;
+}
+
+size_t LoadShedder::getOverloadedCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return overloaded_;
+}
+
+size_t LoadShedder::getTooLargeCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return too_large_;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "request/http_message.h"
+#include <boost/beast.hpp>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace http = boost::beast::http;
+
+struct RequestCost {
+  std::string key;
+  size_t body_bytes = 0;
+  size_t memory_bytes = 0;
+  double seconds = 0.0;
+};
+
+enum class AdmissionDecision { ACCEPT, OVERLOADED, TOO_LARGE };
+
+struct Admission {
+  AdmissionDecision decision = AdmissionDecision::ACCEPT;
+  int retry_after = 0;
+  std::string reason;
+
+  bool accepted() const { return decision == AdmissionDecision::ACCEPT; }
+};
+
+class LoadShedder {
+public:
+  struct Config {
+    size_t max_body_size = 500 * 1024 * 1024;
+    size_t max_in_flight = 64;
+    std::chrono::milliseconds latency_slo = std::chrono::seconds(30);
+    int workers = 4;
+  };
+
+  class Ticket {
+  public:
+    Ticket(LoadShedder &shedder, RequestCost cost);
+    ~Ticket();
+
+    Ticket(const Ticket &) = delete;
+    Ticket &operator=(const Ticket &) = delete;
+
+    const RequestCost &getCost() const { return cost_; }
+
+  private:
+    LoadShedder &shedder_;
+    RequestCost cost_;
+    std::chrono::steady_clock::time_point started_;
+  };
+
+  explicit LoadShedder(Config config);
+
+  static LoadShedder &instance();
+
+  void configure(Config config);
+  const Config &getConfig() const { return config_; }
+
+  RequestCost estimateCost(const HttpRequestHeader &header) const;
+  Admission admit(const RequestCost &cost);
+
+  size_t getInFlight() const;
+  double getBacklogSeconds() const;
+  size_t getAcceptedCount() const;
+  size_t getOverloadedCount() const;
+  size_t getTooLargeCount() const;
+
+private:
+  mutable std::mutex mutex_;
+  Config config_;
+  std::map<std::string, double> seconds_per_byte_;
+  size_t in_flight_ = 0;
+  double backlog_seconds_ = 0.0;
+  size_t accepted_ = 0;
+  size_t overloaded_ = 0;
+  size_t too_large_ = 0;
+
+  static std::string endpointOf(const HttpRequestHeader &header);
+  static double memoryFactor(const std::string &endpoint);
+  double secondsPerByte(const std::string &key,
+                        const std::string &endpoint) const;
+  void complete(const RequestCost &cost, std::chrono::duration<double> elapsed);
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "../handler_memory.h"
+#include "response_body.h"
+#include <boost/beast.hpp>
+#include <memory_resource>
+
+namespace http = boost::beast::http;
+
+using RequestFields =
+    http::basic_fields<std::pmr::polymorphic_allocator<char>>;
+using HttpRequest = http::request<http::string_body, RequestFields>;
+using HttpRequestHeader = http::request_header<RequestFields>;
+// Sessions give responses memory of their own, so setting header fields does
+// not reach the heap once a connection has served a request.
+using ResponseFields = http::basic_fields<HandlerAllocator<char>>;
+using HttpResponse = http::response<ResponseBody, ResponseFields>;
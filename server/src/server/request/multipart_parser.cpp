@@ -1,5 +1,7 @@
 #include "multipart_parser.h"
 #include "../../compressor/compressor.h"
+#include <algorithm>
+#include <cctype>
 #include <sstream>
 
 MultipartFormData MultipartParser::parse(const std::string &body,
@@ -83,6 +85,42 @@ MultipartParser::createMultipartResponse(const std::vector<FileEntry> &files,
   return response.str();
 }
 
+std::vector<SharedBuffer>
+MultipartParser::createMultipartParts(const std::vector<SharedPart> &files,
+                                      const std::string &boundary) {
+  std::vector<SharedBuffer> parts;
+  auto frame = [&parts](const std::string &text) {
+    parts.push_back(
+        std::make_shared<const std::vector<uint8_t>>(text.begin(), text.end()));
+  };
+
+  std::string separator;
+  for (const auto &file : files) {
+    frame(separator + "--" + boundary + "\r\n" +
+          "content-disposition: form-data; name=\"file\"; filename=\"" +
+          file.filename + "\"\r\n" +
+          "content-type: application/octet-stream\r\n\r\n");
+    parts.push_back(file.data);
+    separator = "\r\n";
+  }
+  frame(separator + "--" + boundary + "--\r\n");
+
+  return parts;
+}
+
+size_t
+MultipartParser::calculateResponseSize(const std::vector<FileEntry> &files,
+                                       const std::string &boundary) {
+  const size_t part_overhead = 128 + boundary.size();
+  size_t size = boundary.size() + 8;
+
+  for (const auto &file : files) {
+    size += part_overhead + file.name.size() + file.data.size();
+  }
+
+  return size;
+}
+
 std::vector<std::string> MultipartParser::split(const std::string &str,
                                                 const std::string &delimiter) {
   std::vector<std::string> result;
@@ -122,6 +160,8 @@ MultipartParser::parseHeaders(const std::string &headers) {
     size_t colon_pos = line.find(':');
     if (colon_pos != std::string::npos) {
       std::string key = trim(line.substr(0, colon_pos));
+      std::transform(key.begin(), key.end(), key.begin(),
+                     [](unsigned char c) { return std::tolower(c); });
       std::string value = trim(line.substr(colon_pos + 1));
       result[key] = value;
     }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../../cache/shared_buffer.h"
 #include <map>
 #include <string>
 #include <vector>
@@ -13,6 +14,11 @@ struct MultipartFile {
   std::vector<uint8_t> data;
 };
 
+struct SharedPart {
+  std::string filename;
+  SharedBuffer data;
+};
+
 struct MultipartFormData {
   std::map<std::string, std::string> fields;
   std::vector<MultipartFile> files;
@@ -25,6 +31,13 @@ public:
   static std::string
   createMultipartResponse(const std::vector<FileEntry> &files,
                           const std::string &boundary);
+  // The same body as createMultipartResponse, as buffers for a shared
+  // response: the framing is new, the file data is shared.
+  static std::vector<SharedBuffer>
+  createMultipartParts(const std::vector<SharedPart> &files,
+                       const std::string &boundary);
+  static size_t calculateResponseSize(const std::vector<FileEntry> &files,
+                                      const std::string &boundary);
 
 private:
   static std::string findBoundary(const std::string &content_type);
@@ -1,13 +1,149 @@
 #include "request_handler.h"
+#include "../../append/appender.h"
+#include "../../blob/blob_store.h"
+#include "../../cache/inflight_table.h"
+#include "../../cache/result_cache.h"
 #include "../../factory/factory.h"
+#include "../../memory/memory_budget.h"
+#include "../../planner/codec_planner.h"
+#include "../../planner/size_estimator.h"
 #include "../../processor/processor.h"
+#include "../../repack/repacker.h"
+#include "../../store/archive_store.h"
+#include "../cpu_pool.h"
+#include "../level_governor.h"
+#include "../load_shedder.h"
 #include "../../writer/writer.h"
 #include "multipart_parser.h"
 #include "request_params.h"
+#include <algorithm>
+#include <atomic>
+#include <boost/algorithm/string.hpp>
+#include <cctype>
+#include <chrono>
+#include <fnmatch.h>
+#include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <optional>
 #include <random>
 #include <sstream>
 
+namespace {
+const size_t kDefaultEntryPage = 100;
+const size_t kMaxEntryPage = 1000;
+
+class BadRequest : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+size_t parse_count(const std::string &value, const std::string &name) {
+  size_t parsed = 0;
+  size_t count = 0;
+  if (!value.empty() && std::isdigit(static_cast<unsigned char>(value[0]))) {
+    try {
+      count = std::stoul(value, &parsed);
+    } catch (const std::exception &) {
+      parsed = 0;
+    }
+  }
+  if (parsed == 0 || parsed != value.size()) {
+    throw BadRequest("Invalid " + name + ": " + value);
+  }
+  return count;
+}
+
+struct CachedArchive {
+  SharedBuffer data;
+  std::string status;
+  CompressStats stats;
+};
+
+// Serves a compress or convert result from the cache, or builds it once for
+// every concurrent request with the same key and caches it. What the
+// compressor measured is cached with it, so hits report it without
+// rescanning the upload.
+boost::asio::awaitable<CachedArchive>
+cached_archive(const ArchiveRequest &archive_request, CompressionFormat format,
+               const std::string &cache_key) {
+  auto &cache = ResultCache::instance();
+  CompressStats stats;
+  if (SharedBuffer data = cache.get(cache_key, &stats)) {
+    co_return CachedArchive{std::move(data), "hit", std::move(stats)};
+  }
+
+  auto produce = [&]() {
+    auto compressor = CompressorFactory::createCompressor(format);
+    ArchiveProcessor processor(archive_request, compressor);
+    processor.process();
+
+    ArchiveWriter writer;
+    writer.write(processor);
+
+    SharedBuffer data =
+        std::make_shared<const std::vector<uint8_t>>(writer.getBinaryData());
+    stats = processor.getCompressStats();
+    cache.put(cache_key, data, stats);
+    return data;
+  };
+  auto result = co_await InflightTable::instance().asyncRun(
+      cache_key, produce, boost::asio::use_awaitable);
+  if (result.coalesced) {
+    stats = cache.statsFor(cache_key);
+  }
+  co_return CachedArchive{result.data, result.coalesced ? "coalesced" : "miss",
+                          std::move(stats)};
+}
+
+// Runs cached_archive for every format at once on the CPU pool, so the
+// formats missing from the cache are built in parallel.
+boost::asio::awaitable<std::vector<CachedArchive>>
+cached_archives(const ArchiveRequest &archive_request,
+                const std::vector<CompressionFormat> &formats,
+                const std::vector<std::string> &cache_keys) {
+  struct Pending {
+    std::vector<CachedArchive> archives;
+    std::atomic<size_t> remaining;
+    std::mutex mutex;
+    std::exception_ptr error;
+    WaitList done;
+  };
+  auto pending = std::make_shared<Pending>();
+  pending->archives.resize(formats.size());
+  pending->remaining = formats.size();
+  uint64_t generation = pending->done.getGeneration();
+
+  for (size_t i = 0; i < formats.size(); ++i) {
+    boost::asio::co_spawn(
+        CpuPool::instance().getExecutor(),
+        cached_archive(archive_request, formats[i], cache_keys[i]),
+        [pending, i](std::exception_ptr error, CachedArchive archive) {
+          {
+            std::lock_guard<std::mutex> lock(pending->mutex);
+            pending->archives[i] = std::move(archive);
+            if (error && !pending->error) {
+              pending->error = error;
+            }
+          }
+          if (--pending->remaining == 0) {
+            pending->done.notifyAll();
+          }
+        });
+  }
+
+  co_await pending->done.asyncWait(co_await boost::asio::this_coro::executor,
+                                   generation,
+                                   WaitList::Clock::time_point::max(),
+                                   boost::asio::use_awaitable);
+  std::lock_guard<std::mutex> lock(pending->mutex);
+  if (pending->error) {
+    std::rethrow_exception(pending->error);
+  }
+  co_return std::move(pending->archives);
+}
+} // namespace
+
 std::string extract_boundary(const std::string &content_type) {
   size_t boundary_pos = content_type.find("boundary=");
   if (boundary_pos == std::string::npos) {
@@ -36,13 +172,379 @@ std::string generate_boundary() {
   return oss.str();
 }
 
-http::response<http::string_body>
-handle_request(const http::request<http::string_body> &req) {
-  http::response<http::string_body> resp;
+// Strips a known archive extension, keeping any other dots in the name.
+std::string archive_stem(const std::string &archive_name) {
+  for (const auto &format : CompressorFactory::getSupportedFormats()) {
+    std::string extension =
+        LibArchiveCompressor(CompressorFactory::formatFromString(format))
+            .getFileExtension();
+    if (archive_name.size() > extension.size() &&
+        archive_name.ends_with(extension)) {
+      return archive_name.substr(0, archive_name.size() - extension.size());
+    }
+  }
+  return archive_name;
+}
+
+bool etag_matches(const std::string &if_none_match, const std::string &etag) {
+  std::vector<std::string> candidates;
+  boost::algorithm::split(candidates, if_none_match,
+                          boost::algorithm::is_any_of(","));
+
+  for (auto &candidate : candidates) {
+    boost::algorithm::trim(candidate);
+    if (candidate == "*") {
+      return true;
+    }
+    if (boost::algorithm::starts_with(candidate, "W/")) {
+      candidate.erase(0, 2);
+    }
+    if (candidate == etag) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string blob_list_json(const std::string &key,
+                           const std::vector<std::string> &digests) {
+  std::ostringstream oss;
+  oss << "{\"" << key << "\": [";
+  for (size_t i = 0; i < digests.size(); ++i) {
+    oss << "\"" << digests[i] << "\"";
+    if (i < digests.size() - 1) {
+      oss << ", ";
+    }
+  }
+  oss << "]}";
+  return oss.str();
+}
+
+std::string json_escape(const std::string &value) {
+  std::ostringstream oss;
+  for (unsigned char c : value) {
+    if (c == '"' || c == '\\') {
+      oss << '\\' << c;
+    } else if (c < 0x20) {
+      oss << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+          << static_cast<int>(c) << std::dec;
+    } else {
+      oss << c;
+    }
+  }
+  return oss.str();
+}
+
+std::string url_decode(const std::string &value) {
+  std::string decoded;
+  decoded.reserve(value.size());
+  for (size_t i = 0; i < value.size(); ++i) {
+    if (value[i] == '%' && i + 2 < value.size() &&
+        std::isxdigit(static_cast<unsigned char>(value[i + 1])) &&
+        std::isxdigit(static_cast<unsigned char>(value[i + 2]))) {
+      decoded +=
+          static_cast<char>(std::stoi(value.substr(i + 1, 2), nullptr, 16));
+      i += 2;
+    } else if (value[i] == '+') {
+      decoded += ' ';
+    } else {
+      decoded += value[i];
+    }
+  }
+  return decoded;
+}
+
+std::string query_parameter(const std::string &target,
+                            const std::string &name) {
+  size_t query = target.find('?');
+  if (query == std::string::npos) {
+    return "";
+  }
+
+  std::vector<std::string> pairs;
+  boost::algorithm::split(pairs, target.substr(query + 1),
+                          boost::algorithm::is_any_of("&"));
+  for (const auto &pair : pairs) {
+    size_t equals = pair.find('=');
+    if (url_decode(pair.substr(0, equals)) == name) {
+      return equals == std::string::npos ? ""
+                                         : url_decode(pair.substr(equals + 1));
+    }
+  }
+  return "";
+}
+
+EntryFilter parse_entry_filter(const std::string &target) {
+  EntryFilter filter;
+
+  auto patterns = [&target](const std::string &name) {
+    std::vector<std::string> values;
+    std::string value = query_parameter(target, name);
+    if (!value.empty()) {
+      boost::algorithm::split(values, value, boost::algorithm::is_any_of(","));
+    }
+    values.erase(std::remove(values.begin(), values.end(), ""), values.end());
+    return values;
+  };
+  filter.include = patterns("include");
+  filter.exclude = patterns("exclude");
+
+  std::string max_entry_size = query_parameter(target, "max_entry_size");
+  if (!max_entry_size.empty()) {
+    try {
+      filter.max_entry_size = std::stoull(max_entry_size);
+    } catch (const std::exception &) {
+      throw std::runtime_error("Invalid max_entry_size: " + max_entry_size);
+    }
+  }
+  return filter;
+}
+
+bool parse_archive_route(const std::string &path, ArchiveRoute &route) {
+  const std::string prefix = "/archives/";
+  if (!boost::algorithm::starts_with(path, prefix)) {
+    return false;
+  }
+
+  std::string rest = path.substr(prefix.size());
+  size_t slash = rest.find('/');
+  route.id = rest.substr(0, slash);
+  if (route.id.empty()) {
+    return false;
+  }
+  if (slash == std::string::npos) {
+    return true;
+  }
+
+  std::string resource = rest.substr(slash + 1);
+  if (resource == "entries") {
+    route.entries = true;
+    return true;
+  }
+  if (boost::algorithm::starts_with(resource, "entries/")) {
+    route.entries = true;
+    route.entry = url_decode(resource.substr(8));
+    return !route.entry.empty();
+  }
+  return false;
+}
+
+std::string archive_entries_json(const StoredArchive &archive, size_t offset,
+                                 size_t limit) {
+  const auto &entries = archive.getEntries();
+  size_t begin = std::min(offset, entries.size());
+  size_t end = std::min(entries.size(), begin + limit);
+
+  std::ostringstream oss;
+  oss << "{\"id\": \"" << archive.getId() << "\", "
+      << "\"format\": \""
+      << CompressorFactory::formatToString(archive.getFormat()) << "\", "
+      << "\"total\": " << entries.size() << ", "
+      << "\"offset\": " << begin << ", "
+      << "\"limit\": " << limit << ", ";
+  if (end < entries.size()) {
+    oss << "\"next_offset\": " << end << ", ";
+  }
+  oss << "\"entries\": [";
+  for (size_t i = begin; i < end; ++i) {
+    const auto &entry = entries[i];
+    oss << "{\"name\": \"" << json_escape(entry.name) << "\", "
+        << "\"offset\": " << entry.offset << ", "
+        << "\"compressed_size\": " << entry.compressed_size << ", "
+        << "\"size\": " << entry.size << ", "
+        << "\"crc\": " << entry.crc << ", "
+        << "\"method\": \"" << entry.method << "\"}";
+    if (i < end - 1) {
+      oss << ", ";
+    }
+  }
+  oss << "]}";
+  return oss.str();
+}
+
+std::string stored_archive_json(const StoredArchive &archive) {
+  std::ostringstream oss;
+  oss << "{\"id\": \"" << archive.getId() << "\", "
+      << "\"format\": \""
+      << CompressorFactory::formatToString(archive.getFormat()) << "\", "
+      << "\"size\": " << archive.getSize() << ", "
+      << "\"entries\": " << archive.getEntries().size() << ", "
+      << "\"access_points\": " << archive.getAccessPointCount() << "}";
+  return oss.str();
+}
+
+std::string estimate_json(const EstimateReport &report) {
+  auto interval = [](const Interval &value) {
+    std::ostringstream oss;
+    oss << "{\"estimate\": " << value.estimate << ", \"low\": " << value.low
+        << ", \"high\": " << value.high << "}";
+    return oss.str();
+  };
+
+  std::ostringstream oss;
+  oss << "{\"input_bytes\": " << report.input_bytes << ", "
+      << "\"sampled_bytes\": " << report.sampled_bytes << ", "
+      << "\"strata\": " << report.strata << ", "
+      << "\"formats\": [";
+  for (size_t i = 0; i < report.formats.size(); ++i) {
+    const FormatEstimate &estimate = report.formats[i];
+    oss << (i ? ", " : "") << "{\"format\": \""
+        << CompressorFactory::formatToString(estimate.format) << "\", ";
+    if (!estimate.error.empty()) {
+      oss << "\"error\": \"" << json_escape(estimate.error) << "\"}";
+      continue;
+    }
+    oss << "\"size\": " << interval(estimate.size) << ", "
+        << "\"compress_seconds\": " << interval(estimate.compress_seconds)
+        << ", "
+        << "\"extract_seconds\": " << interval(estimate.extract_seconds)
+        << "}";
+  }
+  oss << "]}";
+  return oss.str();
+}
+
+// The list never changes, so it is built once and shared by every response.
+SharedBuffer formats_json() {
+  static const SharedBuffer json = []() {
+    std::string text = "{\"supported_formats\": [";
+    auto formats = CompressorFactory::getSupportedFormats();
+    for (size_t i = 0; i < formats.size(); ++i) {
+      text += "\"" + formats[i] + "\"";
+      if (i < formats.size() - 1) {
+        text += ", ";
+      }
+    }
+    text += "]}";
+    return std::make_shared<const std::vector<uint8_t>>(text.begin(),
+                                                        text.end());
+  }();
+  return json;
+}
+
+std::string metrics_json() {
+  auto &budget = MemoryBudget::instance();
+
+  std::ostringstream oss;
+  oss << "{\"memory\": {"
+      << "\"usage\": " << budget.getUsage() << ", "
+      << "\"high_water_mark\": " << budget.getHighWaterMark() << ", "
+      << "\"limit\": " << budget.getLimit() << ", "
+      << "\"request_limit\": " << budget.getRequestLimit() << ", "
+      << "\"rejected\": " << budget.getRejectedCount() << "}, ";
+
+  auto &shedder = LoadShedder::instance();
+  oss << "\"load\": {"
+      << "\"in_flight\": " << shedder.getInFlight() << ", "
+      << "\"backlog_seconds\": " << shedder.getBacklogSeconds() << ", "
+      << "\"accepted\": " << shedder.getAcceptedCount() << ", "
+      << "\"rejected_overloaded\": " << shedder.getOverloadedCount() << ", "
+      << "\"rejected_too_large\": " << shedder.getTooLargeCount() << "}, ";
+
+  auto cache = ResultCache::instance().getStats();
+  size_t lookups = cache.memory_hits + cache.disk_hits + cache.misses;
+  double hit_rate =
+      lookups ? static_cast<double>(cache.memory_hits + cache.disk_hits) /
+                    lookups
+              : 0.0;
+  oss << "\"cache\": {"
+      << "\"memory_hits\": " << cache.memory_hits << ", "
+      << "\"disk_hits\": " << cache.disk_hits << ", "
+      << "\"misses\": " << cache.misses << ", "
+      << "\"hit_rate\": " << hit_rate << ", "
+      << "\"bytes_saved\": " << cache.bytes_saved << ", "
+      << "\"memory_bytes\": " << cache.memory_bytes << ", "
+      << "\"disk_bytes\": " << cache.disk_bytes << ", "
+      << "\"evictions\": " << cache.evictions << "}, ";
+
+  auto &blobs = BlobStore::instance();
+  oss << "\"blobs\": {"
+      << "\"count\": " << blobs.getCount() << ", "
+      << "\"bytes\": " << blobs.getBytes() << ", "
+      << "\"limit\": " << blobs.getLimit() << "}, ";
+
+  auto &archives = ArchiveStore::instance();
+  oss << "\"archives\": {"
+      << "\"count\": " << archives.getCount() << ", "
+      << "\"bytes\": " << archives.getBytes() << ", "
+      << "\"limit\": " << archives.getLimit() << ", "
+      << "\"evictions\": " << archives.getEvictionCount() << "}, ";
+
+  auto &inflight = InflightTable::instance();
+  oss << "\"coalescing\": {"
+      << "\"in_flight\": " << inflight.getInFlight() << ", "
+      << "\"leaders\": " << inflight.getLeaderCount() << ", "
+      << "\"coalesced\": " << inflight.getCoalescedCount() << "}, ";
+
+  auto &governor = LevelGovernor::instance();
+  auto levels = governor.getStats();
+  oss << "\"levels\": {"
+      << "\"latency_target_ms\": "
+      << governor.getConfig().latency_target.count() << ", "
+      << "\"adaptive\": " << levels.adaptive << ", "
+      << "\"degraded\": " << levels.degraded << ", "
+      << "\"chosen\": {";
+  for (auto it = levels.levels.begin(); it != levels.levels.end(); ++it) {
+    oss << (it == levels.levels.begin() ? "" : ", ") << "\""
+        << json_escape(it->first) << "\": " << it->second;
+  }
+  oss << "}}}";
+  return oss.str();
+}
+
+HttpResponse rejection_response(const Admission &admission, unsigned version) {
+  HttpResponse resp;
+  resp.version(version);
+  resp.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+  resp.set(http::field::content_type, "application/json");
+  resp.keep_alive(false);
+
+  if (admission.decision == AdmissionDecision::TOO_LARGE) {
+    resp.result(http::status::payload_too_large);
+  } else {
+    resp.result(http::status::service_unavailable);
+    resp.set(http::field::retry_after, std::to_string(admission.retry_after));
+  }
+
+  resp.body() = R"({"error": ")" + admission.reason + "\"}";
+  resp.prepare_payload();
+  return resp;
+}
+
+HttpResponse handle_request(const HttpRequest &req) {
+  MemoryAccount memory;
+  return handle_request(req, memory);
+}
+
+HttpResponse handle_request(const HttpRequest &req, MemoryAccount &memory) {
+  boost::asio::io_context service;
+  HttpResponse resp;
+  std::exception_ptr error;
+  boost::asio::co_spawn(service, async_handle_request(req, memory, resp),
+                        [&error](std::exception_ptr e) { error = e; });
+  service.run();
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  return resp;
+}
+
+boost::asio::awaitable<void> async_handle_request(const HttpRequest &req,
+                                                  MemoryAccount &memory,
+                                                  HttpResponse &resp) {
+  resp = {};
   resp.version(11);
   resp.set(http::field::server, BOOST_BEAST_VERSION_STRING);
 
   try {
+    if (req.body().size() > memory.getReserved()) {
+      memory.reserve(req.body().size() - memory.getReserved());
+    }
+
+    std::string target = std::string(req.target());
+    std::string path = target.substr(0, target.find('?'));
+    ArchiveRoute route;
+
     if (req.method() == http::verb::post &&
         req.target() == "/archive/compress") {
 
@@ -52,74 +554,464 @@ handle_request(const http::request<http::string_body> &req) {
         resp.set(http::field::content_type, "application/json");
         resp.body() =
             R"({"error": "Content-Type must be multipart/form-data"})";
-        return resp;
+        co_return;
       }
 
       std::string boundary = extract_boundary(content_type);
-      ArchiveRequestParams params = parse_multipart_body(req.body(), boundary);
+      ArchiveRequestParams params =
+          parse_multipart_body(req.body(), boundary, &memory);
+
+      uint64_t input_bytes = 0;
+      for (const auto &file : params.files) {
+        input_bytes += file.data.size();
+      }
+
+      std::optional<CodecPlan> plan;
+      if (params.format == "auto") {
+        plan = CodecPlanner::instance().plan(
+            params.files, CodecPlanner::objectiveFromString(params.objective));
+        params.format = CompressorFactory::formatToString(plan->format);
+        params.options.level = plan->level;
+        params.archive_name =
+            archive_stem(params.archive_name) +
+            LibArchiveCompressor(plan->format).getFileExtension();
+      }
+
       ArchiveRequest archive_request = params.toArchiveRequest();
+      archive_request.memory = &memory;
+
+      if (params.adaptive && archive_request.formats.size() > 1) {
+        throw BadRequest("adaptive cannot be combined with a format list");
+      }
+
+      auto &governor = LevelGovernor::instance();
+      std::optional<LevelDecision> slo;
+      if (params.adaptive && governor.isEnabled()) {
+        auto &pool = CpuPool::instance();
+        PoolLoad load{pool.getPending(), pool.getThreadCount(),
+                      LoadShedder::instance().getBacklogSeconds()};
+        slo = governor.choose(archive_request.format,
+                              archive_request.options.level, input_bytes, load);
+        archive_request.options.level = slo->level;
+        archive_request.store_incompressible = slo->store_incompressible;
+      }
+
+      if (archive_request.formats.size() > 1) {
+        const auto &formats = archive_request.formats;
+        std::string stem = archive_stem(archive_request.archive_name);
+        std::vector<std::string> keys(formats.size());
+        for (size_t i = 0; i < formats.size(); ++i) {
+          archive_request.format = formats[i];
+          keys[i] = ResultCache::keyFor(archive_request);
+        }
 
-      auto compressor =
-          CompressorFactory::createCompressor(archive_request.format);
-      ArchiveProcessor processor(archive_request, compressor);
-      processor.process();
+        auto built = co_await cached_archives(archive_request, formats, keys);
+        std::vector<SharedPart> archives(formats.size());
+        std::vector<std::string> statuses(formats.size());
+        for (size_t i = 0; i < formats.size(); ++i) {
+          archives[i].filename =
+              stem + LibArchiveCompressor(formats[i]).getFileExtension();
+          archives[i].data = std::move(built[i].data);
+          statuses[i] = built[i].status;
+        }
 
-      ArchiveWriter writer;
-      writer.write(processor);
+        std::string boundary = generate_boundary();
+        auto parts = MultipartParser::createMultipartParts(archives, boundary);
+        size_t body_size = 0;
+        for (const auto &part : parts) {
+          body_size += part->size();
+        }
+        memory.reserve(body_size);
+
+        resp.result(http::status::ok);
+        resp.set("X-Archive-Cache", boost::algorithm::join(statuses, ","));
+        resp.set(http::field::content_type,
+                 "multipart/form-data; boundary=" + boundary);
+        resp.body().share(std::move(parts));
+        resp.prepare_payload();
+        co_return;
+      }
+
+      std::string cache_key = ResultCache::keyFor(archive_request);
+
+      if (archive_request.reproducible) {
+        std::string etag = "\"" + cache_key + "\"";
+        resp.set(http::field::etag, etag);
+        if (etag_matches(std::string(req[http::field::if_none_match]), etag)) {
+          resp.result(http::status::not_modified);
+          resp.prepare_payload();
+          co_return;
+        }
+      }
+
+      auto started = std::chrono::steady_clock::now();
+      auto [archive_data, cache_status, stats] =
+          co_await cached_archive(archive_request, archive_request.format,
+                                  cache_key);
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - started;
+      if (cache_status == "miss" && governor.isEnabled()) {
+        governor.record(archive_request.format, archive_request.options.level,
+                        input_bytes, elapsed);
+      }
 
       resp.result(http::status::ok);
-      auto archive_data = writer.getBinaryData();
+      memory.reserve(archive_data->size());
 
+      resp.set("X-Archive-Cache", cache_status);
+      if (slo) {
+        resp.set("X-Archive-Level", std::to_string(slo->level));
+        resp.set("X-Archive-Level-Degraded", slo->degraded ? "true" : "false");
+        resp.set("X-Archive-Level-Predicted-Seconds",
+                 std::to_string(slo->predicted_seconds));
+      }
+      if (plan) {
+        double actual_ratio =
+            input_bytes ? static_cast<double>(archive_data->size()) /
+                              input_bytes
+                        : 1.0;
+        resp.set("X-Archive-Auto-Format", params.format);
+        resp.set("X-Archive-Auto-Level", std::to_string(plan->level));
+        resp.set("X-Archive-Auto-Objective",
+                 CodecPlanner::objectiveToString(plan->objective));
+        resp.set("X-Archive-Predicted-Ratio",
+                 std::to_string(plan->predicted_ratio));
+        resp.set("X-Archive-Predicted-Seconds",
+                 std::to_string(plan->predicted_seconds));
+        resp.set("X-Archive-Actual-Ratio", std::to_string(actual_ratio));
+        resp.set("X-Archive-Actual-Seconds", std::to_string(elapsed.count()));
+      }
+      if (archive_request.order_by_similarity) {
+        std::vector<std::string> order;
+        for (size_t i : stats.entry_order) {
+          order.push_back(std::to_string(i));
+        }
+        resp.set("X-Archive-Entry-Order", boost::algorithm::join(order, ","));
+      }
+      if (archive_request.format == CompressionFormat::TAR_XZ) {
+        std::vector<std::string> summary;
+        for (const auto &[filter, count] : stats.prefilters) {
+          summary.push_back(filter + "=" + std::to_string(count));
+        }
+        resp.set("X-Archive-Prefilters", boost::algorithm::join(summary, ","));
+      }
+      if (archive_request.deduplicate) {
+        resp.set("X-Archive-Dedup-Entries",
+                 std::to_string(stats.dedup.entries));
+        resp.set("X-Archive-Dedup-Saved-Bytes",
+                 std::to_string(stats.dedup.saved_bytes));
+      }
+      if (stats.sparse.entries > 0) {
+        resp.set("X-Archive-Sparse-Entries",
+                 std::to_string(stats.sparse.entries));
+        resp.set("X-Archive-Sparse-Hole-Bytes",
+                 std::to_string(stats.sparse.hole_bytes));
+      }
       resp.set(http::field::content_type, "application/octet-stream");
       resp.set(http::field::content_disposition,
                "attachment; filename=\"" + archive_request.archive_name + "\"");
-      resp.body() = std::string(archive_data.begin(), archive_data.end());
+      resp.body().share(archive_data);
     } else if (req.method() == http::verb::post &&
-               req.target() == "/archive/extract") {
+               path == "/archive/extract") {
 
       ArchiveRequestParams params = parse_archive_upload(req.body());
+      params.filter = parse_entry_filter(target);
       ArchiveRequest archive_request = params.toArchiveRequest();
+      archive_request.memory = &memory;
 
-      auto compressor =
-          CompressorFactory::createCompressor(archive_request.format);
-      ArchiveProcessor processor(archive_request, compressor);
-      processor.process();
+      std::string key = ResultCache::keyFor(archive_request);
+      std::string boundary = "----CustomBoundary" + key.substr(0, 16);
 
-      ArchiveWriter writer;
-      writer.write(processor);
+      auto produce = [&]() {
+        auto compressor =
+            CompressorFactory::createCompressor(archive_request.format);
+        ArchiveProcessor processor(archive_request, compressor);
+        processor.process();
 
-      resp.result(http::status::ok);
+        ArchiveWriter writer;
+        writer.write(processor);
+
+        auto extracted_files = processor.getExtractedFiles();
+        memory.reserve(
+            MultipartParser::calculateResponseSize(extracted_files, boundary));
 
-      std::string boundary = generate_boundary();
-      auto extracted_files = processor.getExtractedFiles();
+        std::string body =
+            MultipartParser::createMultipartResponse(extracted_files, boundary);
+        return std::make_shared<const std::vector<uint8_t>>(body.begin(),
+                                                            body.end());
+      };
+      auto result = co_await InflightTable::instance().asyncRun(
+          key, produce, boost::asio::use_awaitable);
+
+      resp.result(http::status::ok);
+      if (result.coalesced) {
+        memory.reserve(result.data->size());
+      }
 
       resp.set(http::field::content_type,
                "multipart/form-data; boundary=" + boundary);
-      resp.body() =
-          MultipartParser::createMultipartResponse(extracted_files, boundary);
+      resp.body().share(result.data);
+
+    } else if (req.method() == http::verb::post &&
+               path == "/archive/estimate") {
+      std::string boundary =
+          extract_boundary(std::string(req[http::field::content_type]));
+      MultipartFormData form_data =
+          MultipartParser::parse(req.body(), boundary);
+      std::vector<FileEntry> files;
+      for (const auto &multipart_file : form_data.files) {
+        memory.reserve(multipart_file.data.size());
+        files.emplace_back(multipart_file.filename, multipart_file.data);
+      }
+      if (files.empty()) {
+        throw std::runtime_error("No files specified for estimate");
+      }
+
+      SizeEstimator::Config config;
+      if (form_data.fields.count("fraction")) {
+        const std::string &value = form_data.fields.at("fraction");
+        size_t parsed = 0;
+        try {
+          config.fraction = std::stod(value, &parsed);
+        } catch (const std::exception &) {
+          parsed = 0;
+        }
+        if (parsed == 0 || parsed != value.size() ||
+            !(config.fraction > 0.0 && config.fraction <= 1.0)) {
+          throw BadRequest("Invalid fraction: " + value);
+        }
+      }
 
-    } else if (req.method() == http::verb::get && req.target() == "/formats") {
       resp.result(http::status::ok);
       resp.set(http::field::content_type, "application/json");
+      resp.body() = estimate_json(SizeEstimator(config).estimate(files));
+
+    } else if (req.method() == http::verb::post &&
+               path == "/archive/convert") {
+      std::string to = query_parameter(target, "to");
+      if (to.empty()) {
+        throw std::runtime_error("Missing target format: to");
+      }
+
+      ArchiveRequestParams params = parse_archive_upload(req.body());
+      params.operation = "convert";
+      params.format = to;
+      params.filter = parse_entry_filter(target);
+      ArchiveRequest archive_request = params.toArchiveRequest();
+      archive_request.memory = &memory;
+      archive_request.archive_name =
+          "archive" +
+          LibArchiveCompressor(archive_request.format).getFileExtension();
+
+      CachedArchive converted =
+          co_await cached_archive(archive_request, archive_request.format,
+                                  ResultCache::keyFor(archive_request));
+
+      resp.result(http::status::ok);
+      memory.reserve(converted.data->size());
+
+      resp.set("X-Archive-Cache", converted.status);
+      resp.set(http::field::content_type, "application/octet-stream");
+      resp.set(http::field::content_disposition,
+               "attachment; filename=\"" + archive_request.archive_name + "\"");
+      resp.body().share(converted.data);
+
+    } else if (req.method() == http::verb::post &&
+               req.target() == "/blobs/missing") {
+      auto manifest = parse_blob_manifest(req.body());
 
-      std::string formats_json = "{\"supported_formats\": [";
-      auto formats = CompressorFactory::getSupportedFormats();
-      for (size_t i = 0; i < formats.size(); ++i) {
-        formats_json += "\"" + formats[i] + "\"";
-        if (i < formats.size() - 1) {
-          formats_json += ", ";
+      std::vector<std::string> digests;
+      for (const auto &entry : manifest) {
+        digests.push_back(entry.digest);
+      }
+      auto missing = BlobStore::instance().missing(digests);
+
+      resp.result(http::status::ok);
+      resp.set(http::field::content_type, "application/json");
+      resp.body() = blob_list_json("missing", missing);
+
+    } else if (req.method() == http::verb::post &&
+               path == "/archives/repack") {
+      std::string format_name = query_parameter(target, "format");
+      CompressionFormat format = CompressorFactory::formatFromString(
+          format_name.empty() ? "zip" : format_name);
+      auto selections = parse_repack_manifest(req.body());
+
+      std::vector<std::shared_ptr<const StoredArchive>> archives;
+      for (const auto &selection : selections) {
+        archives.push_back(ArchiveStore::instance().get(selection.archive_id));
+        if (!archives.back()) {
+          resp.result(http::status::not_found);
+          resp.set(http::field::content_type, "application/json");
+          resp.body() = R"({"error": "Unknown archive: )" +
+                        json_escape(selection.archive_id) + "\"}";
+          co_return;
+        }
+      }
+
+      Repacker repacker(format, time(nullptr), &memory);
+      for (size_t i = 0; i < selections.size(); ++i) {
+        for (const auto &entry : archives[i]->getEntries()) {
+          if (fnmatch(selections[i].pattern.c_str(), entry.name.c_str(), 0) ==
+              0) {
+            repacker.add(*archives[i], entry);
+          }
+        }
+      }
+      if (repacker.getStats().entries == 0) {
+        throw std::runtime_error("No entries matched the repack manifest");
+      }
+
+      auto data =
+          std::make_shared<const std::vector<uint8_t>>(repacker.finish());
+      const RepackStats &stats = repacker.getStats();
+
+      resp.result(http::status::ok);
+      resp.set("X-Archive-Repack-Entries", std::to_string(stats.entries));
+      resp.set("X-Archive-Repack-Copied", std::to_string(stats.copied));
+      resp.set("X-Archive-Repack-Copied-Bytes",
+               std::to_string(stats.copied_bytes));
+      resp.set(http::field::content_type, "application/octet-stream");
+      resp.set(http::field::content_disposition,
+               "attachment; filename=\"repack" +
+                   LibArchiveCompressor(format).getFileExtension() + "\"");
+      resp.body().share(data);
+
+    } else if (req.method() == http::verb::post && path == "/archives") {
+      if (req.body().empty()) {
+        throw std::runtime_error("No archive data provided");
+      }
+
+      // The session reserved the body on admission; the stored copy counts
+      // against the archive store's own limit.
+      auto archive = ArchiveStore::instance().put(
+          std::make_shared<const std::vector<uint8_t>>(req.body().begin(),
+                                                       req.body().end()));
+
+      resp.result(http::status::created);
+      resp.set(http::field::location, "/archives/" + archive->getId());
+      resp.set(http::field::content_type, "application/json");
+      resp.body() = stored_archive_json(*archive);
+
+    } else if (req.method() == http::verb::post &&
+               parse_archive_route(path, route) && route.entries &&
+               route.entry.empty()) {
+      auto archive = ArchiveStore::instance().get(route.id);
+      resp.set(http::field::content_type, "application/json");
+      if (!archive) {
+        resp.result(http::status::not_found);
+        resp.body() =
+            R"({"error": "Unknown archive: )" + json_escape(route.id) + "\"}";
+        co_return;
+      }
+
+      std::string content_type(req[http::field::content_type]);
+      if (content_type.find("multipart/form-data") == std::string::npos) {
+        throw BadRequest("Content-Type must be multipart/form-data");
+      }
+      MultipartFormData form_data =
+          MultipartParser::parse(req.body(), extract_boundary(content_type));
+      std::vector<FileEntry> files;
+      for (const auto &multipart_file : form_data.files) {
+        memory.reserve(multipart_file.data.size());
+        files.emplace_back(multipart_file.filename, multipart_file.data);
+      }
+
+      Appender appender(*archive, time(nullptr), &memory);
+      auto appended = ArchiveStore::instance().put(
+          std::make_shared<const std::vector<uint8_t>>(
+              appender.append(files)));
+      const AppendStats &stats = appender.getStats();
+
+      resp.result(http::status::created);
+      resp.set(http::field::location, "/archives/" + appended->getId());
+      resp.set("X-Archive-Append-Entries", std::to_string(stats.entries));
+      resp.set("X-Archive-Append-Kept-Bytes", std::to_string(stats.kept_bytes));
+      resp.set("X-Archive-Append-Recompressed-Bytes",
+               std::to_string(stats.recompressed_bytes));
+      resp.body() = stored_archive_json(*appended);
+
+    } else if (req.method() == http::verb::get &&
+               parse_archive_route(path, route) && route.entries) {
+      auto archive = ArchiveStore::instance().get(route.id);
+      resp.set(http::field::content_type, "application/json");
+
+      if (!archive) {
+        resp.result(http::status::not_found);
+        resp.body() =
+            R"({"error": "Unknown archive: )" + json_escape(route.id) + "\"}";
+      } else if (route.entry.empty()) {
+        std::string offset = query_parameter(target, "offset");
+        std::string limit = query_parameter(target, "limit");
+        size_t page_size =
+            limit.empty() ? kDefaultEntryPage : parse_count(limit, "limit");
+        if (page_size == 0 || page_size > kMaxEntryPage) {
+          throw BadRequest("limit must be between 1 and " +
+                           std::to_string(kMaxEntryPage));
         }
+
+        resp.result(http::status::ok);
+        resp.body() = archive_entries_json(
+            *archive, offset.empty() ? 0 : parse_count(offset, "offset"),
+            page_size);
+      } else if (const ArchiveEntryInfo *entry = archive->find(route.entry)) {
+        auto data = std::make_shared<const std::vector<uint8_t>>(
+            archive->readEntry(*entry, &memory));
+
+        resp.result(http::status::ok);
+        resp.set(http::field::content_type, "application/octet-stream");
+        resp.set("X-Archive-Entry-Crc", std::to_string(entry->crc));
+        resp.body().share(data);
+      } else {
+        resp.result(http::status::not_found);
+        resp.body() = R"({"error": "Entry not found: )" +
+                      json_escape(route.entry) + "\"}";
       }
-      formats_json += "]}";
 
-      resp.body() = formats_json;
+    } else if (req.method() == http::verb::delete_ &&
+               parse_archive_route(path, route) && !route.entries) {
+      bool removed = ArchiveStore::instance().remove(route.id);
+      resp.result(removed ? http::status::no_content : http::status::not_found);
+      if (!removed) {
+        resp.set(http::field::content_type, "application/json");
+        resp.body() =
+            R"({"error": "Unknown archive: )" + json_escape(route.id) + "\"}";
+      }
+
+    } else if (req.method() == http::verb::get && req.target() == "/formats") {
+      resp.result(http::status::ok);
+      resp.set(http::field::content_type, "application/json");
+
+      resp.body().share(formats_json());
+
+    } else if (req.method() == http::verb::get && req.target() == "/metrics") {
+      resp.result(http::status::ok);
+      resp.set(http::field::content_type, "application/json");
+      resp.body() = metrics_json();
 
     } else {
       resp.result(http::status::not_found);
       resp.set(http::field::content_type, "application/json");
       resp.body() =
-          R"({"error": "Endpoint not found. Available endpoints: POST /archive/compress, POST /archive/extract, GET /formats"})";
+          R"({"error": "Endpoint not found. Available endpoints: POST /archive/compress, POST /archive/extract, POST /archive/convert, POST /archive/estimate, POST /blobs/missing, POST /archives, POST /archives/repack, POST /archives/{id}/entries, GET /archives/{id}/entries, GET /archives/{id}/entries/{path}, DELETE /archives/{id}, GET /formats, GET /metrics"})";
     }
+  } catch (const BlobNotFound &e) {
+    resp.result(http::status::conflict);
+    resp.set(http::field::content_type, "application/json");
+    resp.body() = blob_list_json("missing", e.getDigests());
+  } catch (const MemoryBudgetExceeded &e) {
+    resp.result(http::status::service_unavailable);
+    resp.set(http::field::retry_after, std::to_string(e.getRetryAfter()));
+    resp.set(http::field::content_type, "application/json");
+    resp.body() = R"({"error": ")" + std::string(e.what()) + "\"}";
+  } catch (const BadRequest &e) {
+    resp.result(http::status::bad_request);
+    resp.set(http::field::content_type, "application/json");
+    resp.body() = R"({"error": ")" + std::string(e.what()) + "\"}";
+  } catch (const RequestTooLarge &e) {
+    resp.result(http::status::payload_too_large);
+    resp.set(http::field::content_type, "application/json");
+    resp.body() = R"({"error": ")" + std::string(e.what()) + "\"}";
   } catch (const std::exception &e) {
     std::cout << "Error: " << e.what() << "\n";
     resp.result(http::status::internal_server_error);
@@ -128,6 +1020,4 @@ handle_request(const http::request<http::string_body> &req) {
   }
 
   resp.prepare_payload();
-
-  return resp;
 }
@@ -1,10 +1,49 @@
 #pragma once
 
+#include "http_message.h"
+#include <boost/asio.hpp>
 #include <boost/beast.hpp>
 #include <string>
+#include <vector>
 
 namespace http = boost::beast::http;
 
+class MemoryAccount;
+struct EntryFilter;
+class StoredArchive;
+struct Admission;
+struct EstimateReport;
+
+struct ArchiveRoute {
+  std::string id;
+  bool entries = false;
+  std::string entry;
+};
+
 std::string extract_boundary(const std::string &content_type);
 std::string generate_boundary();
-http::response<http::string_body> handle_request(const http::request<http::string_body> &req);
+std::string archive_stem(const std::string &archive_name);
+bool etag_matches(const std::string &if_none_match, const std::string &etag);
+std::string blob_list_json(const std::string &key,
+                           const std::vector<std::string> &digests);
+std::string json_escape(const std::string &value);
+std::string url_decode(const std::string &value);
+std::string query_parameter(const std::string &target, const std::string &name);
+EntryFilter parse_entry_filter(const std::string &target);
+bool parse_archive_route(const std::string &path, ArchiveRoute &route);
+std::string archive_entries_json(const StoredArchive &archive, size_t offset,
+                                 size_t limit);
+std::string stored_archive_json(const StoredArchive &archive);
+std::string estimate_json(const EstimateReport &report);
+SharedBuffer formats_json();
+std::string metrics_json();
+HttpResponse rejection_response(const Admission &admission, unsigned version);
+// Writes the response for req into resp. Waits, such as for another request
+// producing the same result, suspend the coroutine instead of blocking a
+// thread.
+boost::asio::awaitable<void> async_handle_request(const HttpRequest &req,
+                                                  MemoryAccount &memory,
+                                                  HttpResponse &resp);
+// Run async_handle_request to completion on the calling thread.
+HttpResponse handle_request(const HttpRequest &req);
+HttpResponse handle_request(const HttpRequest &req, MemoryAccount &memory);
@@ -1,7 +1,14 @@
 #include "request_params.h"
+#include "../../blob/blob_store.h"
+#include "../../digest/digest.h"
 #include "../../factory/factory.h"
+#include "../../memory/memory_budget.h"
+#include "../../planner/codec_planner.h"
 #include "../../processor/processor.h"
+#include "../../zstd/seekable_zstd.h"
 #include "multipart_parser.h"
+#include <algorithm>
+#include <sstream>
 #include <stdexcept>
 
 ArchiveRequest ArchiveRequestParams::toArchiveRequest() const {
@@ -11,12 +18,33 @@ ArchiveRequest ArchiveRequestParams::toArchiveRequest() const {
     request.operation = ArchiveOperation::COMPRESS;
   } else if (operation == "extract") {
     request.operation = ArchiveOperation::EXTRACT;
+  } else if (operation == "convert") {
+    request.operation = ArchiveOperation::CONVERT;
   } else {
     throw std::runtime_error("Unknown operation: " + operation);
   }
 
   request.format = CompressorFactory::formatFromString(format);
+  for (const auto &name : formats) {
+    request.formats.push_back(CompressorFactory::formatFromString(name));
+  }
   request.archive_name = archive_name;
+  request.reproducible = reproducible;
+  request.deduplicate = deduplicate;
+  request.filter = filter;
+  request.frame_size = frame_size;
+  request.options = options;
+  request.order_by_similarity = order_by_similarity;
+  if (mtime >= 0) {
+    request.mtime = static_cast<time_t>(mtime);
+  }
+
+  if (request.operation != ArchiveOperation::EXTRACT) {
+    CompressorFactory::validateOptions(request.format, request.options);
+    for (auto other : request.formats) {
+      CompressorFactory::validateOptions(other, request.options);
+    }
+  }
 
   if (request.operation == ArchiveOperation::COMPRESS) {
     request.files = files;
@@ -29,7 +57,8 @@ ArchiveRequest ArchiveRequestParams::toArchiveRequest() const {
 }
 
 ArchiveRequestParams parse_multipart_body(const std::string &body,
-                                          const std::string &boundary) {
+                                          const std::string &boundary,
+                                          MemoryAccount *memory) {
   ArchiveRequestParams params;
 
   try {
@@ -44,6 +73,17 @@ ArchiveRequestParams parse_multipart_body(const std::string &body,
 
     params.operation = form_data.fields.at("operation");
     params.format = form_data.fields.at("format");
+    if (params.format.find(',') != std::string::npos) {
+      std::istringstream list(params.format);
+      for (std::string name; std::getline(list, name, ',');) {
+        if (!name.empty() && std::find(params.formats.begin(),
+                                       params.formats.end(),
+                                       name) == params.formats.end()) {
+          params.formats.push_back(name);
+        }
+      }
+      params.format = params.formats.empty() ? "" : params.formats.front();
+    }
 
     if (form_data.fields.find("archive_name") != form_data.fields.end()) {
       params.archive_name = form_data.fields.at("archive_name");
@@ -51,16 +91,130 @@ ArchiveRequestParams parse_multipart_body(const std::string &body,
     if (form_data.fields.find("extract_path") != form_data.fields.end()) {
       params.extract_path = form_data.fields.at("extract_path");
     }
+    if (form_data.fields.find("reproducible") != form_data.fields.end()) {
+      const std::string &value = form_data.fields.at("reproducible");
+      params.reproducible = value == "true" || value == "1";
+    }
+    if (form_data.fields.find("dedup") != form_data.fields.end()) {
+      const std::string &value = form_data.fields.at("dedup");
+      params.deduplicate = value == "true" || value == "1";
+    }
+    if (form_data.fields.find("mtime") != form_data.fields.end()) {
+      const std::string &value = form_data.fields.at("mtime");
+      size_t parsed = 0;
+      params.mtime = std::stoll(value, &parsed);
+      if (parsed != value.size() || params.mtime < 0) {
+        throw std::runtime_error("Invalid mtime: " + value);
+      }
+      params.reproducible = true;
+    }
+    if (form_data.fields.find("frame_size") != form_data.fields.end()) {
+      const std::string &value = form_data.fields.at("frame_size");
+      size_t parsed = 0;
+      long long frame_size = std::stoll(value, &parsed);
+      if (parsed != value.size() ||
+          frame_size < static_cast<long long>(SeekableZstd::kMinFrameSize) ||
+          frame_size > static_cast<long long>(SeekableZstd::kMaxFrameSize)) {
+        throw std::runtime_error("Invalid frame_size: " + value);
+      }
+      params.frame_size = frame_size;
+    }
+
+    auto integer_field = [&](const std::string &name) {
+      const std::string &value = form_data.fields.at(name);
+      size_t parsed = 0;
+      long long number = -1;
+      try {
+        number = std::stoll(value, &parsed);
+      } catch (const std::exception &) {
+      }
+      if (parsed != value.size() || number < 0) {
+        throw std::runtime_error("Invalid " + name + ": " + value);
+      }
+      return number;
+    };
+    if (form_data.fields.find("level") != form_data.fields.end()) {
+      params.options.level = static_cast<int>(integer_field("level"));
+    }
+    if (form_data.fields.find("threads") != form_data.fields.end()) {
+      params.options.threads = static_cast<int>(integer_field("threads"));
+    }
+    if (form_data.fields.find("block_size") != form_data.fields.end()) {
+      params.options.block_size = integer_field("block_size");
+    }
+    if (form_data.fields.find("solid") != form_data.fields.end()) {
+      const std::string &value = form_data.fields.at("solid");
+      params.options.solid = value == "true" || value == "1";
+    }
+    if (form_data.fields.find("options") != form_data.fields.end()) {
+      params.options.archive_options = form_data.fields.at("options");
+    }
+    if (form_data.fields.find("order") != form_data.fields.end()) {
+      const std::string &value = form_data.fields.at("order");
+      if (value != "upload" && value != "similarity") {
+        throw std::runtime_error("Invalid order: " + value);
+      }
+      params.order_by_similarity = value == "similarity";
+    }
+    if (form_data.fields.find("adaptive") != form_data.fields.end()) {
+      const std::string &value = form_data.fields.at("adaptive");
+      params.adaptive = value == "true" || value == "1";
+    }
+    if (form_data.fields.find("objective") != form_data.fields.end()) {
+      params.objective = form_data.fields.at("objective");
+      CodecPlanner::objectiveFromString(params.objective);
+    }
+
+    bool store_blobs = form_data.fields.count("store_blobs") &&
+                       (form_data.fields.at("store_blobs") == "true" ||
+                        form_data.fields.at("store_blobs") == "1");
 
     if (params.operation == "compress") {
+      auto &blobs = BlobStore::instance();
+      std::vector<std::string> missing;
+
       for (const auto &multipart_file : form_data.files) {
         FileEntry file;
         file.name = multipart_file.filename;
-        file.data = multipart_file.data;
+
+        if (multipart_file.content_type == BlobStore::kReferenceContentType) {
+          file.digest.assign(multipart_file.data.begin(),
+                             multipart_file.data.end());
+          if (!BlobStore::isValidDigest(file.digest)) {
+            throw std::runtime_error("Invalid blob digest: " + file.digest);
+          }
+          try {
+            file.data = blobs.get(file.digest, memory);
+          } catch (const BlobNotFound &) {
+            missing.push_back(file.digest);
+          }
+        } else {
+          if (memory) {
+            memory->reserve(multipart_file.data.size());
+          }
+          file.data = multipart_file.data;
+          if (store_blobs) {
+            file.digest = ContentHasher::sha256(file.data);
+            blobs.put(file.digest, file.data);
+          } else {
+            file.digest = ContentHasher::digest(file.data);
+          }
+        }
+
         params.files.push_back(file);
       }
+
+      if (!missing.empty()) {
+        throw BlobNotFound(missing);
+      }
     }
 
+  } catch (const BlobNotFound &) {
+    throw;
+  } catch (const MemoryBudgetExceeded &) {
+    throw;
+  } catch (const RequestTooLarge &) {
+    throw;
   } catch (const std::exception &e) {
     throw std::runtime_error("Invalid multipart body: " +
                              std::string(e.what()));
@@ -70,9 +224,18 @@ ArchiveRequestParams parse_multipart_body(const std::string &body,
     throw std::runtime_error("Operation must be 'compress' or 'extract'");
   }
 
-  if (!CompressorFactory::isFormatSupported(params.format)) {
+  bool auto_format = params.format == "auto" && params.operation == "compress";
+  if (!auto_format && !CompressorFactory::isFormatSupported(params.format)) {
     throw std::runtime_error("Unsupported format: " + params.format);
   }
+  for (const auto &format : params.formats) {
+    if (!CompressorFactory::isFormatSupported(format)) {
+      throw std::runtime_error("Unsupported format: " + format);
+    }
+  }
+  if (!params.formats.empty() && params.operation != "compress") {
+    throw std::runtime_error("Multiple formats are only supported for compress");
+  }
 
   if (params.archive_name.empty()) {
     params.archive_name = "archive." + params.format;
@@ -103,3 +266,63 @@ ArchiveRequestParams parse_archive_upload(const std::string &body) {
 
   return params;
 }
+
+std::vector<BlobManifestEntry> parse_blob_manifest(const std::string &body) {
+  std::vector<BlobManifestEntry> entries;
+  std::istringstream stream(body);
+  std::string line;
+
+  while (std::getline(stream, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (line.empty()) {
+      continue;
+    }
+
+    std::istringstream fields(line);
+    BlobManifestEntry entry;
+    if (!(fields >> entry.digest >> entry.size)) {
+      throw std::runtime_error("Invalid manifest line: " + line);
+    }
+    if (!BlobStore::isValidDigest(entry.digest)) {
+      throw std::runtime_error("Invalid blob digest: " + entry.digest);
+    }
+    std::getline(fields >> std::ws, entry.name);
+    entries.push_back(entry);
+  }
+
+  return entries;
+}
+
+std::vector<RepackSelection> parse_repack_manifest(const std::string &body) {
+  std::vector<RepackSelection> selections;
+  std::istringstream stream(body);
+  std::string line;
+
+  while (std::getline(stream, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (line.empty()) {
+      continue;
+    }
+
+    std::istringstream fields(line);
+    RepackSelection selection;
+    if (!(fields >> selection.archive_id)) {
+      throw std::runtime_error("Invalid repack line: " + line);
+    }
+    std::string pattern;
+    std::getline(fields >> std::ws, pattern);
+    if (!pattern.empty()) {
+      selection.pattern = pattern;
+    }
+    selections.push_back(selection);
+  }
+
+  if (selections.empty()) {
+    throw std::runtime_error("Repack manifest is empty");
+  }
+  return selections;
+}
@@ -10,6 +10,7 @@ struct ArchiveRequest;
 struct ArchiveRequestParams {
   std::string operation;
   std::string format;
+  std::vector<std::string> formats;
   std::string archive_name;
 
   std::vector<FileEntry> files;
@@ -17,14 +18,39 @@ struct ArchiveRequestParams {
   std::vector<uint8_t> archive_data;
   std::string extract_path;
 
+  bool reproducible = false;
+  int64_t mtime = -1;
+  bool deduplicate = false;
+  EntryFilter filter;
+  size_t frame_size = 1024 * 1024;
+  CompressionOptions options;
+  std::string objective = "balanced";
+  bool adaptive = false;
+  bool order_by_similarity = false;
+
   ArchiveRequestParams()
       : operation("compress"), format("zip"), archive_name("archive.zip") {}
 
   ArchiveRequest toArchiveRequest() const;
 };
 
+struct BlobManifestEntry {
+  std::string digest;
+  size_t size = 0;
+  std::string name;
+};
+
+struct RepackSelection {
+  std::string archive_id;
+  std::string pattern = "*";
+};
+
 struct MultipartFormData;
+class MemoryAccount;
 
 ArchiveRequestParams parse_multipart_body(const std::string &body,
-                                          const std::string &boundary);
+                                          const std::string &boundary,
+                                          MemoryAccount *memory = nullptr);
 ArchiveRequestParams parse_archive_upload(const std::string &body);
+std::vector<BlobManifestEntry> parse_blob_manifest(const std::string &body);
+std::vector<RepackSelection> parse_repack_manifest(const std::string &body);
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "../../cache/shared_buffer.h"
+#include <boost/beast.hpp>
+#include <boost/optional.hpp>
+#include <string>
+#include <vector>
+
+namespace http = boost::beast::http;
+
+struct ResponseBody {
+  class value_type {
+  public:
+    value_type() = default;
+
+    value_type &operator=(std::string text) {
+      text_ = std::move(text);
+      shared_.reset();
+      parts_.clear();
+      return *this;
+    }
+
+    void share(SharedBuffer buffer) {
+      text_.clear();
+      parts_.clear();
+      shared_ = std::move(buffer);
+    }
+
+    // The body is the parts in order; none of them is copied.
+    void share(std::vector<SharedBuffer> parts) {
+      text_.clear();
+      shared_.reset();
+      parts_ = std::move(parts);
+    }
+
+    size_t size() const {
+      if (!parts_.empty()) {
+        size_t total = 0;
+        for (const auto &part : parts_) {
+          total += part->size();
+        }
+        return total;
+      }
+      return shared_ ? shared_->size() : text_.size();
+    }
+    bool empty() const { return size() == 0; }
+    bool isShared() const { return shared_ != nullptr || !parts_.empty(); }
+
+    size_t getBufferCount() const {
+      return parts_.empty() ? 1 : parts_.size();
+    }
+    boost::asio::const_buffer getBuffer(size_t index) const {
+      if (!parts_.empty()) {
+        return {parts_[index]->data(), parts_[index]->size()};
+      }
+      return shared_ ? boost::asio::const_buffer(shared_->data(),
+                                                 shared_->size())
+                     : boost::asio::const_buffer(text_.data(), text_.size());
+    }
+
+  private:
+    std::string text_;
+    SharedBuffer shared_;
+    std::vector<SharedBuffer> parts_;
+  };
+
+  static std::uint64_t size(const value_type &body) { return body.size(); }
+
+  class writer {
+  public:
+    using const_buffers_type = boost::asio::const_buffer;
+
+    template <bool isRequest, class Fields>
+    writer(const http::header<isRequest, Fields> &, const value_type &body)
+        : body_(body) {}
+
+    void init(boost::beast::error_code &ec) { ec = {}; }
+
+    boost::optional<std::pair<const_buffers_type, bool>>
+    get(boost::beast::error_code &ec) {
+      ec = {};
+      size_t index = next_++;
+      return {{body_.getBuffer(index), next_ < body_.getBufferCount()}};
+    }
+
+  private:
+    const value_type &body_;
+    size_t next_ = 0;
+  };
+};
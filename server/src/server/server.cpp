@@ -1,58 +1,64 @@
 #include "server.h"
-#include "request/request_handler.h"
+#include "../planner/codec_planner.h"
+#include "cpu_pool.h"
+#include "level_governor.h"
+#include "load_shedder.h"
+#include "session.h"
+#include <algorithm>
 #include <iostream>
-
-void onReadAsync(std::shared_ptr<ip::tcp::socket> sock,
-                 std::shared_ptr<boost::beast::flat_buffer> buf,
-                 std::shared_ptr<http::request<http::string_body>> req,
-                 boost::beast::error_code ec, std::size_t) {
-  if (ec) {
-    if (ec != boost::asio::error::operation_aborted &&
-        ec != http::error::end_of_stream) {
-      std::cerr << ec.message() << std::endl;
-    }
-    return;
+#include <mutex>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+namespace {
+// The contexts and per-acceptor counters of the server this process runs.
+std::mutex running_mutex;
+std::vector<boost::asio::io_context *> running_services;
+std::vector<std::unique_ptr<std::atomic<size_t>>> running_accepted;
+
+void registerServer(std::vector<boost::asio::io_context *> services,
+                    size_t acceptors) {
+  std::lock_guard<std::mutex> lock(running_mutex);
+  running_services = std::move(services);
+  running_accepted.clear();
+  for (size_t i = 0; i < acceptors; ++i) {
+    running_accepted.push_back(std::make_unique<std::atomic<size_t>>(0));
   }
+}
 
-  auto resp =
-      std::make_shared<http::response<http::string_body>>(handle_request(*req));
-  http::async_write(*sock, *resp,
-                    std::bind(&onWriteAsync, sock, resp, req->keep_alive(),
-                              std::placeholders::_1, std::placeholders::_2));
+void unregisterServer() {
+  std::lock_guard<std::mutex> lock(running_mutex);
+  running_services.clear();
 }
 
-void onWriteAsync(std::shared_ptr<ip::tcp::socket> sock,
-                  std::shared_ptr<http::response<http::string_body>>,
-                  bool keepAlive, boost::beast::error_code ec, std::size_t) {
-  if (ec) {
-    if (ec != boost::asio::error::operation_aborted) {
-      std::cerr << ec.message() << std::endl;
-    }
-    return;
-  }
+std::atomic<size_t> &acceptedCounter(size_t acceptor) {
+  std::lock_guard<std::mutex> lock(running_mutex);
+  return *running_accepted[acceptor];
+}
 
-  if (keepAlive) {
-    auto buf = std::make_shared<boost::beast::flat_buffer>();
-    auto req = std::make_shared<http::request<http::string_body>>();
-
-    auto parser = std::make_shared<http::request_parser<http::string_body>>();
-    parser->body_limit(500 * 1024 * 1024);
-
-    http::async_read(*sock, *buf, *parser,
-                     [sock, buf, req, parser](boost::beast::error_code ec,
-                                              std::size_t bytes_transferred) {
-                       if (!ec) {
-                         *req = parser->release();
-                       }
-                       onReadAsync(sock, buf, req, ec, bytes_transferred);
-                     });
-  } else {
-    sock->shutdown(ip::tcp::socket::shutdown_both);
+// Sessions on a context run by several threads get a strand, so a
+// connection's handlers never run concurrently.
+std::shared_ptr<ip::tcp::socket> peerSocket(boost::asio::io_context &service,
+                                            bool shared) {
+  if (shared) {
+    return std::make_shared<ip::tcp::socket>(boost::asio::make_strand(service));
   }
+  return std::make_shared<ip::tcp::socket>(service);
 }
 
+// hardware_concurrency() may report 0 when the count is unknown.
+int cpuFor(int index) {
+  return index % static_cast<int>(
+                     std::max(1u, std::thread::hardware_concurrency()));
+}
+} // namespace
+
 void onAcceptAsync(ip::tcp::acceptor &acceptor,
                    boost::asio::io_context &service,
+                   std::atomic<size_t> &accepted, bool shared,
                    std::shared_ptr<ip::tcp::socket> sock,
                    const boost::system::error_code &ec) {
   if (ec) {
@@ -62,52 +68,158 @@ void onAcceptAsync(ip::tcp::acceptor &acceptor,
     return;
   }
 
-  auto buf = std::make_shared<boost::beast::flat_buffer>();
-  auto req = std::make_shared<http::request<http::string_body>>();
-
-  auto parser = std::make_shared<http::request_parser<http::string_body>>();
-  parser->body_limit(500 * 1024 * 1024);
-
-  http::async_read(*sock, *buf, *parser,
-                   [sock, buf, req, parser](boost::beast::error_code ec,
-                                            std::size_t bytes_transferred) {
-                     if (!ec) {
-                       *req = parser->release();
-                     }
-                     onReadAsync(sock, buf, req, ec, bytes_transferred);
-                   });
+  ++accepted;
+  std::make_shared<Session>(std::move(*sock))->start();
 
-  auto acceptSock = std::make_shared<ip::tcp::socket>(service);
+  auto acceptSock = peerSocket(service, shared);
   acceptor.async_accept(*acceptSock,
                         std::bind(&onAcceptAsync, std::ref(acceptor),
-                                  std::ref(service), acceptSock,
-                                  std::placeholders::_1));
+                                  std::ref(service), std::ref(accepted), shared,
+                                  acceptSock, std::placeholders::_1));
 }
 
-void start_server(int port, int thread_count) {
-  boost::asio::io_context service;
-  boost::asio::thread_pool tp(thread_count);
-
-  for (int i = 0; i < thread_count; ++i) {
-    post(tp, [&service]() {
-      auto work = make_work_guard(service);
-      service.run();
-    });
+void pinCurrentThread(int cpu) {
+#ifdef __linux__
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(cpu, &cpus);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+    std::cerr << "Failed to pin thread to CPU " << cpu << std::endl;
   }
+#else
+  (void)cpu;
+#endif
+}
 
-  ip::tcp::acceptor acceptor(service);
+void listenOn(ip::tcp::acceptor &acceptor, int port, bool reuse_port) {
   ip::tcp::endpoint endpoint(ip::tcp::v4(), port);
   acceptor.open(endpoint.protocol());
   acceptor.set_option(ip::tcp::acceptor::reuse_address(true));
+  if (reuse_port) {
+    acceptor.set_option(
+        boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(
+            true));
+  }
   acceptor.bind(endpoint);
   acceptor.listen();
+}
+
+void runShared(const ServerConfig &config) {
+  boost::asio::io_context service;
+  boost::asio::thread_pool tp(config.thread_count);
+  registerServer({&service}, 1);
+
+  for (int i = 0; i < config.thread_count; ++i) {
+    post(tp, [&service, &config, i]() {
+      if (config.pin_threads) {
+        pinCurrentThread(cpuFor(i));
+      }
+      auto work = make_work_guard(service);
+      service.run();
+    });
+  }
 
-  for (int i = 0; i < thread_count; ++i) {
-    auto sock = std::make_shared<ip::tcp::socket>(service);
+  ip::tcp::acceptor acceptor(service);
+  listenOn(acceptor, config.port, false);
+
+  for (int i = 0; i < config.thread_count; ++i) {
+    auto sock = peerSocket(service, true);
     acceptor.async_accept(*sock, std::bind(&onAcceptAsync, std::ref(acceptor),
-                                           std::ref(service), sock,
-                                           std::placeholders::_1));
+                                           std::ref(service),
+                                           std::ref(acceptedCounter(0)), true,
+                                           sock, std::placeholders::_1));
   }
 
   tp.join();
+  unregisterServer();
+}
+
+void runPerCore(const ServerConfig &config) {
+  std::vector<std::unique_ptr<boost::asio::io_context>> services;
+  std::vector<std::unique_ptr<ip::tcp::acceptor>> acceptors;
+  std::vector<boost::asio::io_context *> contexts;
+
+  for (int i = 0; i < config.thread_count; ++i) {
+    services.push_back(std::make_unique<boost::asio::io_context>(1));
+    contexts.push_back(services.back().get());
+  }
+  registerServer(contexts, services.size());
+
+  for (int i = 0; i < config.thread_count; ++i) {
+    acceptors.push_back(std::make_unique<ip::tcp::acceptor>(*services[i]));
+    listenOn(*acceptors.back(), config.port, true);
+
+    auto sock = peerSocket(*services[i], false);
+    acceptors.back()->async_accept(
+        *sock, std::bind(&onAcceptAsync, std::ref(*acceptors.back()),
+                         std::ref(*services[i]), std::ref(acceptedCounter(i)),
+                         false, sock, std::placeholders::_1));
+  }
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < config.thread_count; ++i) {
+    threads.emplace_back([&services, &config, i]() {
+      if (config.pin_threads) {
+        pinCurrentThread(cpuFor(i));
+      }
+      auto work = make_work_guard(*services[i]);
+      services[i]->run();
+    });
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  unregisterServer();
+}
+
+void start_server(const ServerConfig &config) {
+  auto shedder_config = LoadShedder::instance().getConfig();
+  shedder_config.workers = config.thread_count;
+  LoadShedder::instance().configure(shedder_config);
+
+  if (config.cpu_thread_count > 0) {
+    CpuPool::instance().configure(config.cpu_thread_count);
+  }
+
+  LevelGovernor::instance().configure(LevelGovernor::Config{
+      std::chrono::milliseconds(config.latency_target_ms)});
+
+  CodecPlanner::instance().calibrate();
+
+  switch (config.mode) {
+  case ServerMode::SHARED:
+    runShared(config);
+    break;
+
+  case ServerMode::PER_CORE:
+    runPerCore(config);
+    break;
+
+  default:
+    throw std::runtime_error("Unknown server mode");
+  }
+}
+
+void stop_server() {
+  std::lock_guard<std::mutex> lock(running_mutex);
+  for (auto *service : running_services) {
+    service->stop();
+  }
+}
+
+std::vector<size_t> accepted_connections() {
+  std::lock_guard<std::mutex> lock(running_mutex);
+  std::vector<size_t> counts;
+  for (const auto &accepted : running_accepted) {
+    counts.push_back(accepted->load());
+  }
+  return counts;
+}
+
+void start_server(int port, int thread_count) {
+  ServerConfig config;
+  config.port = port;
+  config.thread_count = thread_count;
+  start_server(config);
 }
@@ -2,23 +2,30 @@
 
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
+#include <atomic>
+#include <vector>
 
 namespace ip = boost::asio::ip;
 namespace http = boost::beast::http;
 
-void start_server(int port = 8080, int thread_count = 4);
+enum class ServerMode { SHARED, PER_CORE };
 
-void onReadAsync(std::shared_ptr<ip::tcp::socket> sock,
-                 std::shared_ptr<boost::beast::flat_buffer> buf,
-                 std::shared_ptr<http::request<http::string_body>> req,
-                 boost::beast::error_code ec, std::size_t bytes_transferred);
+struct ServerConfig {
+  int port = 8080;
+  int thread_count = 4;
+  ServerMode mode = ServerMode::SHARED;
+  bool pin_threads = false;
+  int cpu_thread_count = 0;
+  int latency_target_ms = 0;
+};
 
-void onWriteAsync(std::shared_ptr<ip::tcp::socket> sock,
-                  std::shared_ptr<http::response<http::string_body>> resp,
-                  bool keepAlive, boost::beast::error_code ec,
-                  std::size_t bytes_transferred);
+void start_server(const ServerConfig &config);
+void start_server(int port = 8080, int thread_count = 4);
+void stop_server();
+std::vector<size_t> accepted_connections();
 
 void onAcceptAsync(ip::tcp::acceptor &acceptor,
                    boost::asio::io_context &service,
+                   std::atomic<size_t> &accepted, bool shared,
                    std::shared_ptr<ip::tcp::socket> sock,
                    const boost::system::error_code &ec);
@@ -0,0 +1,187 @@
+#include "session.h"
+#include "cpu_pool.h"
+#include "request/request_handler.h"
+#include <iostream>
+#include <limits>
+
+Session::Session(ip::tcp::socket socket)
+    : Session(std::move(socket),
+              [](const Request &req, MemoryAccount &memory, Response &resp) {
+                return async_handle_request(req, memory, resp);
+              }) {}
+
+Session::Session(ip::tcp::socket socket, Handler handler)
+    : socket_(std::move(socket)), timer_(socket_.get_executor()),
+      handler_(std::move(handler)),
+      response_(std::piecewise_construct, std::make_tuple(),
+                std::make_tuple(HandlerAllocator<char>(&response_memory_))),
+      continue_(http::status::continue_, 11) {}
+
+void Session::start() {
+  auto self = shared_from_this();
+  auto executor = socket_.get_executor();
+  boost::asio::co_spawn(
+      executor, [self]() { return self->watchDeadline(); },
+      boost::asio::detached);
+  boost::asio::co_spawn(
+      executor, [self]() { return self->run(); }, boost::asio::detached);
+}
+
+boost::asio::awaitable<void> Session::run() {
+  try {
+    while (co_await serveRequest()) {
+    }
+    close();
+  } catch (const boost::system::system_error &e) {
+    auto ec = e.code();
+    if (!timed_out_ && ec != boost::asio::error::operation_aborted &&
+        ec != http::error::end_of_stream) {
+      std::cerr << ec.message() << std::endl;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "Session error: " << e.what() << std::endl;
+  }
+  finishRequest();
+
+  boost::system::error_code ignored;
+  socket_.close(ignored);
+  timer_.cancel();
+}
+
+// One wait covers the connection; moving the deadline later only updates
+// deadline_, so a request re-arms the timer at most once.
+boost::asio::awaitable<void> Session::watchDeadline() {
+  boost::system::error_code ec;
+  while (socket_.is_open()) {
+    if (deadline_ <= std::chrono::steady_clock::now()) {
+      timed_out_ = true;
+      socket_.close(ec);
+      break;
+    }
+    timer_.expires_at(deadline_);
+    co_await timer_.async_wait(
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+  }
+}
+
+void Session::expiresAfter(std::chrono::seconds timeout) {
+  deadline_ = std::chrono::steady_clock::now() + timeout;
+  if (deadline_ < timer_.expiry()) {
+    timer_.expires_at(deadline_);
+  }
+}
+
+void Session::expiresNever() {
+  deadline_ = std::chrono::steady_clock::time_point::max();
+}
+
+boost::asio::awaitable<bool> Session::serveRequest() {
+  parser_.emplace(std::piecewise_construct, std::make_tuple(),
+                  std::make_tuple(
+                      std::pmr::polymorphic_allocator<char>(&fields_memory_)));
+  parser_->body_limit(std::numeric_limits<std::uint64_t>::max());
+
+  expiresAfter(timeouts_.header);
+  co_await http::async_read_header(socket_, buffer_, *parser_,
+                                   boost::asio::use_awaitable);
+
+  Admission admission = co_await admit();
+  if (!admission.accepted()) {
+    response_ = rejection_response(admission, parser_->get().version());
+    finishRequest();
+    co_await write();
+    co_return false;
+  }
+
+  const auto &header = parser_->get();
+  if (boost::beast::iequals(header[http::field::expect], "100-continue")) {
+    continue_.version(header.version());
+    expiresAfter(timeouts_.write);
+    co_await http::async_write(socket_, continue_,
+                               boost::asio::use_awaitable);
+  }
+
+  parser_->body_limit(LoadShedder::instance().getConfig().max_body_size);
+  expiresAfter(timeouts_.body);
+  co_await http::async_read(socket_, buffer_, *parser_,
+                            boost::asio::use_awaitable);
+
+  co_await handle();
+  bool keep_alive = parser_->get().keep_alive();
+  co_await write();
+  finishRequest();
+
+  co_return keep_alive;
+}
+
+boost::asio::awaitable<Admission> Session::admit() {
+  auto &shedder = LoadShedder::instance();
+  RequestCost cost = shedder.estimateCost(parser_->get());
+  Admission admission = shedder.admit(cost);
+
+  if (admission.accepted()) {
+    ticket_.emplace(shedder, std::move(cost));
+    try {
+      co_await reserveBody(ticket_->getCost().body_bytes);
+    } catch (const MemoryBudgetExceeded &e) {
+      admission.decision = AdmissionDecision::OVERLOADED;
+      admission.retry_after = e.getRetryAfter();
+      admission.reason = e.what();
+    } catch (const RequestTooLarge &e) {
+      admission.decision = AdmissionDecision::TOO_LARGE;
+      admission.reason = e.what();
+    }
+  }
+
+  co_return admission;
+}
+
+// Queues on a timer instead of blocking the I/O thread while the memory
+// budget is full, for at most the budget's queue timeout.
+boost::asio::awaitable<void> Session::reserveBody(size_t bytes) {
+  auto &budget = memory_.getBudget();
+  auto deadline = std::chrono::steady_clock::now() + budget.getQueueTimeout();
+  boost::system::error_code ec;
+  while (true) {
+    uint64_t generation = budget.getReleaseGeneration();
+    if (memory_.tryReserve(bytes)) {
+      co_return;
+    }
+    if (ec == boost::asio::error::timed_out) {
+      throw budget.reject();
+    }
+    co_await budget.asyncWaitForRelease(
+        socket_.get_executor(), generation, deadline,
+        boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+  }
+}
+
+boost::asio::awaitable<void> Session::handle() {
+  const Request &req = parser_->get();
+
+  if (req.body().size() < offload_threshold_) {
+    co_await handler_(req, memory_, response_);
+    co_return;
+  }
+
+  expiresNever();
+  co_await CpuPool::instance().run(
+      [this, &req]() { return handler_(req, memory_, response_); });
+}
+
+boost::asio::awaitable<void> Session::write() {
+  serializer_.emplace(response_);
+  expiresAfter(timeouts_.write);
+  co_await http::async_write(socket_, *serializer_,
+                             boost::asio::use_awaitable);
+}
+
+void Session::finishRequest() {
+  ticket_.reset();
+  memory_.release(memory_.getReserved());
+}
+
+void Session::close() {
+  boost::system::error_code ignored;
+  socket_.shutdown(ip::tcp::socket::shutdown_both, ignored);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "../memory/memory_budget.h"
+#include "handler_memory.h"
+#include "load_shedder.h"
+#include "request/http_message.h"
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+namespace ip = boost::asio::ip;
+namespace http = boost::beast::http;
+
+class Session : public std::enable_shared_from_this<Session> {
+public:
+  using Request = HttpRequest;
+  using Response = HttpResponse;
+  using Handler = std::function<boost::asio::awaitable<void>(
+      const Request &, MemoryAccount &, Response &)>;
+
+  struct Timeouts {
+    std::chrono::seconds header = std::chrono::seconds(30);
+    std::chrono::seconds body = std::chrono::seconds(300);
+    std::chrono::seconds write = std::chrono::seconds(300);
+  };
+
+  explicit Session(ip::tcp::socket socket);
+  Session(ip::tcp::socket socket, Handler handler);
+
+  void start();
+
+  void setTimeouts(const Timeouts &timeouts) { timeouts_ = timeouts; }
+  void setOffloadThreshold(size_t bytes) { offload_threshold_ = bytes; }
+
+  // Memory the response's header fields come from.
+  const HandlerMemory &getResponseMemory() const { return response_memory_; }
+
+private:
+  ip::tcp::socket socket_;
+  boost::asio::steady_timer timer_;
+  std::chrono::steady_clock::time_point deadline_ =
+      std::chrono::steady_clock::time_point::max();
+  bool timed_out_ = false;
+  Handler handler_;
+  Timeouts timeouts_;
+  size_t offload_threshold_ = 64 * 1024;
+  boost::beast::flat_buffer buffer_;
+  std::pmr::unsynchronized_pool_resource fields_memory_;
+  std::optional<http::request_parser<http::string_body,
+                                     std::pmr::polymorphic_allocator<char>>>
+      parser_;
+  // Only the response's fields use it, and only one thread fills or writes
+  // the response at a time, even when the handler is offloaded.
+  HandlerMemory response_memory_;
+  Response response_;
+  std::optional<http::response_serializer<ResponseBody, ResponseFields>>
+      serializer_;
+  http::response<http::empty_body> continue_;
+  MemoryAccount memory_;
+  std::optional<LoadShedder::Ticket> ticket_;
+
+  boost::asio::awaitable<void> run();
+  boost::asio::awaitable<void> watchDeadline();
+  boost::asio::awaitable<bool> serveRequest();
+  boost::asio::awaitable<void> handle();
+  boost::asio::awaitable<void> write();
+  void expiresAfter(std::chrono::seconds timeout);
+  void expiresNever();
+  boost::asio::awaitable<Admission> admit();
+  boost::asio::awaitable<void> reserveBody(size_t bytes);
+  void finishRequest();
+  void close();
+};
@@ -0,0 +1,67 @@
+#include "sparse_map.h"
+#include <algorithm>
+#include <cstring>
+
+bool SparseMap::isZero(const uint8_t *data, size_t size) {
+  // A branch-free OR over whole words lets the compiler vectorise the loop.
+  uint64_t bits = 0;
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, data + i, sizeof(word));
+    bits |= word;
+  }
+  for (; i < size; ++i) {
+    bits |= data[i];
+  }
+  return bits == 0;
+}
+
+std::vector<SparseRegion> SparseMap::scan(const uint8_t *data, size_t size) {
+  std::vector<SparseRegion> regions;
+  bool holes = false;
+  uint64_t data_start = 0;
+
+  size_t position = 0;
+  while (position < size) {
+    size_t length = std::min(kBlockSize, size - position);
+    if (!isZero(data + position, length)) {
+      position += length;
+      continue;
+    }
+
+    size_t run_end = position + length;
+    while (run_end < size) {
+      size_t next = std::min(kBlockSize, size - run_end);
+      if (!isZero(data + run_end, next)) {
+        break;
+      }
+      run_end += next;
+    }
+
+    if (run_end - position >= kMinHole) {
+      if (position > data_start) {
+        regions.push_back({data_start, position - data_start});
+      }
+      data_start = run_end;
+      holes = true;
+    }
+    position = run_end;
+  }
+
+  if (!holes) {
+    return {};
+  }
+  if (data_start < size || regions.empty()) {
+    regions.push_back({data_start, size - data_start});
+  }
+  return regions;
+}
+
+uint64_t SparseMap::dataBytes(const std::vector<SparseRegion> &regions) {
+  uint64_t total = 0;
+  for (const auto &region : regions) {
+    total += region.length;
+  }
+  return total;
+}
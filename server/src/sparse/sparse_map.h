@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct SparseRegion {
+  uint64_t offset = 0;
+  uint64_t length = 0;
+
+  bool operator==(const SparseRegion &other) const {
+    return offset == other.offset && length == other.length;
+  }
+};
+
+// Finds the zero runs in a file body that tar can store as holes. The result
+// lists the data regions around them, in the form libarchive's sparse map
+// expects.
+class SparseMap {
+public:
+  static constexpr size_t kBlockSize = 4096;
+  static constexpr size_t kMinHole = 64 * 1024;
+
+  static bool isZero(const uint8_t *data, size_t size);
+
+  // Empty when no hole of at least kMinHole exists; a file of zeros yields a
+  // single empty region at its end.
+  static std::vector<SparseRegion> scan(const uint8_t *data, size_t size);
+
+  static uint64_t dataBytes(const std::vector<SparseRegion> &regions);
+};
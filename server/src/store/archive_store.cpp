@@ -0,0 +1,404 @@
+#include "archive_store.h"
+#include "../digest/digest.h"
+#include "../factory/factory.h"
+#include "../memory/memory_budget.h"
+#include <algorithm>
+#include <archive.h>
+#include <archive_entry.h>
+#include <cerrno>
+#include <stdexcept>
+
+namespace {
+const uint64_t kNoDataOffset = ~0ULL;
+const uint64_t kTarBlockSize = 512;
+
+std::string zipMethodName(uint16_t method) {
+  switch (method) {
+  case ZipReader::kMethodStore:
+    return "store";
+  case ZipReader::kMethodDeflate:
+    return "deflate";
+  case 12:
+    return "bzip2";
+  case 14:
+    return "lzma";
+  case 93:
+    return "zstd";
+  case 95:
+    return "xz";
+  default:
+    return "method-" + std::to_string(method);
+  }
+}
+
+struct archive *openReader(const SharedBuffer &data) {
+  struct archive *a = archive_read_new();
+  if (!a) {
+    throw std::runtime_error("Failed to create archive reader");
+  }
+  archive_read_support_format_all(a);
+  archive_read_support_filter_all(a);
+
+  if (archive_read_open_memory(a, data->data(), data->size()) != ARCHIVE_OK) {
+    std::string error = archive_error_string(a) ? archive_error_string(a) : "";
+    archive_read_free(a);
+    throw std::runtime_error("Failed to open archive for reading: " + error);
+  }
+  return a;
+}
+
+// Feeds libarchive the inflated tar while the gzip index is being built.
+struct InflatedSource {
+  GzipIndex::Builder *builder;
+  std::exception_ptr error;
+};
+
+la_ssize_t readInflated(struct archive *a, void *client,
+                        const void **buffer) {
+  auto *source = static_cast<InflatedSource *>(client);
+  try {
+    auto chunk = source->builder->next();
+    *buffer = chunk.data();
+    return chunk.size();
+  } catch (...) {
+    source->error = std::current_exception();
+    archive_set_error(a, EIO, "Failed to inflate archive");
+    return ARCHIVE_FATAL;
+  }
+}
+
+struct archive *openInflated(InflatedSource &source) {
+  struct archive *a = archive_read_new();
+  if (!a) {
+    throw std::runtime_error("Failed to create archive reader");
+  }
+  archive_read_support_format_all(a);
+
+  if (archive_read_open(a, &source, nullptr, readInflated, nullptr) !=
+      ARCHIVE_OK) {
+    std::string error = archive_error_string(a) ? archive_error_string(a) : "";
+    archive_read_free(a);
+    if (source.error) {
+      std::rethrow_exception(source.error);
+    }
+    throw std::runtime_error("Failed to open archive for reading: " + error);
+  }
+  return a;
+}
+} // namespace
+
+StoredArchive::StoredArchive(std::string id, SharedBuffer data,
+                             uint64_t access_point_span)
+    : id_(std::move(id)), data_(std::move(data)) {
+  if (!data_ || data_->empty()) {
+    throw std::runtime_error("No archive data provided");
+  }
+
+  format_ = CompressorFactory::detectFormatFromData(*data_);
+  if (format_ == CompressionFormat::ZIP) {
+    indexZip();
+  } else {
+    indexStream(access_point_span);
+  }
+
+  if (format_ == CompressionFormat::TAR_ZST &&
+      SeekableZstd::hasSeekTable(data_->data(), data_->size())) {
+    seek_table_.emplace(data_->data(), data_->size());
+  }
+
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    by_name_[entries_[i].name] = i;
+  }
+}
+
+uint64_t StoredArchive::getTarEnd() const {
+  if (tar_end_ == kNoDataOffset) {
+    throw std::runtime_error("Archive " + id_ + " has no known tar end");
+  }
+  return tar_end_;
+}
+
+size_t StoredArchive::getFootprint() const {
+  return data_->size() + gzip_index_.getMemoryUsage() +
+         (seek_table_ ? seek_table_->getMemoryUsage() : 0);
+}
+
+size_t StoredArchive::getAccessPointCount() const {
+  return seek_table_ ? seek_table_->getFrames().size()
+                     : gzip_index_.getPointCount();
+}
+
+const ArchiveEntryInfo *StoredArchive::find(const std::string &name) const {
+  auto it = by_name_.find(name);
+  return it == by_name_.end() ? nullptr : &entries_[it->second];
+}
+
+std::vector<uint8_t> StoredArchive::readEntry(const ArchiveEntryInfo &entry,
+                                              MemoryAccount *memory) const {
+  size_t index = indexOf(entry);
+
+  if (memory) {
+    memory->reserve(entry.size);
+  }
+
+  if (!zip_entries_.empty() && ZipReader::canRead(zip_entries_[index])) {
+    ZipReader reader(data_->data(), data_->size());
+    return reader.readEntry(zip_entries_[index]);
+  }
+  if (seek_table_ && data_offsets_[index] != kNoDataOffset) {
+    return seek_table_->read(data_offsets_[index], entry.size, memory);
+  }
+  if (!gzip_index_.empty() && data_offsets_[index] != kNoDataOffset) {
+    return gzip_index_.read(data_->data(), data_->size(), data_offsets_[index],
+                            entry.size);
+  }
+  return scanEntry(headers_[index], entry.size);
+}
+
+const ZipEntry *
+StoredArchive::findZipEntry(const ArchiveEntryInfo &entry) const {
+  size_t index = indexOf(entry);
+  return zip_entries_.empty() ? nullptr : &zip_entries_[index];
+}
+
+bool StoredArchive::findGzipMember(const ArchiveEntryInfo &entry,
+                                   uint64_t &begin, uint64_t &end) const {
+  size_t index = indexOf(entry);
+  if (gzip_index_.empty() || data_offsets_[index] == kNoDataOffset ||
+      data_offsets_[index] <= entry.offset) {
+    return false;
+  }
+
+  uint64_t padded = (entry.size + kTarBlockSize - 1) / kTarBlockSize;
+  return gzip_index_.findMember(entry.offset,
+                                data_offsets_[index] + padded * kTarBlockSize,
+                                begin, end);
+}
+
+size_t StoredArchive::indexOf(const ArchiveEntryInfo &entry) const {
+  size_t index = &entry - entries_.data();
+  if (index >= entries_.size()) {
+    throw std::runtime_error("Entry does not belong to archive " + id_);
+  }
+  return index;
+}
+
+void StoredArchive::indexZip() {
+  ZipReader reader(data_->data(), data_->size());
+  auto zip_entries = reader.readCentralDirectory();
+
+  for (size_t i = 0; i < zip_entries.size(); ++i) {
+    const ZipEntry &zip_entry = zip_entries[i];
+    if (zip_entry.isDirectory()) {
+      continue;
+    }
+
+    ArchiveEntryInfo info;
+    info.name = zip_entry.name;
+    info.offset = zip_entry.offset;
+    info.compressed_size = zip_entry.compressed_size;
+    info.size = zip_entry.size;
+    info.crc = zip_entry.crc;
+    info.method = zipMethodName(zip_entry.method);
+
+    entries_.push_back(std::move(info));
+    zip_entries_.push_back(zip_entry);
+    headers_.push_back(i);
+  }
+}
+
+void StoredArchive::indexStream(uint64_t access_point_span) {
+  // tar.gz archives are inflated once, for both the entry list and the
+  // access points.
+  std::optional<GzipIndex::Builder> gzip;
+  InflatedSource source{};
+  if (format_ == CompressionFormat::TAR_GZ) {
+    gzip.emplace(data_->data(), data_->size(), access_point_span);
+    source.builder = &*gzip;
+  }
+  struct archive *a = gzip ? openInflated(source) : openReader(data_);
+
+  try {
+    struct archive_entry *entry;
+    size_t header = 0;
+    int status;
+
+    while ((status = archive_read_next_header(a, &entry)) == ARCHIVE_OK) {
+      uint64_t stored = std::max<la_int64_t>(archive_entry_size(entry), 0);
+      tar_end_ = archive_entry_sparse_count(entry) > 0
+                     ? kNoDataOffset
+                     : archive_filter_bytes(a, 0) +
+                           (stored + kTarBlockSize - 1) / kTarBlockSize *
+                               kTarBlockSize;
+
+      if (archive_entry_filetype(entry) == AE_IFDIR) {
+        ++header;
+        continue;
+      }
+
+      ArchiveEntryInfo info;
+      info.name = archive_entry_pathname(entry);
+      info.offset = archive_read_header_position(a);
+      info.size = std::max<la_int64_t>(archive_entry_size(entry), 0);
+      info.compressed_size = info.size;
+
+      const char *filter = gzip ? "gzip" : archive_filter_name(a, 0);
+      info.method = filter && std::string(filter) != "none" ? filter : "store";
+
+      size_t source = header;
+      uint64_t data_offset = archive_entry_sparse_count(entry) > 0
+                                 ? kNoDataOffset
+                                 : archive_filter_bytes(a, 0);
+      const char *hardlink = archive_entry_hardlink(entry);
+      if (hardlink && info.size == 0) {
+        auto target = by_name_.find(hardlink);
+        if (target != by_name_.end()) {
+          info.size = entries_[target->second].size;
+          info.compressed_size = 0;
+          source = headers_[target->second];
+          data_offset = data_offsets_[target->second];
+        }
+      }
+
+      by_name_[info.name] = entries_.size();
+      entries_.push_back(std::move(info));
+      headers_.push_back(source);
+      data_offsets_.push_back(data_offset);
+
+      archive_read_data_skip(a);
+      ++header;
+    }
+
+    if (status != ARCHIVE_EOF) {
+      if (source.error) {
+        std::rethrow_exception(source.error);
+      }
+      throw std::runtime_error("Failed to index archive: " +
+                               std::string(archive_error_string(a)));
+    }
+    archive_read_free(a);
+  } catch (...) {
+    archive_read_free(a);
+    throw;
+  }
+
+  if (gzip) {
+    gzip_index_ = gzip->finish();
+  }
+}
+
+std::vector<uint8_t> StoredArchive::scanEntry(size_t header,
+                                              size_t size) const {
+  struct archive *a = openReader(data_);
+
+  try {
+    struct archive_entry *entry;
+    for (size_t i = 0; i <= header; ++i) {
+      if (archive_read_next_header(a, &entry) != ARCHIVE_OK) {
+        throw std::runtime_error("Archive " + id_ + " changed while reading");
+      }
+      if (i < header) {
+        archive_read_data_skip(a);
+      }
+    }
+
+    std::vector<uint8_t> data(size);
+    la_ssize_t bytes_read = size ? archive_read_data(a, data.data(), size) : 0;
+    if (bytes_read < 0) {
+      throw std::runtime_error("Failed to read file data: " +
+                               std::string(archive_error_string(a)));
+    }
+    data.resize(bytes_read);
+
+    archive_read_free(a);
+    return data;
+  } catch (...) {
+    archive_read_free(a);
+    throw;
+  }
+}
+
+ArchiveStore::ArchiveStore(Config config) : config_(config) {}
+
+ArchiveStore &ArchiveStore::instance() {
+  static ArchiveStore store(Config{});
+  return store;
+}
+
+std::shared_ptr<const StoredArchive> ArchiveStore::put(SharedBuffer data) {
+  if (data->size() > config_.limit) {
+    throw RequestTooLarge("Archive exceeds the archive store limit");
+  }
+
+  std::string id = ContentHasher::digest(*data);
+  if (auto existing = get(id)) {
+    return existing;
+  }
+
+  auto archive = std::make_shared<const StoredArchive>(
+      id, std::move(data), config_.access_point_span);
+  if (archive->getFootprint() > config_.limit) {
+    throw RequestTooLarge("Archive index exceeds the archive store limit");
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = archives_.find(id);
+  if (it != archives_.end()) {
+    return it->second.archive;
+  }
+
+  lru_.push_front(id);
+  archives_[id] = Slot{archive, lru_.begin()};
+  bytes_ += archive->getFootprint();
+  evict();
+  return archive;
+}
+
+std::shared_ptr<const StoredArchive> ArchiveStore::get(const std::string &id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = archives_.find(id);
+  if (it == archives_.end()) {
+    return nullptr;
+  }
+  lru_.splice(lru_.begin(), lru_, it->second.lru);
+  return it->second.archive;
+}
+
+bool ArchiveStore::remove(const std::string &id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = archives_.find(id);
+  if (it == archives_.end()) {
+    return false;
+  }
+  bytes_ -= it->second.archive->getFootprint();
+  lru_.erase(it->second.lru);
+  archives_.erase(it);
+  return true;
+}
+
+size_t ArchiveStore::getCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return archives_.size();
+}
+
+size_t ArchiveStore::getBytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_;
+}
+
+size_t ArchiveStore::getEvictionCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return evictions_;
+}
+
+// The newest archive sits at the front and always fits, so it is never
+// evicted.
+void ArchiveStore::evict() {
+  while (bytes_ > config_.limit && lru_.size() > 1) {
+    auto it = archives_.find(lru_.back());
+    bytes_ -= it->second.archive->getFootprint();
+    archives_.erase(it);
+    lru_.pop_back();
+    ++evictions_;
+  }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "../cache/shared_buffer.h"
+#include "../compressor/compressor.h"
+#include "../gzip/gzip_index.h"
+#include "../zip/zip_reader.h"
+#include "../zstd/seekable_zstd.h"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class MemoryAccount;
+
+struct ArchiveEntryInfo {
+  std::string name;
+  uint64_t offset = 0;
+  uint64_t compressed_size = 0;
+  uint64_t size = 0;
+  uint32_t crc = 0;
+  std::string method;
+};
+
+class StoredArchive {
+public:
+  StoredArchive(std::string id, SharedBuffer data,
+                uint64_t access_point_span = 1024 * 1024);
+
+  const std::string &getId() const { return id_; }
+  CompressionFormat getFormat() const { return format_; }
+  size_t getSize() const { return data_->size(); }
+  size_t getFootprint() const;
+  size_t getAccessPointCount() const;
+  const SharedBuffer &getData() const { return data_; }
+  const std::vector<ArchiveEntryInfo> &getEntries() const { return entries_; }
+  const GzipIndex &getGzipIndex() const { return gzip_index_; }
+  uint64_t getTarEnd() const;
+
+  const ArchiveEntryInfo *find(const std::string &name) const;
+  std::vector<uint8_t> readEntry(const ArchiveEntryInfo &entry,
+                                 MemoryAccount *memory = nullptr) const;
+
+  const ZipEntry *findZipEntry(const ArchiveEntryInfo &entry) const;
+  bool findGzipMember(const ArchiveEntryInfo &entry, uint64_t &begin,
+                      uint64_t &end) const;
+
+private:
+  std::string id_;
+  CompressionFormat format_;
+  SharedBuffer data_;
+  std::vector<ArchiveEntryInfo> entries_;
+  std::vector<ZipEntry> zip_entries_;
+  std::vector<size_t> headers_;
+  std::vector<uint64_t> data_offsets_;
+  GzipIndex gzip_index_;
+  uint64_t tar_end_ = 0;
+  std::optional<SeekableZstd> seek_table_;
+  std::unordered_map<std::string, size_t> by_name_;
+
+  size_t indexOf(const ArchiveEntryInfo &entry) const;
+  void indexZip();
+  void indexStream(uint64_t access_point_span);
+  std::vector<uint8_t> scanEntry(size_t header, size_t size) const;
+};
+
+class ArchiveStore {
+public:
+  struct Config {
+    size_t limit = 1024 * 1024 * 1024;
+    uint64_t access_point_span = 1024 * 1024;
+  };
+
+  explicit ArchiveStore(Config config);
+
+  static ArchiveStore &instance();
+
+  std::shared_ptr<const StoredArchive> put(SharedBuffer data);
+  std::shared_ptr<const StoredArchive> get(const std::string &id);
+  bool remove(const std::string &id);
+
+  size_t getCount() const;
+  size_t getBytes() const;
+  size_t getLimit() const { return config_.limit; }
+  size_t getEvictionCount() const;
+
+private:
+  struct Slot {
+    std::shared_ptr<const StoredArchive> archive;
+    std::list<std::string>::iterator lru;
+  };
+
+  mutable std::mutex mutex_;
+  Config config_;
+  size_t bytes_ = 0;
+  size_t evictions_ = 0;
+  std::list<std::string> lru_;
+  std::unordered_map<std::string, Slot> archives_;
+
+  void evict();
+};
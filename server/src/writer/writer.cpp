@@ -6,6 +6,7 @@ void ArchiveWriter::write(const ArchiveProcessor &processor) {
 
   switch (processor.getOperation()) {
   case ArchiveOperation::COMPRESS:
+  case ArchiveOperation::CONVERT:
     binary_buffer_ = processor.getArchiveData();
     break;
 
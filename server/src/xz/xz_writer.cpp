@@ -0,0 +1,380 @@
+#include "xz_writer.h"
+#include <archive.h>
+#include <archive_entry.h>
+#include <array>
+#include <cmath>
+#include <lzma.h>
+#include <stdexcept>
+
+namespace {
+const uint32_t kDeltaDistances[] = {1, 2, 3, 4, 8, 12, 16};
+const double kMinDeltaEntropy = 2.0;
+const double kDeltaGain = 0.7;
+
+uint16_t read16(const uint8_t *data) { return data[0] | (data[1] << 8); }
+
+uint32_t read32(const uint8_t *data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) |
+         (static_cast<uint32_t>(data[3]) << 24);
+}
+
+bool isX86Executable(const uint8_t *data, size_t size) {
+  // ELF, little endian, EM_386 or EM_X86_64.
+  if (size >= 20 && data[0] == 0x7f && data[1] == 'E' && data[2] == 'L' &&
+      data[3] == 'F' && data[5] == 1) {
+    uint16_t machine = read16(data + 18);
+    return machine == 3 || machine == 62;
+  }
+
+  // PE with an i386 or AMD64 machine type.
+  if (size >= 64 && data[0] == 'M' && data[1] == 'Z') {
+    uint32_t pe = read32(data + 0x3c);
+    if (pe + 6 <= size && data[pe] == 'P' && data[pe + 1] == 'E' &&
+        data[pe + 2] == 0 && data[pe + 3] == 0) {
+      uint16_t machine = read16(data + pe + 4);
+      return machine == 0x14c || machine == 0x8664;
+    }
+  }
+
+  // Mach-O, 32 or 64 bit, CPU_TYPE_X86 with or without the 64-bit flag.
+  if (size >= 8 && (read32(data) == 0xfeedface || read32(data) == 0xfeedfacf)) {
+    return (read32(data + 4) & 0xffffff) == 7;
+  }
+  return false;
+}
+
+double entropy(const std::array<size_t, 256> &counts, size_t total) {
+  double bits = 0.0;
+  for (size_t count : counts) {
+    if (count) {
+      double p = static_cast<double>(count) / total;
+      bits -= p * std::log2(p);
+    }
+  }
+  return bits;
+}
+
+const size_t kStreamChunkSize = 64 * 1024;
+
+// The prefilter, if any, followed by LZMA2 at level.
+struct FilterChain {
+  lzma_options_lzma lzma;
+  lzma_options_delta delta{};
+  lzma_filter filters[3];
+
+  bool init(int level, const PrefilterChoice &filter) {
+    if (lzma_lzma_preset(&lzma, level)) {
+      return false;
+    }
+    delta.type = LZMA_DELTA_TYPE_BYTE;
+    delta.dist = filter.distance;
+
+    size_t count = 0;
+    if (filter.kind == Prefilter::X86) {
+      filters[count++] = {LZMA_FILTER_X86, nullptr};
+    } else if (filter.kind == Prefilter::DELTA) {
+      filters[count++] = {LZMA_FILTER_DELTA, &delta};
+    }
+    filters[count++] = {LZMA_FILTER_LZMA2, &lzma};
+    filters[count] = {LZMA_VLI_UNKNOWN, nullptr};
+    return true;
+  }
+};
+
+lzma_ret encodeBlock(const uint8_t *data, size_t size, int level,
+                     const PrefilterChoice &filter, lzma_index *index,
+                     std::vector<uint8_t> &output) {
+  FilterChain chain;
+  if (!chain.init(level, filter)) {
+    return LZMA_OPTIONS_ERROR;
+  }
+
+  lzma_block block{};
+  block.version = 0;
+  block.check = LZMA_CHECK_CRC64;
+  block.filters = chain.filters;
+
+  size_t start = output.size();
+  size_t position = start;
+  output.resize(start + lzma_block_buffer_bound(size));
+  lzma_ret ret = lzma_block_buffer_encode(&block, nullptr, data, size,
+                                          output.data(), &position,
+                                          output.size());
+  output.resize(ret == LZMA_OK ? position : start);
+  if (ret != LZMA_OK) {
+    return ret;
+  }
+  return lzma_index_append(index, nullptr, lzma_block_unpadded_size(&block),
+                           block.uncompressed_size);
+}
+
+void appendStreamHeader(std::vector<uint8_t> &output) {
+  lzma_stream_flags flags{};
+  flags.version = 0;
+  flags.check = LZMA_CHECK_CRC64;
+
+  size_t position = output.size();
+  output.resize(position + LZMA_STREAM_HEADER_SIZE);
+  if (lzma_stream_header_encode(&flags, output.data() + position) !=
+      LZMA_OK) {
+    throw std::runtime_error("Failed to encode xz stream header");
+  }
+}
+
+void appendIndexAndFooter(const lzma_index *index,
+                          std::vector<uint8_t> &output) {
+  size_t index_size = lzma_index_size(index);
+  size_t position = output.size();
+  output.resize(position + index_size + LZMA_STREAM_HEADER_SIZE);
+  if (lzma_index_buffer_encode(index, output.data(), &position,
+                               output.size()) != LZMA_OK) {
+    throw std::runtime_error("Failed to encode xz index");
+  }
+
+  lzma_stream_flags flags{};
+  flags.version = 0;
+  flags.check = LZMA_CHECK_CRC64;
+  flags.backward_size = index_size;
+  if (lzma_stream_footer_encode(&flags, output.data() + position) !=
+      LZMA_OK) {
+    throw std::runtime_error("Failed to encode xz stream footer");
+  }
+}
+} // namespace
+
+PrefilterChoice XzWriter::detect(const uint8_t *data, size_t size) {
+  PrefilterChoice choice;
+  if (isX86Executable(data, size)) {
+    choice.kind = Prefilter::X86;
+    return choice;
+  }
+
+  size = std::min(size, kDetectSample);
+  if (size < 1024) {
+    return choice;
+  }
+
+  std::array<size_t, 256> counts{};
+  for (size_t i = 0; i < size; ++i) {
+    ++counts[data[i]];
+  }
+  double plain = entropy(counts, size);
+  if (plain < kMinDeltaEntropy) {
+    return choice;
+  }
+
+  double best = plain * kDeltaGain;
+  for (uint32_t distance : kDeltaDistances) {
+    counts.fill(0);
+    for (size_t i = distance; i < size; ++i) {
+      ++counts[static_cast<uint8_t>(data[i] - data[i - distance])];
+    }
+    double delta = entropy(counts, size - distance);
+    if (delta < best) {
+      best = delta;
+      choice.kind = Prefilter::DELTA;
+      choice.distance = distance;
+    }
+  }
+  return choice;
+}
+
+std::string XzWriter::describe(const PrefilterChoice &choice) {
+  switch (choice.kind) {
+  case Prefilter::X86:
+    return "x86";
+  case Prefilter::DELTA:
+    return "delta:" + std::to_string(choice.distance);
+  default:
+    return "none";
+  }
+}
+
+std::vector<XzBlock> XzWriter::planBlocks(const std::vector<uint8_t> &tar) {
+  std::vector<XzBlock> blocks;
+
+  struct archive *a = archive_read_new();
+  if (!a) {
+    throw std::runtime_error("Failed to create archive reader");
+  }
+  archive_read_support_format_tar(a);
+
+  try {
+    if (archive_read_open_memory(a, tar.data(), tar.size()) != ARCHIVE_OK) {
+      throw std::runtime_error("Failed to read tar stream");
+    }
+
+    std::vector<uint8_t> head(kDetectSample);
+    struct archive_entry *entry = nullptr;
+    int status;
+    while ((status = archive_read_next_header(a, &entry)) == ARCHIVE_OK) {
+      uint64_t offset = archive_read_header_position(a);
+      la_ssize_t read = archive_read_data(a, head.data(), head.size());
+      PrefilterChoice filter =
+          read > 0 ? detect(head.data(), read) : PrefilterChoice{};
+
+      if (blocks.empty() || !(blocks.back().filter == filter)) {
+        if (!blocks.empty()) {
+          blocks.back().size = offset - blocks.back().offset;
+        } else {
+          offset = 0;
+        }
+        blocks.push_back({offset, 0, 0, filter});
+      }
+      ++blocks.back().entries;
+    }
+    if (status != ARCHIVE_EOF) {
+      throw std::runtime_error("Failed to read tar stream: " +
+                               std::string(archive_error_string(a)));
+    }
+    archive_read_free(a);
+  } catch (...) {
+    archive_read_free(a);
+    throw;
+  }
+
+  if (blocks.empty()) {
+    blocks.push_back({0, 0, 0, PrefilterChoice{}});
+  }
+  blocks.back().size = tar.size() - blocks.back().offset;
+  return blocks;
+}
+
+std::vector<uint8_t> XzWriter::compress(const std::vector<uint8_t> &tar,
+                                        int level,
+                                        std::vector<XzBlock> *blocks) {
+  std::vector<XzBlock> planned = planBlocks(tar);
+
+  std::vector<uint8_t> output;
+  appendStreamHeader(output);
+
+  lzma_index *index = lzma_index_init(nullptr);
+  if (!index) {
+    throw std::runtime_error("Failed to allocate xz index");
+  }
+
+  try {
+    for (const auto &block : planned) {
+      lzma_ret ret = encodeBlock(tar.data() + block.offset, block.size, level,
+                                 block.filter, index, output);
+      if (ret != LZMA_OK) {
+        throw std::runtime_error("xz compression failed with code " +
+                                 std::to_string(ret));
+      }
+    }
+    appendIndexAndFooter(index, output);
+    lzma_index_end(index, nullptr);
+  } catch (...) {
+    lzma_index_end(index, nullptr);
+    throw;
+  }
+
+  if (blocks) {
+    *blocks = std::move(planned);
+  }
+  return output;
+}
+
+struct XzWriter::Stream::State {
+  lzma_stream stream = LZMA_STREAM_INIT;
+  FilterChain chain;
+  lzma_block block{};
+  lzma_index *index = nullptr;
+  bool open = false;
+};
+
+XzWriter::Stream::Stream(int level)
+    : state_(std::make_unique<State>()), level_(level),
+      chunk_(kStreamChunkSize) {
+  state_->index = lzma_index_init(nullptr);
+  if (!state_->index) {
+    throw std::runtime_error("Failed to allocate xz index");
+  }
+  appendStreamHeader(output_);
+}
+
+XzWriter::Stream::~Stream() {
+  lzma_end(&state_->stream);
+  lzma_index_end(state_->index, nullptr);
+}
+
+void XzWriter::Stream::setFilter(const PrefilterChoice &filter) {
+  if (state_->open && !(filter == filter_)) {
+    endBlock();
+  }
+  filter_ = filter;
+}
+
+void XzWriter::Stream::write(const uint8_t *data, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  if (!state_->open) {
+    startBlock();
+  }
+  encode(data, size, false);
+}
+
+std::vector<uint8_t> XzWriter::Stream::finish() {
+  if (state_->open) {
+    endBlock();
+  }
+  appendIndexAndFooter(state_->index, output_);
+  return std::move(output_);
+}
+
+void XzWriter::Stream::startBlock() {
+  if (!state_->chain.init(level_, filter_)) {
+    throw std::runtime_error("Invalid xz level " + std::to_string(level_));
+  }
+
+  lzma_block &block = state_->block;
+  block = lzma_block{};
+  block.version = 0;
+  block.check = LZMA_CHECK_CRC64;
+  block.filters = state_->chain.filters;
+  block.compressed_size = LZMA_VLI_UNKNOWN;
+  block.uncompressed_size = LZMA_VLI_UNKNOWN;
+  if (lzma_block_header_size(&block) != LZMA_OK) {
+    throw std::runtime_error("Failed to size xz block header");
+  }
+
+  size_t start = output_.size();
+  output_.resize(start + block.header_size);
+  if (lzma_block_header_encode(&block, output_.data() + start) != LZMA_OK ||
+      lzma_block_encoder(&state_->stream, &block) != LZMA_OK) {
+    throw std::runtime_error("Failed to start xz block");
+  }
+  state_->open = true;
+}
+
+void XzWriter::Stream::endBlock() {
+  encode(nullptr, 0, true);
+  state_->open = false;
+  const lzma_block &block = state_->block;
+  if (lzma_index_append(state_->index, nullptr,
+                        lzma_block_unpadded_size(&block),
+                        block.uncompressed_size) != LZMA_OK) {
+    throw std::runtime_error("Failed to index xz block");
+  }
+}
+
+void XzWriter::Stream::encode(const uint8_t *data, size_t size,
+                              bool end_block) {
+  lzma_stream &stream = state_->stream;
+  stream.next_in = data;
+  stream.avail_in = size;
+
+  lzma_ret ret;
+  do {
+    stream.next_out = chunk_.data();
+    stream.avail_out = chunk_.size();
+    ret = lzma_code(&stream, end_block ? LZMA_FINISH : LZMA_RUN);
+    if (ret != LZMA_OK && ret != LZMA_STREAM_END) {
+      throw std::runtime_error("xz compression failed with code " +
+                               std::to_string(ret));
+    }
+    output_.insert(output_.end(), chunk_.begin(),
+                   chunk_.end() - stream.avail_out);
+  } while (end_block ? ret != LZMA_STREAM_END : stream.avail_in > 0);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum class Prefilter { NONE, X86, DELTA };
+
+struct PrefilterChoice {
+  Prefilter kind = Prefilter::NONE;
+  uint32_t distance = 0;
+
+  bool operator==(const PrefilterChoice &other) const {
+    return kind == other.kind && distance == other.distance;
+  }
+  bool operator<(const PrefilterChoice &other) const {
+    return kind != other.kind ? kind < other.kind : distance < other.distance;
+  }
+};
+
+struct XzBlock {
+  uint64_t offset = 0;
+  uint64_t size = 0;
+  size_t entries = 0;
+  PrefilterChoice filter;
+};
+
+// Writes a tar stream as .xz with one block per run of entries that share a
+// prefilter, so executables get BCJ and fixed-width tables get delta while
+// the result stays readable by any xz decoder.
+class XzWriter {
+public:
+  static constexpr int kDefaultLevel = 6;
+  static constexpr size_t kDetectSample = 64 * 1024;
+
+  static PrefilterChoice detect(const uint8_t *data, size_t size);
+  static std::string describe(const PrefilterChoice &choice);
+
+  static std::vector<uint8_t> compress(const std::vector<uint8_t> &tar,
+                                       int level = kDefaultLevel,
+                                       std::vector<XzBlock> *blocks = nullptr);
+
+  // Encodes a tar stream written in pieces. The caller sets each entry's
+  // prefilter before writing its header, and a new block starts whenever
+  // the prefilter changes.
+  class Stream {
+  public:
+    explicit Stream(int level = kDefaultLevel);
+    ~Stream();
+
+    Stream(const Stream &) = delete;
+    Stream &operator=(const Stream &) = delete;
+
+    void setFilter(const PrefilterChoice &filter);
+    void write(const uint8_t *data, size_t size);
+    std::vector<uint8_t> finish();
+
+    size_t getOutputSize() const { return output_.size(); }
+
+  private:
+    struct State;
+
+    std::unique_ptr<State> state_;
+    int level_;
+    PrefilterChoice filter_;
+    std::vector<uint8_t> chunk_;
+    std::vector<uint8_t> output_;
+
+    void startBlock();
+    void endBlock();
+    void encode(const uint8_t *data, size_t size, bool end_block);
+  };
+
+private:
+  static std::vector<XzBlock> planBlocks(const std::vector<uint8_t> &tar);
+};
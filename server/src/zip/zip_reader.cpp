@@ -0,0 +1,198 @@
+#include "zip_reader.h"
+#include <algorithm>
+#include <stdexcept>
+#include <zlib.h>
+
+namespace {
+const uint32_t kLocalHeaderSignature = 0x04034b50;
+const uint32_t kCentralHeaderSignature = 0x02014b50;
+const uint32_t kEndOfCentralDirectorySignature = 0x06054b50;
+const uint32_t kZip64LocatorSignature = 0x07064b50;
+const uint32_t kZip64EndOfCentralDirectorySignature = 0x06064b50;
+const uint16_t kZip64ExtraField = 0x0001;
+const size_t kEndOfCentralDirectorySize = 22;
+const size_t kMaxCommentSize = 0xffff;
+const size_t kCentralHeaderSize = 46;
+const size_t kLocalHeaderSize = 30;
+} // namespace
+
+ZipReader::ZipReader(const uint8_t *data, size_t size)
+    : data_(data), size_(size) {}
+
+std::vector<ZipEntry> ZipReader::readCentralDirectory() const {
+  uint64_t directory_offset = 0;
+  uint64_t directory_size = 0;
+  uint64_t count = 0;
+  locateCentralDirectory(directory_offset, directory_size, count);
+
+  std::vector<ZipEntry> entries;
+  entries.reserve(
+      std::min<uint64_t>(count, directory_size / kCentralHeaderSize));
+
+  uint64_t position = directory_offset;
+  for (uint64_t i = 0; i < count; ++i) {
+    require(position, kCentralHeaderSize);
+    if (read32(position) != kCentralHeaderSignature) {
+      throw std::runtime_error("Corrupt ZIP central directory");
+    }
+
+    ZipEntry entry;
+    entry.flags = read16(position + 8);
+    entry.method = read16(position + 10);
+    entry.crc = read32(position + 16);
+    entry.compressed_size = read32(position + 20);
+    entry.size = read32(position + 24);
+    uint16_t name_length = read16(position + 28);
+    uint16_t extra_length = read16(position + 30);
+    uint16_t comment_length = read16(position + 32);
+    entry.offset = read32(position + 42);
+
+    uint64_t name_offset = position + kCentralHeaderSize;
+    require(name_offset, name_length + extra_length + comment_length);
+    entry.name.assign(reinterpret_cast<const char *>(data_ + name_offset),
+                      name_length);
+
+    uint64_t extra = name_offset + name_length;
+    uint64_t extra_end = extra + extra_length;
+    while (extra + 4 <= extra_end) {
+      uint16_t id = read16(extra);
+      uint16_t length = read16(extra + 2);
+      uint64_t field = extra + 4;
+      uint64_t field_end = std::min(field + length, extra_end);
+
+      if (id == kZip64ExtraField) {
+        if (entry.size == 0xffffffff && field + 8 <= field_end) {
+          entry.size = read64(field);
+          field += 8;
+        }
+        if (entry.compressed_size == 0xffffffff && field + 8 <= field_end) {
+          entry.compressed_size = read64(field);
+          field += 8;
+        }
+        if (entry.offset == 0xffffffff && field + 8 <= field_end) {
+          entry.offset = read64(field);
+        }
+      }
+      extra += 4 + length;
+    }
+
+    entries.push_back(std::move(entry));
+    position = extra_end + comment_length;
+  }
+
+  return entries;
+}
+
+bool ZipReader::locateCentralDirectory(uint64_t &offset, uint64_t &size,
+                                       uint64_t &count) const {
+  uint64_t eocd = findEndOfCentralDirectory();
+
+  count = read16(eocd + 10);
+  size = read32(eocd + 12);
+  offset = read32(eocd + 16);
+
+  bool zip64 = count == 0xffff || size == 0xffffffff || offset == 0xffffffff;
+  if (zip64) {
+    if (eocd < 20 || read32(eocd - 20) != kZip64LocatorSignature) {
+      throw std::runtime_error("Missing ZIP64 end of central directory");
+    }
+    uint64_t record = read64(eocd - 20 + 8);
+    if (read32(record) != kZip64EndOfCentralDirectorySignature) {
+      throw std::runtime_error("Corrupt ZIP64 end of central directory");
+    }
+    count = read64(record + 32);
+    size = read64(record + 40);
+    offset = read64(record + 48);
+  }
+
+  require(offset, size);
+  return zip64;
+}
+
+bool ZipReader::canRead(const ZipEntry &entry) {
+  return !entry.isEncrypted() &&
+         (entry.method == kMethodStore || entry.method == kMethodDeflate);
+}
+
+std::vector<uint8_t> ZipReader::readEntry(const ZipEntry &entry) const {
+  if (!canRead(entry)) {
+    throw std::runtime_error("Unsupported ZIP entry encoding: " + entry.name);
+  }
+
+  uint64_t payload = payloadOffset(entry);
+
+  std::vector<uint8_t> output;
+  if (entry.method == kMethodStore) {
+    output.assign(data_ + payload, data_ + payload + entry.compressed_size);
+  } else {
+    output.resize(entry.size + 1);
+
+    z_stream stream{};
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+      throw std::runtime_error("Failed to initialize inflate stream");
+    }
+    stream.next_in = const_cast<Bytef *>(data_ + payload);
+    stream.avail_in = entry.compressed_size;
+    stream.next_out = output.data();
+    stream.avail_out = output.size();
+
+    int result = inflate(&stream, Z_FINISH);
+    size_t produced = stream.total_out;
+    inflateEnd(&stream);
+
+    if (result != Z_STREAM_END || produced != entry.size) {
+      throw std::runtime_error("Failed to inflate ZIP entry: " + entry.name);
+    }
+    output.resize(produced);
+  }
+
+  if (crc32(0L, output.data(), output.size()) != entry.crc) {
+    throw std::runtime_error("CRC mismatch in ZIP entry: " + entry.name);
+  }
+  return output;
+}
+
+uint64_t ZipReader::payloadOffset(const ZipEntry &entry) const {
+  require(entry.offset, kLocalHeaderSize);
+  if (read32(entry.offset) != kLocalHeaderSignature) {
+    throw std::runtime_error("Corrupt ZIP local header: " + entry.name);
+  }
+  uint64_t payload = entry.offset + kLocalHeaderSize +
+                     read16(entry.offset + 26) + read16(entry.offset + 28);
+  require(payload, entry.compressed_size);
+  return payload;
+}
+
+uint16_t ZipReader::read16(uint64_t offset) const {
+  require(offset, 2);
+  return data_[offset] | (data_[offset + 1] << 8);
+}
+
+uint32_t ZipReader::read32(uint64_t offset) const {
+  return read16(offset) | (static_cast<uint32_t>(read16(offset + 2)) << 16);
+}
+
+uint64_t ZipReader::read64(uint64_t offset) const {
+  return read32(offset) | (static_cast<uint64_t>(read32(offset + 4)) << 32);
+}
+
+void ZipReader::require(uint64_t offset, uint64_t length) const {
+  if (offset > size_ || length > size_ - offset) {
+    throw std::runtime_error("Truncated ZIP archive");
+  }
+}
+
+uint64_t ZipReader::findEndOfCentralDirectory() const {
+  if (size_ < kEndOfCentralDirectorySize) {
+    throw std::runtime_error("Truncated ZIP archive");
+  }
+
+  uint64_t last = size_ - kEndOfCentralDirectorySize;
+  uint64_t first = last > kMaxCommentSize ? last - kMaxCommentSize : 0;
+  for (uint64_t position = last + 1; position-- > first;) {
+    if (read32(position) == kEndOfCentralDirectorySignature) {
+      return position;
+    }
+  }
+  throw std::runtime_error("ZIP end of central directory not found");
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ZipEntry {
+  std::string name;
+  uint16_t flags = 0;
+  uint16_t method = 0;
+  uint32_t crc = 0;
+  uint64_t compressed_size = 0;
+  uint64_t size = 0;
+  uint64_t offset = 0;
+
+  bool isDirectory() const { return !name.empty() && name.back() == '/'; }
+  bool isEncrypted() const { return flags & 0x0001; }
+};
+
+class ZipReader {
+public:
+  static const uint16_t kMethodStore = 0;
+  static const uint16_t kMethodDeflate = 8;
+
+  ZipReader(const uint8_t *data, size_t size);
+
+  std::vector<ZipEntry> readCentralDirectory() const;
+  bool locateCentralDirectory(uint64_t &offset, uint64_t &size,
+                              uint64_t &count) const;
+
+  static bool canRead(const ZipEntry &entry);
+  std::vector<uint8_t> readEntry(const ZipEntry &entry) const;
+  uint64_t payloadOffset(const ZipEntry &entry) const;
+
+private:
+  const uint8_t *data_;
+  size_t size_;
+
+  uint16_t read16(uint64_t offset) const;
+  uint32_t read32(uint64_t offset) const;
+  uint64_t read64(uint64_t offset) const;
+  void require(uint64_t offset, uint64_t length) const;
+  uint64_t findEndOfCentralDirectory() const;
+};
@@ -0,0 +1,231 @@
+#include "zip_writer.h"
+#include "zip_reader.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <zlib.h>
+
+namespace {
+const uint32_t kLocalHeaderSignature = 0x04034b50;
+const uint32_t kCentralHeaderSignature = 0x02014b50;
+const uint32_t kEndOfCentralDirectorySignature = 0x06054b50;
+const uint16_t kVersionNeeded = 20;
+const uint16_t kVersionMadeBy = (3 << 8) | 20;
+const uint16_t kUtf8Flag = 0x0800;
+const uint16_t kMethodStore = 0;
+const uint16_t kMethodDeflate = 8;
+const uint32_t kRegularFileAttributes = 0100644u << 16;
+
+std::vector<uint8_t> deflateRaw(const std::vector<uint8_t> &data, int level) {
+  z_stream stream{};
+  if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    throw std::runtime_error("Failed to initialize deflate stream");
+  }
+
+  std::vector<uint8_t> output(deflateBound(&stream, data.size()));
+  stream.next_in = const_cast<Bytef *>(data.data());
+  stream.avail_in = data.size();
+  stream.next_out = output.data();
+  stream.avail_out = output.size();
+
+  int result = deflate(&stream, Z_FINISH);
+  output.resize(stream.total_out);
+  deflateEnd(&stream);
+
+  if (result != Z_STREAM_END) {
+    throw std::runtime_error("Failed to deflate zip entry");
+  }
+  return output;
+}
+
+// Without ZIP64 records, 0xffffffff would read as "see the ZIP64 field".
+uint32_t checkedSize(size_t size) {
+  if (size >= std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("ZIP output exceeds 4 GiB");
+  }
+  return static_cast<uint32_t>(size);
+}
+} // namespace
+
+// DOS times carry no zone; UTC keeps the bytes independent of the server's.
+ZipWriter::ZipWriter(time_t mtime) {
+  struct tm utc{};
+  gmtime_r(&mtime, &utc);
+  if (utc.tm_year < 80) {
+    utc = tm{};
+    utc.tm_year = 80;
+    utc.tm_mday = 1;
+  }
+
+  dos_time_ = (utc.tm_hour << 11) | (utc.tm_min << 5) | (utc.tm_sec / 2);
+  dos_date_ = ((utc.tm_year - 80) << 9) | ((utc.tm_mon + 1) << 5) | utc.tm_mday;
+}
+
+size_t ZipWriter::resume(const uint8_t *data, size_t size) {
+  if (!entries_.empty() || !output_.empty()) {
+    throw std::runtime_error("Zip archive must be resumed before adding");
+  }
+
+  uint64_t directory_offset = 0;
+  uint64_t directory_size = 0;
+  uint64_t count = 0;
+  if (ZipReader(data, size).locateCentralDirectory(directory_offset,
+                                                   directory_size, count)) {
+    throw std::runtime_error("Cannot append to a ZIP64 archive");
+  }
+
+  output_.assign(data, data + directory_offset);
+  directory_.assign(data + directory_offset,
+                    data + directory_offset + directory_size);
+  resumed_entries_ = count;
+  return output_.size();
+}
+
+size_t ZipWriter::addEntry(const std::string &name,
+                           const std::vector<uint8_t> &data) {
+  Entry entry;
+  entry.name = name;
+  entry.size = checkedSize(data.size());
+  entry.crc = crc32(0L, data.data(), data.size());
+  entry.offset = currentOffset();
+
+  std::vector<uint8_t> compressed;
+  if (!data.empty() && level_ != 0) {
+    compressed = deflateRaw(data, level_);
+  }
+
+  bool store = compressed.empty() || compressed.size() >= data.size();
+  const std::vector<uint8_t> &payload = store ? data : compressed;
+  entry.method = store ? kMethodStore : kMethodDeflate;
+  entry.compressed_size = checkedSize(payload.size());
+
+  writeLocalHeader(entry);
+  entry.payload_offset = output_.size();
+  output_.insert(output_.end(), payload.begin(), payload.end());
+
+  entries_.push_back(std::move(entry));
+  return entries_.size() - 1;
+}
+
+void ZipWriter::addCopy(const std::string &name, size_t source) {
+  if (source >= entries_.size()) {
+    throw std::runtime_error("Invalid zip entry reference");
+  }
+
+  Entry entry = entries_[source];
+  entry.name = name;
+  entry.offset = currentOffset();
+
+  writeLocalHeader(entry);
+  entry.payload_offset = output_.size();
+  output_.resize(entry.payload_offset + entry.compressed_size);
+  std::copy_n(output_.begin() + entries_[source].payload_offset,
+              entry.compressed_size, output_.begin() + entry.payload_offset);
+
+  entries_.push_back(std::move(entry));
+}
+
+void ZipWriter::addRaw(const std::string &name, uint16_t method, uint32_t crc,
+                       uint64_t size, const uint8_t *payload,
+                       uint64_t compressed_size) {
+  if (method != kMethodStore && method != kMethodDeflate) {
+    throw std::runtime_error("Cannot copy zip entry with method " +
+                             std::to_string(method));
+  }
+
+  Entry entry;
+  entry.name = name;
+  entry.method = method;
+  entry.crc = crc;
+  entry.compressed_size = checkedSize(compressed_size);
+  entry.size = checkedSize(size);
+  entry.offset = currentOffset();
+
+  writeLocalHeader(entry);
+  entry.payload_offset = output_.size();
+  output_.insert(output_.end(), payload, payload + compressed_size);
+
+  entries_.push_back(std::move(entry));
+}
+
+std::vector<uint8_t> ZipWriter::finish() {
+  if (finished_) {
+    throw std::runtime_error("Zip archive has already been finished");
+  }
+  finished_ = true;
+
+  uint32_t directory_offset = currentOffset();
+  output_.insert(output_.end(), directory_.begin(), directory_.end());
+  for (const auto &entry : entries_) {
+    writeCentralHeader(entry);
+  }
+  uint32_t directory_size = currentOffset() - directory_offset;
+
+  size_t count = resumed_entries_ + entries_.size();
+  if (count >= std::numeric_limits<uint16_t>::max()) {
+    throw std::runtime_error("ZIP output has too many entries");
+  }
+
+  append32(kEndOfCentralDirectorySignature);
+  append16(0);
+  append16(0);
+  append16(count);
+  append16(count);
+  append32(directory_size);
+  append32(directory_offset);
+  append16(0);
+
+  return std::move(output_);
+}
+
+void ZipWriter::writeLocalHeader(const Entry &entry) {
+  append32(kLocalHeaderSignature);
+  append16(kVersionNeeded);
+  append16(kUtf8Flag);
+  append16(entry.method);
+  append16(dos_time_);
+  append16(dos_date_);
+  append32(entry.crc);
+  append32(entry.compressed_size);
+  append32(entry.size);
+  append16(entry.name.size());
+  append16(0);
+  output_.insert(output_.end(), entry.name.begin(), entry.name.end());
+}
+
+void ZipWriter::writeCentralHeader(const Entry &entry) {
+  append32(kCentralHeaderSignature);
+  append16(kVersionMadeBy);
+  append16(kVersionNeeded);
+  append16(kUtf8Flag);
+  append16(entry.method);
+  append16(dos_time_);
+  append16(dos_date_);
+  append32(entry.crc);
+  append32(entry.compressed_size);
+  append32(entry.size);
+  append16(entry.name.size());
+  append16(0);
+  append16(0);
+  append16(0);
+  append16(0);
+  append32(kRegularFileAttributes);
+  append32(entry.offset);
+  output_.insert(output_.end(), entry.name.begin(), entry.name.end());
+}
+
+void ZipWriter::append16(uint16_t value) {
+  output_.push_back(value & 0xff);
+  output_.push_back((value >> 8) & 0xff);
+}
+
+void ZipWriter::append32(uint32_t value) {
+  append16(value & 0xffff);
+  append16((value >> 16) & 0xffff);
+}
+
+uint32_t ZipWriter::currentOffset() const {
+  return checkedSize(output_.size());
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+class ZipWriter {
+public:
+  explicit ZipWriter(time_t mtime);
+
+  size_t resume(const uint8_t *data, size_t size);
+  void setLevel(int level) { level_ = level; }
+
+  size_t addEntry(const std::string &name, const std::vector<uint8_t> &data);
+  void addCopy(const std::string &name, size_t source);
+  void addRaw(const std::string &name, uint16_t method, uint32_t crc,
+              uint64_t size, const uint8_t *payload, uint64_t compressed_size);
+
+  std::vector<uint8_t> finish();
+
+  size_t getEntryCount() const { return entries_.size(); }
+
+private:
+  struct Entry {
+    std::string name;
+    uint16_t method;
+    uint32_t crc;
+    uint32_t compressed_size;
+    uint32_t size;
+    uint32_t offset;
+    size_t payload_offset;
+  };
+
+  uint16_t dos_time_;
+  uint16_t dos_date_;
+  int level_ = -1;
+  std::vector<Entry> entries_;
+  std::vector<uint8_t> output_;
+  std::vector<uint8_t> directory_;
+  size_t resumed_entries_ = 0;
+  bool finished_ = false;
+
+  void writeLocalHeader(const Entry &entry);
+  void writeCentralHeader(const Entry &entry);
+  void append16(uint16_t value);
+  void append32(uint32_t value);
+  uint32_t currentOffset() const;
+};
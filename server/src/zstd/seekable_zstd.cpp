@@ -0,0 +1,319 @@
+#include "seekable_zstd.h"
+#include "../memory/memory_budget.h"
+#include "../server/cpu_pool.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <xxhash.h>
+#include <zstd.h>
+
+namespace {
+const uint32_t kSkippableFrameMagic = 0x184D2A5E;
+const uint32_t kSeekableMagic = 0x8F92EAB1;
+const size_t kSkippableHeaderSize = 8;
+const size_t kFooterSize = 9;
+const uint8_t kChecksumFlag = 0x80;
+const uint8_t kReservedBits = 0x7c;
+
+uint32_t read32(const uint8_t *data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) |
+         (static_cast<uint32_t>(data[3]) << 24);
+}
+
+void append32(std::vector<uint8_t> &output, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    output.push_back((value >> (8 * i)) & 0xff);
+  }
+}
+
+uint32_t checksumOf(const uint8_t *data, size_t size) {
+  return static_cast<uint32_t>(XXH64(data, size, 0));
+}
+
+void appendSeekTable(std::vector<uint8_t> &output,
+                     const std::vector<SeekableZstd::Frame> &frames) {
+  append32(output, kSkippableFrameMagic);
+  append32(output, frames.size() * 12 + kFooterSize);
+  for (const auto &frame : frames) {
+    append32(output, frame.compressed_size);
+    append32(output, frame.decompressed_size);
+    append32(output, frame.checksum);
+  }
+  append32(output, frames.size());
+  output.push_back(kChecksumFlag);
+  append32(output, kSeekableMagic);
+}
+} // namespace
+
+std::vector<uint8_t> SeekableZstd::compress(const std::vector<uint8_t> &input,
+                                            size_t frame_size, int level,
+                                            size_t threads) {
+  if (frame_size < kMinFrameSize || frame_size > kMaxFrameSize) {
+    throw std::runtime_error("Invalid zstd frame size: " +
+                             std::to_string(frame_size));
+  }
+
+  size_t count = (input.size() + frame_size - 1) / frame_size;
+  std::vector<std::vector<uint8_t>> frames(count);
+  std::vector<uint32_t> checksums(count);
+
+  CpuPool::instance().parallelFor(count, threads, [&](size_t i) {
+    const uint8_t *source = input.data() + i * frame_size;
+    size_t length = std::min(frame_size, input.size() - i * frame_size);
+
+    std::vector<uint8_t> frame(ZSTD_compressBound(length));
+    size_t written =
+        ZSTD_compress(frame.data(), frame.size(), source, length, level);
+    if (ZSTD_isError(written)) {
+      throw std::runtime_error(std::string("zstd compression failed: ") +
+                               ZSTD_getErrorName(written));
+    }
+    frame.resize(written);
+
+    frames[i] = std::move(frame);
+    checksums[i] = checksumOf(source, length);
+  });
+
+  size_t total = kSkippableHeaderSize + count * 12 + kFooterSize;
+  for (const auto &frame : frames) {
+    total += frame.size();
+  }
+
+  std::vector<uint8_t> output;
+  output.reserve(total);
+  std::vector<SeekableZstd::Frame> table(count);
+  for (size_t i = 0; i < count; ++i) {
+    output.insert(output.end(), frames[i].begin(), frames[i].end());
+    table[i].compressed_size = frames[i].size();
+    table[i].decompressed_size =
+        std::min(frame_size, input.size() - i * frame_size);
+    table[i].checksum = checksums[i];
+  }
+  appendSeekTable(output, table);
+
+  return output;
+}
+
+SeekableZstd::Writer::Writer(size_t frame_size, int level, size_t threads)
+    : context_(ZSTD_createCCtx()), checksum_(XXH64_createState()),
+      frame_size_(frame_size), chunk_(ZSTD_CStreamOutSize()) {
+  if (!context_ || !checksum_) {
+    ZSTD_freeCCtx(context_);
+    XXH64_freeState(checksum_);
+    throw std::runtime_error("Failed to create zstd stream");
+  }
+  if (frame_size < kMinFrameSize || frame_size > kMaxFrameSize) {
+    ZSTD_freeCCtx(context_);
+    XXH64_freeState(checksum_);
+    throw std::runtime_error("Invalid zstd frame size: " +
+                             std::to_string(frame_size));
+  }
+  ZSTD_CCtx_setParameter(context_, ZSTD_c_compressionLevel, level);
+  // Ignored by a zstd built without threads, which then compresses inline.
+  if (threads > 1) {
+    ZSTD_CCtx_setParameter(context_, ZSTD_c_nbWorkers,
+                           static_cast<int>(threads));
+  }
+  XXH64_reset(checksum_, 0);
+}
+
+SeekableZstd::Writer::~Writer() {
+  ZSTD_freeCCtx(context_);
+  XXH64_freeState(checksum_);
+}
+
+void SeekableZstd::Writer::write(const uint8_t *data, size_t size) {
+  while (size > 0) {
+    size_t length = std::min(size, frame_size_ - frame_input_);
+    XXH64_update(checksum_, data, length);
+    frame_input_ += length;
+    encode(data, length, frame_input_ == frame_size_);
+    if (frame_input_ == frame_size_) {
+      endFrame();
+    }
+    data += length;
+    size -= length;
+  }
+}
+
+std::vector<uint8_t> SeekableZstd::Writer::finish() {
+  if (frame_input_ > 0) {
+    encode(nullptr, 0, true);
+    endFrame();
+  }
+  appendSeekTable(output_, frames_);
+  return std::move(output_);
+}
+
+void SeekableZstd::Writer::encode(const uint8_t *data, size_t size,
+                                  bool end_frame) {
+  ZSTD_inBuffer input{data, size, 0};
+  ZSTD_EndDirective mode = end_frame ? ZSTD_e_end : ZSTD_e_continue;
+  size_t remaining;
+  do {
+    ZSTD_outBuffer output{chunk_.data(), chunk_.size(), 0};
+    remaining = ZSTD_compressStream2(context_, &output, &input, mode);
+    if (ZSTD_isError(remaining)) {
+      throw std::runtime_error(std::string("zstd compression failed: ") +
+                               ZSTD_getErrorName(remaining));
+    }
+    output_.insert(output_.end(), chunk_.begin(), chunk_.begin() + output.pos);
+  } while (end_frame ? remaining != 0 : input.pos < input.size);
+}
+
+void SeekableZstd::Writer::endFrame() {
+  Frame frame;
+  frame.compressed_size = output_.size() - frame_start_;
+  frame.decompressed_size = frame_input_;
+  frame.checksum = static_cast<uint32_t>(XXH64_digest(checksum_));
+  frames_.push_back(frame);
+
+  XXH64_reset(checksum_, 0);
+  frame_start_ = output_.size();
+  frame_input_ = 0;
+}
+
+bool SeekableZstd::hasSeekTable(const uint8_t *data, size_t size) {
+  return size >= kSkippableHeaderSize + kFooterSize &&
+         read32(data + size - 4) == kSeekableMagic;
+}
+
+SeekableZstd::SeekableZstd(const uint8_t *data, size_t size)
+    : data_(data), size_(size) {
+  if (!hasSeekTable(data, size)) {
+    throw std::runtime_error("zstd stream has no seek table");
+  }
+
+  uint64_t count = read32(data + size - kFooterSize);
+  uint8_t descriptor = data[size - 5];
+  if (descriptor & kReservedBits) {
+    throw std::runtime_error("Unsupported zstd seek table descriptor");
+  }
+  checksums_ = descriptor & kChecksumFlag;
+
+  uint64_t entry_size = checksums_ ? 12 : 8;
+  uint64_t table_size = count * entry_size + kFooterSize;
+  if (table_size + kSkippableHeaderSize > size) {
+    throw std::runtime_error("Truncated zstd seek table");
+  }
+
+  uint64_t table = size - table_size;
+  if (read32(data + table - 8) != kSkippableFrameMagic ||
+      read32(data + table - 4) != table_size) {
+    throw std::runtime_error("Corrupt zstd seek table");
+  }
+
+  frames_.resize(count);
+  uint64_t compressed = 0;
+  uint64_t decompressed = 0;
+  for (uint64_t i = 0; i < count; ++i) {
+    const uint8_t *entry = data + table + i * entry_size;
+    Frame &frame = frames_[i];
+    frame.compressed_offset = compressed;
+    frame.compressed_size = read32(entry);
+    frame.decompressed_offset = decompressed;
+    frame.decompressed_size = read32(entry + 4);
+    frame.checksum = checksums_ ? read32(entry + 8) : 0;
+    // Decode buffers are sized from the table, so it must not ask for more
+    // than a frame this writer would produce.
+    if (frame.decompressed_size > kMaxFrameSize) {
+      throw std::runtime_error("zstd seek table frame exceeds " +
+                               std::to_string(kMaxFrameSize) + " bytes");
+    }
+
+    compressed += frame.compressed_size;
+    decompressed += frame.decompressed_size;
+  }
+
+  if (compressed != table - kSkippableHeaderSize) {
+    throw std::runtime_error("zstd seek table does not match the stream");
+  }
+}
+
+std::vector<uint8_t> SeekableZstd::read(uint64_t offset, size_t length,
+                                        MemoryAccount *memory) const {
+  uint64_t total = getDecompressedSize();
+  if (offset > total || length > total - offset) {
+    throw std::runtime_error("Read beyond the end of the zstd stream");
+  }
+
+  std::vector<uint8_t> output(length);
+  if (length == 0) {
+    return output;
+  }
+
+  auto first = std::upper_bound(frames_.begin(), frames_.end(), offset,
+                                [](uint64_t value, const Frame &frame) {
+                                  return value < frame.decompressed_offset;
+                                }) -
+               1;
+  auto last = std::upper_bound(first, frames_.end(), offset + length - 1,
+                               [](uint64_t value, const Frame &frame) {
+                                 return value < frame.decompressed_offset;
+                               }) -
+              1;
+
+  // Frames inside the range decode straight into the output; only the ones
+  // cut by its ends need a scratch buffer, which is reserved first.
+  auto partial = [offset, length](const Frame &frame) {
+    return frame.decompressed_offset < offset ||
+           frame.decompressed_offset + frame.decompressed_size >
+               offset + length;
+  };
+  size_t scratch = 0;
+  for (auto it : {first, last}) {
+    if (partial(*it)) {
+      scratch = std::max<size_t>(scratch, it->decompressed_size);
+    }
+  }
+  if (memory && scratch > 0) {
+    memory->reserve(scratch);
+  }
+
+  std::vector<uint8_t> buffer;
+  for (auto it = first; it <= last; ++it) {
+    uint64_t begin = std::max(offset, it->decompressed_offset);
+    uint64_t end = std::min(offset + length,
+                            it->decompressed_offset + it->decompressed_size);
+    if (!partial(*it)) {
+      decodeFrame(*it, output.data() + (begin - offset));
+      continue;
+    }
+    buffer.resize(it->decompressed_size);
+    decodeFrame(*it, buffer.data());
+    std::copy(buffer.begin() + (begin - it->decompressed_offset),
+              buffer.begin() + (end - it->decompressed_offset),
+              output.begin() + (begin - offset));
+  }
+
+  return output;
+}
+
+std::vector<uint8_t> SeekableZstd::decompress() const {
+  std::vector<uint8_t> output(getDecompressedSize());
+  CpuPool::instance().parallelFor(frames_.size(), 0, [&](size_t i) {
+    decodeFrame(frames_[i], output.data() + frames_[i].decompressed_offset);
+  });
+  return output;
+}
+
+uint64_t SeekableZstd::getDecompressedSize() const {
+  if (frames_.empty()) {
+    return 0;
+  }
+  return frames_.back().decompressed_offset + frames_.back().decompressed_size;
+}
+
+void SeekableZstd::decodeFrame(const Frame &frame, uint8_t *output) const {
+  size_t decoded =
+      ZSTD_decompress(output, frame.decompressed_size,
+                      data_ + frame.compressed_offset, frame.compressed_size);
+  if (ZSTD_isError(decoded) || decoded != frame.decompressed_size) {
+    throw std::runtime_error("Corrupt zstd frame at offset " +
+                             std::to_string(frame.compressed_offset));
+  }
+  if (checksums_ && checksumOf(output, decoded) != frame.checksum) {
+    throw std::runtime_error("zstd frame checksum mismatch at offset " +
+                             std::to_string(frame.compressed_offset));
+  }
+}
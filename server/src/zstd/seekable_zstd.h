@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class MemoryAccount;
+struct ZSTD_CCtx_s;
+struct XXH64_state_s;
+
+class SeekableZstd {
+public:
+  static const size_t kDefaultFrameSize = 1024 * 1024;
+  static const size_t kMinFrameSize = 4096;
+  static const size_t kMaxFrameSize = 64 * 1024 * 1024;
+  static const int kDefaultLevel = 3;
+
+  struct Frame {
+    uint64_t compressed_offset = 0;
+    uint32_t compressed_size = 0;
+    uint64_t decompressed_offset = 0;
+    uint32_t decompressed_size = 0;
+    uint32_t checksum = 0;
+  };
+
+  static std::vector<uint8_t> compress(const std::vector<uint8_t> &input,
+                                       size_t frame_size,
+                                       int level = kDefaultLevel,
+                                       size_t threads = 0);
+  static bool hasSeekTable(const uint8_t *data, size_t size);
+
+  // Builds the same stream as compress() from input written in pieces, so
+  // the input never has to be held whole.
+  class Writer {
+  public:
+    explicit Writer(size_t frame_size, int level = kDefaultLevel,
+                    size_t threads = 0);
+    ~Writer();
+
+    Writer(const Writer &) = delete;
+    Writer &operator=(const Writer &) = delete;
+
+    void write(const uint8_t *data, size_t size);
+    std::vector<uint8_t> finish();
+
+    size_t getOutputSize() const { return output_.size(); }
+
+  private:
+    ZSTD_CCtx_s *context_;
+    XXH64_state_s *checksum_;
+    size_t frame_size_;
+    size_t frame_input_ = 0;
+    size_t frame_start_ = 0;
+    std::vector<uint8_t> chunk_;
+    std::vector<Frame> frames_;
+    std::vector<uint8_t> output_;
+
+    void encode(const uint8_t *data, size_t size, bool end_frame);
+    void endFrame();
+  };
+
+  SeekableZstd(const uint8_t *data, size_t size);
+
+  // Reserves any scratch space for partly read frames from memory first.
+  std::vector<uint8_t> read(uint64_t offset, size_t length,
+                            MemoryAccount *memory = nullptr) const;
+  std::vector<uint8_t> decompress() const;
+
+  const std::vector<Frame> &getFrames() const { return frames_; }
+  uint64_t getDecompressedSize() const;
+  size_t getMemoryUsage() const { return frames_.size() * sizeof(Frame); }
+
+private:
+  const uint8_t *data_;
+  size_t size_;
+  bool checksums_ = false;
+  std::vector<Frame> frames_;
+
+  void decodeFrame(const Frame &frame, uint8_t *output) const;
+};
@@ -0,0 +1,221 @@
+#include <gtest/gtest.h>
+#include "../src/server/request/request_handler.h"
+#include "../src/server/session.h"
+#include <atomic>
+#include <boost/version.hpp>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <new>
+#include <sys/resource.h>
+#include <thread>
+
+// Replaces the global allocator for this executable only, so counting stays
+// out of the main test binary.
+namespace {
+std::atomic<size_t> counted_allocations{0};
+thread_local bool count_allocations = false;
+}
+
+void *operator new(std::size_t size) {
+    if (count_allocations) {
+        ++counted_allocations;
+    }
+    if (void *pointer = std::malloc(size ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept { std::free(pointer); }
+
+namespace {
+// The connection handling Session replaced: every request allocates its
+// buffer, parser and response, and each step binds a new callback.
+class CallbackConnection {
+public:
+    using Handler = std::function<http::response<http::string_body>(
+        const http::request<http::string_body>&)>;
+
+    static void start(std::shared_ptr<ip::tcp::socket> sock, Handler handler) {
+        read(std::move(sock), std::make_shared<Handler>(std::move(handler)));
+    }
+
+private:
+    static void read(std::shared_ptr<ip::tcp::socket> sock, std::shared_ptr<Handler> handler) {
+        auto buf = std::make_shared<boost::beast::flat_buffer>();
+        auto parser = std::make_shared<http::request_parser<http::string_body>>();
+        http::async_read(*sock, *buf, *parser,
+                         [sock, buf, parser, handler](boost::beast::error_code ec, std::size_t) {
+                             if (!ec) {
+                                 onRead(sock, handler, parser->release());
+                             }
+                         });
+    }
+
+    static void onRead(std::shared_ptr<ip::tcp::socket> sock, std::shared_ptr<Handler> handler,
+                       http::request<http::string_body> req) {
+        auto resp = std::make_shared<http::response<http::string_body>>((*handler)(req));
+        http::async_write(*sock, *resp,
+                          std::bind(&CallbackConnection::onWrite, sock, handler, resp,
+                                    std::placeholders::_1));
+    }
+
+    static void onWrite(std::shared_ptr<ip::tcp::socket> sock, std::shared_ptr<Handler> handler,
+                        std::shared_ptr<http::response<http::string_body>>,
+                        boost::beast::error_code ec) {
+        if (!ec) {
+            read(std::move(sock), std::move(handler));
+        }
+    }
+};
+}
+
+class AllocationTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        acceptor = std::make_unique<ip::tcp::acceptor>(
+            service, ip::tcp::endpoint(ip::address_v4::loopback(), 0));
+        server_thread = std::thread([this]() {
+            auto work = boost::asio::make_work_guard(service);
+            service.run();
+        });
+    }
+
+    void TearDown() override {
+        service.stop();
+        server_thread.join();
+    }
+
+    void startSession(Session::Handler handler = nullptr) {
+        acceptor->async_accept([this, handler](boost::system::error_code ec, ip::tcp::socket socket) {
+            ASSERT_FALSE(ec);
+            session = handler ? std::make_shared<Session>(std::move(socket), handler)
+                              : std::make_shared<Session>(std::move(socket));
+            session->start();
+        });
+    }
+
+    void startCallbackConnection(CallbackConnection::Handler handler) {
+        auto sock = std::make_shared<ip::tcp::socket>(service);
+        acceptor->async_accept(*sock, [sock, handler](boost::system::error_code ec) {
+            ASSERT_FALSE(ec);
+            CallbackConnection::start(sock, handler);
+        });
+    }
+
+    void runOnServer(std::function<void()> task) {
+        std::promise<void> done;
+        boost::asio::post(service, [&task, &done]() {
+            task();
+            done.set_value();
+        });
+        done.get_future().wait();
+    }
+
+    http::response<http::string_body> roundTrip(ip::tcp::socket& client, const std::string& target) {
+        http::request<http::string_body> req{http::verb::get, target, 11};
+        http::write(client, req);
+        boost::beast::flat_buffer buffer;
+        http::response<http::string_body> resp;
+        http::read(client, buffer, resp);
+        return resp;
+    }
+
+    struct Usage {
+        size_t allocations = 0;
+        long context_switches = 0;
+    };
+
+    static long contextSwitches() {
+        rusage usage{};
+        getrusage(RUSAGE_THREAD, &usage);
+        return usage.ru_nvcsw + usage.ru_nivcsw;
+    }
+
+    // Heap allocations and context switches of the server thread for
+    // `requests` keep-alive round trips, after a few warm-up requests.
+    Usage usageFor(const std::string& target, const std::string& expected, int requests) {
+        ip::tcp::socket client(service);
+        client.connect(acceptor->local_endpoint());
+
+        for (int i = 0; i < 10; ++i) {
+            EXPECT_EQ(roundTrip(client, target).body(), expected);
+        }
+
+        long switches_before = 0;
+        runOnServer([&switches_before]() {
+            counted_allocations = 0;
+            count_allocations = true;
+            switches_before = contextSwitches();
+        });
+        for (int i = 0; i < requests; ++i) {
+            auto resp = roundTrip(client, target);
+            EXPECT_EQ(resp.result(), http::status::ok);
+            EXPECT_EQ(resp.body(), expected);
+        }
+        Usage usage;
+        runOnServer([&usage, switches_before]() {
+            count_allocations = false;
+            usage.context_switches = contextSwitches() - switches_before;
+        });
+        usage.allocations = counted_allocations.load();
+        return usage;
+    }
+
+    boost::asio::io_context service;
+    std::unique_ptr<ip::tcp::acceptor> acceptor;
+    std::shared_ptr<Session> session;
+    std::thread server_thread;
+};
+
+TEST_F(AllocationTest, SessionAllocatesLessThanCallbacks) {
+
+    startCallbackConnection([](const http::request<http::string_body>&) {
+        http::response<http::string_body> resp{http::status::ok, 11};
+        resp.body() = "pong";
+        resp.prepare_payload();
+        return resp;
+    });
+    Usage callbacks = usageFor("/ping", "pong", 100);
+
+    startSession([](const Session::Request&, MemoryAccount&,
+                    Session::Response& resp) -> boost::asio::awaitable<void> {
+        if (resp.body().empty()) {
+            resp.result(http::status::ok);
+            resp.body() = "pong";
+            resp.prepare_payload();
+        }
+        co_return;
+    });
+    Usage sessions = usageFor("/ping", "pong", 100);
+
+    RecordProperty("callback_allocations", std::to_string(callbacks.allocations));
+    RecordProperty("session_allocations", std::to_string(sessions.allocations));
+    RecordProperty("callback_context_switches", std::to_string(callbacks.context_switches));
+    RecordProperty("session_context_switches", std::to_string(sessions.context_switches));
+
+    EXPECT_GE(callbacks.allocations, 100u * 5);
+#if BOOST_VERSION >= 107900
+    // Older Asio recycles a single coroutine frame per thread, so nested
+    // awaitables still reach the heap there.
+    EXPECT_EQ(sessions.allocations, 0u);
+#endif
+    // Both wait for the socket once per round trip; the coroutines must not
+    // add a hop of their own. A few switches either way are scheduler noise.
+    EXPECT_LE(sessions.context_switches, callbacks.context_switches + 5);
+    EXPECT_EQ(session->getResponseMemory().getFallbackCount(), 0u);
+}
+
+TEST_F(AllocationTest, SteadyStateMakesNoHeapAllocations) {
+    auto formats = formats_json();
+    const std::string expected(formats->begin(), formats->end());
+
+#if BOOST_VERSION < 107900
+    GTEST_SKIP() << "needs BOOST_ASIO_RECYCLING_ALLOCATOR_CACHE_SIZE (Boost 1.79+)";
+#endif
+    startSession();
+    EXPECT_EQ(usageFor("/formats", expected, 100).allocations, 0u);
+    EXPECT_EQ(session->getResponseMemory().getFallbackCount(), 0u);
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include "../src/append/appender.h"
+#include "../src/factory/factory.h"
+#include "../src/memory/memory_budget.h"
+#include "../src/server/request/request_handler.h"
+#include "../src/store/archive_store.h"
+#include <random>
+
+class AppenderTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::mt19937 gen(7);
+        std::uniform_int_distribution<> dis('a', 'h');
+        for (int i = 0; i < 4; ++i) {
+            std::vector<uint8_t> data(1024 * 1024);
+            for (auto& byte : data) {
+                byte = dis(gen);
+            }
+            original.emplace_back("part" + std::to_string(i) + ".txt", data);
+        }
+        added = {
+            {"new/one.txt", std::vector<uint8_t>(5000, 'x')},
+            {"new/empty.txt", std::vector<uint8_t>{}},
+        };
+    }
+
+    std::shared_ptr<const std::vector<uint8_t>> compress(CompressionFormat format,
+                                                         const std::vector<FileEntry>& files) {
+        auto compressor = CompressorFactory::createCompressor(format);
+        return std::make_shared<const std::vector<uint8_t>>(compressor->compress(files));
+    }
+
+    void expectContents(CompressionFormat format, const std::vector<uint8_t>& data,
+                        const std::vector<FileEntry>& files) {
+        auto extracted = CompressorFactory::createCompressor(format)->extract(data);
+        ASSERT_EQ(extracted.size(), files.size());
+        for (size_t i = 0; i < files.size(); ++i) {
+            EXPECT_EQ(extracted[i].name, files[i].name);
+            EXPECT_EQ(extracted[i].data, files[i].data) << files[i].name;
+        }
+    }
+
+    std::vector<FileEntry> original;
+    std::vector<FileEntry> added;
+};
+
+TEST_F(AppenderTest, AppendsZipEntriesAfterExistingData) {
+    auto source = compress(CompressionFormat::ZIP, original);
+    StoredArchive archive("zip", source);
+
+    Appender appender(archive, 0);
+    auto output = appender.append(added);
+    EXPECT_EQ(appender.getStats().entries, 2);
+    EXPECT_GT(appender.getStats().kept_bytes, 4 * 1024 * 1024 / 8);
+    EXPECT_TRUE(std::equal(source->begin(), source->begin() + appender.getStats().kept_bytes,
+                           output.begin()));
+
+    std::vector<FileEntry> expected = original;
+    expected.insert(expected.end(), added.begin(), added.end());
+    expectContents(CompressionFormat::ZIP, output, expected);
+
+    StoredArchive appended("appended", std::make_shared<const std::vector<uint8_t>>(output));
+    EXPECT_EQ(appended.readEntry(*appended.find("new/one.txt")), added[0].data);
+    EXPECT_THROW(Appender(appended, 0).append(added), std::runtime_error);
+}
+
+TEST_F(AppenderTest, ContinuesLastGzipMemberAtAccessPoint) {
+    auto source = compress(CompressionFormat::TAR_GZ, original);
+    StoredArchive archive("tgz", source, 256 * 1024);
+
+    Appender appender(archive, 0);
+    auto output = appender.append(added);
+    EXPECT_GT(appender.getStats().kept_bytes, source->size() / 2);
+    EXPECT_LT(appender.getStats().recompressed_bytes, 512 * 1024);
+
+    std::vector<FileEntry> expected = original;
+    expected.insert(expected.end(), added.begin(), added.end());
+    expectContents(CompressionFormat::TAR_GZ, output, expected);
+
+    StoredArchive appended("appended", std::make_shared<const std::vector<uint8_t>>(output), 256 * 1024);
+    ASSERT_EQ(appended.getEntries().size(), expected.size());
+    EXPECT_EQ(appended.readEntry(*appended.find("part3.txt")), original[3].data);
+
+    std::vector<FileEntry> more = {{"later.txt", std::vector<uint8_t>{'z'}}};
+    Appender again(appended, 0);
+    auto twice = again.append(more);
+    EXPECT_EQ(again.getStats().recompressed_bytes, 0);
+    EXPECT_GT(again.getStats().kept_bytes, output.size() - 128);
+
+    expected.push_back(more[0]);
+    expectContents(CompressionFormat::TAR_GZ, twice, expected);
+}
+
+TEST_F(AppenderTest, RewritesSmallTarGzMember) {
+    std::vector<FileEntry> small = {{"a.txt", std::vector<uint8_t>(100, 'a')}};
+    StoredArchive archive("small", compress(CompressionFormat::TAR_GZ, small));
+
+    Appender appender(archive, 0);
+    auto output = appender.append(added);
+    EXPECT_EQ(appender.getStats().kept_bytes, 0);
+
+    small.insert(small.end(), added.begin(), added.end());
+    expectContents(CompressionFormat::TAR_GZ, output, small);
+}
+
+TEST_F(AppenderTest, RejectsUnsupportedFormats) {
+    StoredArchive archive("bz2", compress(CompressionFormat::TAR_BZ2, added));
+    EXPECT_FALSE(Appender::supportsFormat(CompressionFormat::TAR_BZ2));
+    EXPECT_THROW(Appender(archive, 0), std::runtime_error);
+}
+
+TEST_F(AppenderTest, AppendRouteRequiresMultipart) {
+    auto archive = ArchiveStore::instance().put(compress(CompressionFormat::ZIP, added));
+    MemoryAccount account;
+
+    HttpRequest req{http::verb::post, "/archives/" + archive->getId() + "/entries", 11};
+    req.set(http::field::content_type, "text/plain");
+    req.body() = "new/two.txt";
+    req.prepare_payload();
+
+    EXPECT_EQ(handle_request(req, account).result(), http::status::bad_request);
+}
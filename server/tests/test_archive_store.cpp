@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include "../src/factory/factory.h"
+#include "../src/memory/memory_budget.h"
+#include "../src/server/request/request_handler.h"
+#include "../src/store/archive_store.h"
+#include "../src/zip/zip_writer.h"
+
+class ArchiveStoreTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        files = {
+            {"readme.txt", std::vector<uint8_t>{'h', 'e', 'l', 'l', 'o'}},
+            {"data/numbers.bin", std::vector<uint8_t>(4096, 42)},
+            {"data/empty.txt", std::vector<uint8_t>{}},
+        };
+    }
+
+    SharedBuffer compress(CompressionFormat format) {
+        auto compressor = CompressorFactory::createCompressor(format);
+        return std::make_shared<const std::vector<uint8_t>>(compressor->compress(files));
+    }
+
+    std::vector<FileEntry> files;
+};
+
+TEST_F(ArchiveStoreTest, IndexesZipFromCentralDirectory) {
+    ArchiveStore store(ArchiveStore::Config{});
+    auto archive = store.put(compress(CompressionFormat::ZIP));
+
+    ASSERT_EQ(archive->getEntries().size(), files.size());
+    const ArchiveEntryInfo *entry = archive->find("data/numbers.bin");
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->size, 4096);
+    EXPECT_EQ(entry->method, "deflate");
+    EXPECT_LT(entry->compressed_size, entry->size);
+
+    for (const auto &file : files) {
+        const ArchiveEntryInfo *found = archive->find(file.name);
+        ASSERT_NE(found, nullptr) << file.name;
+        EXPECT_EQ(archive->readEntry(*found), file.data) << file.name;
+    }
+    EXPECT_EQ(archive->find("missing.txt"), nullptr);
+}
+
+TEST_F(ArchiveStoreTest, IndexesCompressedTar) {
+    ArchiveStore store(ArchiveStore::Config{});
+    auto archive = store.put(compress(CompressionFormat::TAR_GZ));
+
+    EXPECT_EQ(archive->getFormat(), CompressionFormat::TAR_GZ);
+    ASSERT_EQ(archive->getEntries().size(), files.size());
+    EXPECT_EQ(archive->getEntries()[0].method, "gzip");
+
+    const ArchiveEntryInfo *entry = archive->find("data/numbers.bin");
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(archive->readEntry(*entry), files[1].data);
+}
+
+TEST_F(ArchiveStoreTest, ReadsCopiedZipEntries) {
+    ZipWriter writer(0);
+    writer.addEntry("a.bin", files[1].data);
+    writer.addCopy("b.bin", 0);
+    ArchiveStore store(ArchiveStore::Config{});
+    auto archive = store.put(std::make_shared<const std::vector<uint8_t>>(writer.finish()));
+
+    ASSERT_NE(archive->find("b.bin"), nullptr);
+    EXPECT_EQ(archive->readEntry(*archive->find("b.bin")), files[1].data);
+}
+
+TEST_F(ArchiveStoreTest, ZipTimesAreUtc) {
+    std::string zone = getenv("TZ") ? getenv("TZ") : "";
+    setenv("TZ", "JST-9", 1);
+    tzset();
+    // 1980-01-01 13:01:02 UTC, already the next day in Tokyo.
+    ZipWriter writer(315532800 + 13 * 3600 + 62);
+    writer.addEntry("a.txt", files[0].data);
+    auto zip = writer.finish();
+    if (zone.empty()) {
+        unsetenv("TZ");
+    } else {
+        setenv("TZ", zone.c_str(), 1);
+    }
+    tzset();
+
+    EXPECT_EQ(zip[10] | (zip[11] << 8), (13 << 11) | (1 << 5) | 1);
+    EXPECT_EQ(zip[12] | (zip[13] << 8), (0 << 9) | (1 << 5) | 1);
+}
+
+TEST_F(ArchiveStoreTest, DeduplicatesAndEvicts) {
+    auto zip = compress(CompressionFormat::ZIP);
+    auto tar = compress(CompressionFormat::TAR_GZ);
+    ArchiveStore store(ArchiveStore::Config{zip->size() + tar->size() - 1});
+
+    auto first = store.put(zip);
+    EXPECT_EQ(store.put(zip), first);
+    EXPECT_EQ(store.getCount(), 1);
+
+    store.put(tar);
+    EXPECT_EQ(store.getCount(), 1);
+    EXPECT_EQ(store.get(first->getId()), nullptr);
+    EXPECT_EQ(store.getEvictionCount(), 1);
+
+    EXPECT_FALSE(store.remove(first->getId()));
+}
+
+TEST_F(ArchiveStoreTest, RejectsArchiveWhoseIndexExceedsLimit) {
+    auto tar = compress(CompressionFormat::TAR_GZ);
+    ArchiveStore store(ArchiveStore::Config{tar->size(), 1024});
+
+    EXPECT_THROW(store.put(tar), RequestTooLarge);
+    EXPECT_EQ(store.getCount(), 0);
+    EXPECT_EQ(store.getBytes(), 0);
+}
+
+TEST_F(ArchiveStoreTest, ListsEntriesInPages) {
+    ArchiveStore store(ArchiveStore::Config{});
+    auto archive = store.put(compress(CompressionFormat::ZIP));
+
+    std::string page = archive_entries_json(*archive, 1, 1);
+    EXPECT_NE(page.find("\"total\": 3"), std::string::npos);
+    EXPECT_NE(page.find("\"next_offset\": 2"), std::string::npos);
+    EXPECT_NE(page.find("data/numbers.bin"), std::string::npos);
+    EXPECT_EQ(page.find("readme.txt"), std::string::npos);
+
+    ArchiveRoute route;
+    ASSERT_TRUE(parse_archive_route("/archives/abc/entries/dir%2Fa%20b.txt", route));
+    EXPECT_EQ(route.id, "abc");
+    EXPECT_EQ(route.entry, "dir/a b.txt");
+    EXPECT_FALSE(parse_archive_route("/archives/abc/other", route));
+    EXPECT_EQ(query_parameter("/x?offset=5&limit=10", "limit"), "10");
+    EXPECT_EQ(json_escape("a\"b\\c\n"), "a\\\"b\\\\c\\u000a");
+}
+
+TEST_F(ArchiveStoreTest, MalformedPageParametersAreBadRequests) {
+    auto archive = ArchiveStore::instance().put(compress(CompressionFormat::ZIP));
+    MemoryAccount account;
+
+    auto list = [&](const std::string& query) {
+        HttpRequest req{http::verb::get, "/archives/" + archive->getId() + "/entries" + query, 11};
+        return handle_request(req, account).result();
+    };
+    EXPECT_EQ(list("?limit=2&offset=1"), http::status::ok);
+    EXPECT_EQ(list("?limit=abc"), http::status::bad_request);
+    EXPECT_EQ(list("?limit=5x"), http::status::bad_request);
+    EXPECT_EQ(list("?offset=-1"), http::status::bad_request);
+    EXPECT_EQ(list("?limit=99999999999999999999999"), http::status::bad_request);
+    EXPECT_EQ(list("?limit=0"), http::status::bad_request);
+}
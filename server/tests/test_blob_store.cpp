@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include "../src/blob/blob_store.h"
+#include "../src/digest/digest.h"
+#include "../src/server/request/request_params.h"
+#include <filesystem>
+
+class BlobStoreTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        directory = std::filesystem::temp_directory_path() / "archiver_blob_test";
+        std::filesystem::remove_all(directory);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(directory);
+    }
+
+    BlobStore::Config makeConfig(size_t limit) {
+        BlobStore::Config config;
+        config.directory = directory.string();
+        config.limit = limit;
+        return config;
+    }
+
+    std::filesystem::path directory;
+};
+
+TEST_F(BlobStoreTest, KeysBlobsBySha256) {
+    std::string digest = ContentHasher::sha256(std::vector<uint8_t>{'a', 'b', 'c'});
+    EXPECT_EQ(digest, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    EXPECT_TRUE(BlobStore::isValidDigest(digest));
+    EXPECT_FALSE(BlobStore::isValidDigest(ContentHasher::digest(std::vector<uint8_t>{'a'})));
+}
+
+TEST_F(BlobStoreTest, StoresAndReportsMissingBlobs) {
+    BlobStore store(makeConfig(1024));
+    std::vector<uint8_t> data = {'b', 'l', 'o', 'b'};
+    std::string digest = ContentHasher::sha256(data);
+    std::string unknown = ContentHasher::sha256(std::vector<uint8_t>{'x'});
+
+    store.put(digest, data);
+
+    EXPECT_TRUE(store.contains(digest));
+    EXPECT_EQ(store.missing({digest, unknown}), std::vector<std::string>{unknown});
+    EXPECT_EQ(store.get(digest), data);
+    EXPECT_THROW(store.get(unknown), BlobNotFound);
+}
+
+TEST_F(BlobStoreTest, ReloadsExistingBlobs) {
+    std::vector<uint8_t> data(100, 7);
+    std::string digest = ContentHasher::sha256(data);
+    {
+        BlobStore store(makeConfig(1024));
+        store.put(digest, data);
+    }
+
+    BlobStore reopened(makeConfig(1024));
+    EXPECT_TRUE(reopened.contains(digest));
+    EXPECT_EQ(reopened.getBytes(), 100);
+}
+
+TEST_F(BlobStoreTest, EvictsLeastRecentlyUsed) {
+    BlobStore store(makeConfig(200));
+    std::vector<uint8_t> first(100, 1), second(100, 2), third(100, 3);
+
+    store.put(ContentHasher::sha256(first), first);
+    store.put(ContentHasher::sha256(second), second);
+    store.get(ContentHasher::sha256(first));
+    store.put(ContentHasher::sha256(third), third);
+
+    EXPECT_TRUE(store.contains(ContentHasher::sha256(first)));
+    EXPECT_FALSE(store.contains(ContentHasher::sha256(second)));
+    EXPECT_LE(store.getBytes(), 200);
+}
+
+TEST_F(BlobStoreTest, RejectsInvalidDigest) {
+    BlobStore store(makeConfig(1024));
+    EXPECT_THROW(store.put("../etc/passwd", {'x'}), std::runtime_error);
+    EXPECT_FALSE(BlobStore::isValidDigest("0123456789ABCDEF0123456789abcdef"));
+}
+
+TEST_F(BlobStoreTest, ParsesManifest) {
+    std::string digest = ContentHasher::sha256(std::vector<uint8_t>{'a'});
+    auto manifest = parse_blob_manifest(digest + " 1 dir/file name.txt\r\n\n");
+
+    ASSERT_EQ(manifest.size(), 1);
+    EXPECT_EQ(manifest[0].digest, digest);
+    EXPECT_EQ(manifest[0].size, 1);
+    EXPECT_EQ(manifest[0].name, "dir/file name.txt");
+
+    EXPECT_THROW(parse_blob_manifest("not-a-digest 1 a.txt"), std::runtime_error);
+}
+
+TEST_F(BlobStoreTest, ResolvesReferencesInCompressRequest) {
+    std::vector<uint8_t> data = {'s', 't', 'o', 'r', 'e', 'd'};
+    std::string digest = ContentHasher::sha256(data);
+    BlobStore::instance().put(digest, data);
+
+    std::string boundary = "----BlobBoundary";
+    std::string body;
+    body += "--" + boundary + "\r\nContent-Disposition: form-data; name=\"operation\"\r\n\r\ncompress\r\n";
+    body += "--" + boundary + "\r\nContent-Disposition: form-data; name=\"format\"\r\n\r\nzip\r\n";
+    body += "--" + boundary + "\r\nContent-Disposition: form-data; name=\"file\"; filename=\"ref.txt\"\r\n";
+    body += std::string("Content-Type: ") + BlobStore::kReferenceContentType + "\r\n\r\n" + digest + "\r\n";
+    body += "--" + boundary + "--\r\n";
+
+    ArchiveRequestParams params = parse_multipart_body(body, boundary);
+    ASSERT_EQ(params.files.size(), 1);
+    EXPECT_EQ(params.files[0].name, "ref.txt");
+    EXPECT_EQ(params.files[0].data, data);
+
+    std::string unknown = ContentHasher::sha256(std::vector<uint8_t>{'?'});
+    std::string missing_body = body;
+    missing_body.replace(missing_body.find(digest), digest.size(), unknown);
+    try {
+        parse_multipart_body(missing_body, boundary);
+        FAIL() << "Expected BlobNotFound";
+    } catch (const BlobNotFound &e) {
+        EXPECT_EQ(e.getDigests(), std::vector<std::string>{unknown});
+    }
+}
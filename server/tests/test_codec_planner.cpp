@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include "../src/planner/codec_planner.h"
+#include <random>
+
+class CodecPlannerTest : public ::testing::Test {
+protected:
+    std::vector<FileEntry> textFiles() {
+        std::string line = "the quick brown fox jumps over the lazy archive server\n";
+        std::vector<uint8_t> data;
+        while (data.size() < 512 * 1024) {
+            data.insert(data.end(), line.begin(), line.end());
+        }
+        return {{"a.txt", data}, {"b.txt", data}};
+    }
+
+    std::vector<FileEntry> randomFiles() {
+        std::mt19937 gen(3);
+        std::vector<uint8_t> data(256 * 1024);
+        for (auto& byte : data) {
+            byte = gen() & 0xff;
+        }
+        return {{"random.bin", data}};
+    }
+};
+
+TEST_F(CodecPlannerTest, ParsesObjectives) {
+    EXPECT_EQ(CodecPlanner::objectiveFromString("min_time"), Objective::MIN_TIME);
+    EXPECT_EQ(CodecPlanner::objectiveFromString("MIN_SIZE"), Objective::MIN_SIZE);
+    EXPECT_EQ(CodecPlanner::objectiveFromString(""), Objective::BALANCED);
+    EXPECT_EQ(CodecPlanner::objectiveToString(Objective::MIN_SIZE), "min_size");
+    EXPECT_THROW(CodecPlanner::objectiveFromString("fastest"), std::runtime_error);
+}
+
+TEST_F(CodecPlannerTest, MinTimePicksFastestCandidate) {
+    CodecPlanner planner(CodecPlanner::Config{});
+    auto candidates = planner.getCandidates();
+    auto fastest = *std::max_element(candidates.begin(), candidates.end(),
+                                     [](const CodecCandidate& lhs, const CodecCandidate& rhs) {
+                                         return lhs.bytes_per_second < rhs.bytes_per_second;
+                                     });
+
+    CodecPlan plan = planner.plan(textFiles(), Objective::MIN_TIME);
+    EXPECT_EQ(plan.format, fastest.format);
+    EXPECT_EQ(plan.level, fastest.level);
+    EXPECT_EQ(plan.objective, Objective::MIN_TIME);
+    EXPECT_LT(plan.predicted_ratio, 0.1);
+    EXPECT_GT(plan.predicted_seconds, 0.0);
+}
+
+TEST_F(CodecPlannerTest, MinSizeBeatsOtherObjectivesOnRatio) {
+    CodecPlanner planner(CodecPlanner::Config{});
+    auto files = textFiles();
+
+    CodecPlan smallest = planner.plan(files, Objective::MIN_SIZE);
+    CodecPlan fastest = planner.plan(files, Objective::MIN_TIME);
+    CodecPlan balanced = planner.plan(files, Objective::BALANCED);
+    EXPECT_LE(smallest.predicted_ratio, fastest.predicted_ratio);
+    EXPECT_LE(smallest.predicted_ratio, balanced.predicted_ratio);
+    EXPECT_LE(fastest.predicted_seconds, balanced.predicted_seconds);
+}
+
+TEST_F(CodecPlannerTest, IncompressibleDataPredictsNoGain) {
+    CodecPlanner planner(CodecPlanner::Config{});
+    CodecPlan plan = planner.plan(randomFiles(), Objective::MIN_SIZE);
+    EXPECT_GT(plan.predicted_ratio, 0.98);
+}
+
+TEST_F(CodecPlannerTest, CalibrationMeasuresThroughput) {
+    CodecPlanner planner(CodecPlanner::Config{});
+    planner.calibrate(64 * 1024);
+    for (const auto& candidate : planner.getCandidates()) {
+        EXPECT_GT(candidate.bytes_per_second, 0.0);
+    }
+}
@@ -99,3 +99,51 @@ TEST_F(CompressorFactoryTest, DetectFormatFromData) {
     std::vector<uint8_t> small_data = {0x50, 0x4B};
     EXPECT_THROW(CompressorFactory::detectFormatFromData(small_data), std::runtime_error);
 }
+
+TEST_F(CompressorFactoryTest, ValidateOptionsPerFormat) {
+    CompressionOptions options;
+    for (auto format : {CompressionFormat::ZIP, CompressionFormat::TAR_GZ,
+                        CompressionFormat::TAR_BZ2, CompressionFormat::SEVEN_Z,
+                        CompressionFormat::TAR_ZST}) {
+        EXPECT_NO_THROW(CompressorFactory::validateOptions(format, options));
+    }
+
+    options.level = 9;
+    EXPECT_NO_THROW(CompressorFactory::validateOptions(CompressionFormat::ZIP, options));
+    options.level = 19;
+    EXPECT_NO_THROW(CompressorFactory::validateOptions(CompressionFormat::TAR_ZST, options));
+    EXPECT_THROW(CompressorFactory::validateOptions(CompressionFormat::TAR_GZ, options),
+                 std::runtime_error);
+    options.level = 0;
+    EXPECT_THROW(CompressorFactory::validateOptions(CompressionFormat::TAR_BZ2, options),
+                 std::runtime_error);
+
+    options = CompressionOptions{};
+    options.threads = 4;
+    EXPECT_NO_THROW(CompressorFactory::validateOptions(CompressionFormat::TAR_ZST, options));
+    EXPECT_THROW(CompressorFactory::validateOptions(CompressionFormat::SEVEN_Z, options),
+                 std::runtime_error);
+
+    options = CompressionOptions{};
+    options.block_size = 300000;
+    EXPECT_NO_THROW(CompressorFactory::validateOptions(CompressionFormat::TAR_BZ2, options));
+    EXPECT_NO_THROW(CompressorFactory::validateOptions(CompressionFormat::TAR_ZST, options));
+    EXPECT_THROW(CompressorFactory::validateOptions(CompressionFormat::TAR_GZ, options),
+                 std::runtime_error);
+    options.block_size = 250000;
+    EXPECT_THROW(CompressorFactory::validateOptions(CompressionFormat::TAR_BZ2, options),
+                 std::runtime_error);
+
+    options = CompressionOptions{};
+    options.solid = false;
+    EXPECT_NO_THROW(CompressorFactory::validateOptions(CompressionFormat::ZIP, options));
+    EXPECT_THROW(CompressorFactory::validateOptions(CompressionFormat::SEVEN_Z, options),
+                 std::runtime_error);
+
+    options = CompressionOptions{};
+    options.archive_options = "gzip:compression-level=1";
+    EXPECT_NO_THROW(CompressorFactory::validateOptions(CompressionFormat::TAR_GZ, options));
+    options.archive_options = "gzip:no-such-option=1";
+    EXPECT_THROW(CompressorFactory::validateOptions(CompressionFormat::TAR_GZ, options),
+                 std::runtime_error);
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include "../src/factory/factory.h"
+#include "../src/gzip/gzip_index.h"
+#include "../src/store/archive_store.h"
+#include <random>
+#include <zlib.h>
+
+class GzipIndexTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<> dis('a', 'h');
+        content.resize(4 * 1024 * 1024);
+        for (auto& byte : content) {
+            byte = dis(gen);
+        }
+    }
+
+    std::vector<uint8_t> gzip(const uint8_t* data, size_t size) {
+        z_stream stream{};
+        deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+        std::vector<uint8_t> output(deflateBound(&stream, size));
+        stream.next_in = const_cast<Bytef*>(data);
+        stream.avail_in = size;
+        stream.next_out = output.data();
+        stream.avail_out = output.size();
+        deflate(&stream, Z_FINISH);
+        output.resize(stream.total_out);
+        deflateEnd(&stream);
+        return output;
+    }
+
+    std::vector<uint8_t> content;
+};
+
+TEST_F(GzipIndexTest, ReadsFromNearestAccessPoint) {
+    auto compressed = gzip(content.data(), content.size());
+    GzipIndex index = GzipIndex::build(compressed.data(), compressed.size(), 256 * 1024);
+
+    EXPECT_EQ(index.getUncompressedSize(), content.size());
+    EXPECT_GT(index.getPointCount(), 4);
+
+    for (uint64_t offset : {0ULL, 1000ULL, 1500000ULL, 4194000ULL}) {
+        auto data = index.read(compressed.data(), compressed.size(), offset, 304);
+        EXPECT_TRUE(std::equal(data.begin(), data.end(), content.begin() + offset)) << offset;
+    }
+    EXPECT_THROW(index.read(compressed.data(), compressed.size(), content.size() - 1, 2),
+                 std::runtime_error);
+}
+
+TEST_F(GzipIndexTest, CrossesMemberBoundaries) {
+    size_t half = content.size() / 2;
+    auto compressed = gzip(content.data(), half);
+    auto second = gzip(content.data() + half, content.size() - half);
+    compressed.insert(compressed.end(), second.begin(), second.end());
+
+    GzipIndex index = GzipIndex::build(compressed.data(), compressed.size(), 1024 * 1024);
+    EXPECT_EQ(index.getUncompressedSize(), content.size());
+
+    auto data = index.read(compressed.data(), compressed.size(), half - 5000, 10000);
+    EXPECT_TRUE(std::equal(data.begin(), data.end(), content.begin() + half - 5000));
+}
+
+TEST_F(GzipIndexTest, BuilderHandsOutTheInflatedStream) {
+    size_t half = content.size() / 2;
+    auto compressed = gzip(content.data(), half);
+    auto second = gzip(content.data() + half, content.size() - half);
+    compressed.insert(compressed.end(), second.begin(), second.end());
+
+    GzipIndex::Builder builder(compressed.data(), compressed.size(), 256 * 1024);
+    std::vector<uint8_t> inflated;
+    for (auto chunk = builder.next(); !chunk.empty(); chunk = builder.next()) {
+        inflated.insert(inflated.end(), chunk.begin(), chunk.end());
+    }
+    GzipIndex index = builder.finish();
+
+    EXPECT_EQ(inflated, content);
+    EXPECT_EQ(index.getPointCount(),
+              GzipIndex::build(compressed.data(), compressed.size(), 256 * 1024).getPointCount());
+    auto data = index.read(compressed.data(), compressed.size(), half - 5000, 10000);
+    EXPECT_TRUE(std::equal(data.begin(), data.end(), content.begin() + half - 5000));
+}
+
+TEST_F(GzipIndexTest, AccessPointsCarryMemberCrc) {
+    size_t half = content.size() / 2;
+    auto compressed = gzip(content.data(), half);
+    auto second = gzip(content.data() + half, content.size() - half);
+    compressed.insert(compressed.end(), second.begin(), second.end());
+
+    GzipIndex index = GzipIndex::build(compressed.data(), compressed.size(), 256 * 1024);
+    for (uint64_t offset : {1000ULL, 1500000ULL, half + 1000ULL, 4194000ULL}) {
+        const auto& point = index.pointFor(offset);
+        uint64_t member = index.memberFor(offset).out;
+        uLong expected = crc32(0L, content.data() + member, point.out - member);
+        EXPECT_EQ(point.crc, expected) << offset;
+    }
+}
+
+TEST_F(GzipIndexTest, StoredTarGzUsesIndex) {
+    std::vector<FileEntry> files;
+    for (int i = 0; i < 8; ++i) {
+        size_t chunk = content.size() / 8;
+        files.emplace_back("part" + std::to_string(i) + ".txt",
+                           std::vector<uint8_t>(content.begin() + i * chunk,
+                                                content.begin() + (i + 1) * chunk));
+    }
+    auto compressor = CompressorFactory::createCompressor(CompressionFormat::TAR_GZ);
+    auto data = std::make_shared<const std::vector<uint8_t>>(compressor->compress(files));
+
+    StoredArchive archive("id", data, 256 * 1024);
+    EXPECT_GT(archive.getAccessPointCount(), 4);
+    EXPECT_GT(archive.getFootprint(), archive.getSize());
+
+    const ArchiveEntryInfo* entry = archive.find("part6.txt");
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(archive.readEntry(*entry), files[6].data);
+}
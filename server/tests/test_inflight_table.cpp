@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include "../src/cache/inflight_table.h"
+#include <future>
+#include <thread>
+
+class InflightTableTest : public ::testing::Test {
+protected:
+    void SetUp() override {}
+    void TearDown() override {}
+
+    // Completes on service, so results are read on the test thread.
+    auto storeIn(InflightTable::Result& result, std::exception_ptr& error) {
+        return boost::asio::bind_executor(
+            service, [&result, &error](std::exception_ptr e, InflightTable::Result r) {
+                error = e;
+                result = r;
+            });
+    }
+
+    boost::asio::io_context service;
+};
+
+TEST_F(InflightTableTest, CoalescesWithoutBlockingFollowers) {
+    InflightTable table;
+    std::atomic<int> calls{0};
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::promise<void> leader_started;
+
+    InflightTable::Result leader_result;
+    std::exception_ptr leader_error;
+    std::thread leader([&]() {
+        table.asyncRun("key", [&]() {
+            ++calls;
+            leader_started.set_value();
+            released.wait();
+            return std::make_shared<const std::vector<uint8_t>>(3, 7);
+        }, storeIn(leader_result, leader_error));
+    });
+
+    leader_started.get_future().wait();
+
+    // Followers return at once and are resumed on their executor later.
+    std::vector<InflightTable::Result> results(4);
+    std::vector<std::exception_ptr> errors(results.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        table.asyncRun("key", [&]() {
+            ++calls;
+            return std::make_shared<const std::vector<uint8_t>>();
+        }, storeIn(results[i], errors[i]));
+    }
+    EXPECT_EQ(table.getCoalescedCount(), results.size());
+    EXPECT_EQ(service.poll(), 0u);
+
+    release.set_value();
+    leader.join();
+    service.run();
+
+    EXPECT_EQ(calls.load(), 1);
+    EXPECT_FALSE(leader_error);
+    EXPECT_FALSE(leader_result.coalesced);
+    for (size_t i = 0; i < results.size(); ++i) {
+        EXPECT_FALSE(errors[i]);
+        EXPECT_TRUE(results[i].coalesced);
+        ASSERT_NE(results[i].data, nullptr);
+        EXPECT_EQ(results[i].data->size(), 3);
+    }
+    EXPECT_EQ(table.getInFlight(), 0);
+}
+
+TEST_F(InflightTableTest, SequentialCallsRunAgain) {
+    InflightTable table;
+    int calls = 0;
+    auto producer = [&]() {
+        ++calls;
+        return std::make_shared<const std::vector<uint8_t>>(1, 1);
+    };
+
+    InflightTable::Result first, second;
+    std::exception_ptr error;
+    table.asyncRun("key", producer, storeIn(first, error));
+    table.asyncRun("key", producer, storeIn(second, error));
+    service.run();
+
+    EXPECT_FALSE(first.coalesced);
+    EXPECT_FALSE(second.coalesced);
+    EXPECT_EQ(calls, 2);
+}
+
+TEST_F(InflightTableTest, FailureIsNotRemembered) {
+    InflightTable table;
+
+    InflightTable::Result result;
+    std::exception_ptr error;
+    table.asyncRun("key", []() -> SharedBuffer {
+        throw std::runtime_error("failed");
+    }, storeIn(result, error));
+    service.run();
+    EXPECT_THROW(std::rethrow_exception(error), std::runtime_error);
+
+    service.restart();
+    table.asyncRun("key", []() {
+        return std::make_shared<const std::vector<uint8_t>>(2, 0);
+    }, storeIn(result, error));
+    service.run();
+    EXPECT_FALSE(error);
+    EXPECT_EQ(result.data->size(), 2);
+    EXPECT_EQ(table.getInFlight(), 0);
+}
@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include "../src/server/level_governor.h"
+
+class LevelGovernorTest : public ::testing::Test {
+protected:
+    LevelGovernor::Config makeConfig() {
+        LevelGovernor::Config config;
+        config.latency_target = std::chrono::milliseconds(100);
+        return config;
+    }
+
+    PoolLoad idle() { return PoolLoad{1, 4, 0.0}; }
+    PoolLoad saturated() { return PoolLoad{12, 4, 0.36}; }
+};
+
+TEST_F(LevelGovernorTest, DisabledWithoutTarget) {
+    LevelGovernor governor(LevelGovernor::Config{});
+    EXPECT_FALSE(governor.isEnabled());
+    governor.configure(makeConfig());
+    EXPECT_TRUE(governor.isEnabled());
+}
+
+TEST_F(LevelGovernorTest, KeepsRequestedLevelWhenIdle) {
+    LevelGovernor governor(makeConfig());
+
+    auto decision = governor.choose(CompressionFormat::TAR_GZ, 9, 1024 * 1024, idle());
+    EXPECT_EQ(decision.level, 9);
+    EXPECT_FALSE(decision.degraded);
+    EXPECT_FALSE(decision.store_incompressible);
+
+    decision = governor.choose(CompressionFormat::TAR_ZST, -1, 1024 * 1024, idle());
+    EXPECT_EQ(decision.level, LevelGovernor::defaultLevel(CompressionFormat::TAR_ZST));
+}
+
+TEST_F(LevelGovernorTest, LowersLevelUnderQueuePressure) {
+    LevelGovernor governor(makeConfig());
+    size_t bytes = 1024 * 1024;
+
+    auto decision = governor.choose(CompressionFormat::TAR_GZ, 9, bytes, saturated());
+    EXPECT_TRUE(decision.degraded);
+    EXPECT_TRUE(decision.store_incompressible);
+    EXPECT_LT(decision.level, 9);
+    EXPECT_GE(decision.level, LevelGovernor::minLevel(CompressionFormat::TAR_GZ));
+
+    auto recovered = governor.choose(CompressionFormat::TAR_GZ, 9, bytes, idle());
+    EXPECT_EQ(recovered.level, 9);
+
+    auto stats = governor.getStats();
+    EXPECT_EQ(stats.adaptive, 2);
+    EXPECT_EQ(stats.degraded, 1);
+    EXPECT_EQ(stats.levels["tar.gz:9"], 1);
+}
+
+TEST_F(LevelGovernorTest, LearnsPerByteCost) {
+    LevelGovernor governor(makeConfig());
+    size_t bytes = 1024 * 1024;
+
+    governor.record(CompressionFormat::ZIP, 6, bytes, std::chrono::milliseconds(500));
+    EXPECT_NEAR(governor.secondsPerByte(CompressionFormat::ZIP, 6), 0.5 / bytes, 1e-12);
+
+    auto decision = governor.choose(CompressionFormat::ZIP, 6, bytes, idle());
+    EXPECT_TRUE(decision.degraded);
+    EXPECT_LT(decision.level, 6);
+
+    governor.record(CompressionFormat::ZIP, 6, bytes, std::chrono::milliseconds(0));
+    EXPECT_LT(governor.secondsPerByte(CompressionFormat::ZIP, 6), 0.5 / bytes);
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include "../src/server/load_shedder.h"
+
+class LoadShedderTest : public ::testing::Test {
+protected:
+    void SetUp() override {}
+    void TearDown() override {}
+
+    HttpRequestHeader makeHeader(const std::string& target, size_t content_length,
+                                 const std::string& format = "") {
+        HttpRequestHeader header;
+        header.method(http::verb::post);
+        header.target(target);
+        header.version(11);
+        header.set(http::field::content_length, std::to_string(content_length));
+        if (!format.empty()) {
+            header.set("X-Archive-Format", format);
+        }
+        return header;
+    }
+
+    LoadShedder::Config makeConfig() {
+        LoadShedder::Config config;
+        config.max_body_size = 1024 * 1024;
+        config.max_in_flight = 2;
+        config.latency_slo = std::chrono::seconds(10);
+        config.workers = 1;
+        return config;
+    }
+};
+
+TEST_F(LoadShedderTest, EstimateCostFromHeader) {
+    LoadShedder shedder(makeConfig());
+
+    auto compress = shedder.estimateCost(makeHeader("/archive/compress", 1000, "ZIP"));
+    EXPECT_EQ(compress.key, "/archive/compress:zip");
+    EXPECT_EQ(compress.body_bytes, 1000);
+    EXPECT_GT(compress.memory_bytes, compress.body_bytes);
+
+    auto extract = shedder.estimateCost(makeHeader("/archive/extract?include=*.txt", 1000));
+    EXPECT_EQ(extract.key, "/archive/extract");
+    EXPECT_LT(extract.seconds, compress.seconds);
+}
+
+TEST_F(LoadShedderTest, RejectsOversizedBody) {
+    LoadShedder shedder(makeConfig());
+
+    auto cost = shedder.estimateCost(makeHeader("/archive/compress", 2 * 1024 * 1024));
+    Admission admission = shedder.admit(cost);
+
+    EXPECT_EQ(admission.decision, AdmissionDecision::TOO_LARGE);
+    EXPECT_EQ(shedder.getTooLargeCount(), 1);
+    EXPECT_EQ(shedder.getInFlight(), 0);
+}
+
+TEST_F(LoadShedderTest, RejectsWhenQueueIsFull) {
+    LoadShedder shedder(makeConfig());
+    auto cost = shedder.estimateCost(makeHeader("/archive/compress", 1000));
+
+    ASSERT_TRUE(shedder.admit(cost).accepted());
+    LoadShedder::Ticket first(shedder, cost);
+    ASSERT_TRUE(shedder.admit(cost).accepted());
+    LoadShedder::Ticket second(shedder, cost);
+
+    Admission admission = shedder.admit(cost);
+    EXPECT_EQ(admission.decision, AdmissionDecision::OVERLOADED);
+    EXPECT_GE(admission.retry_after, 1);
+    EXPECT_EQ(shedder.getInFlight(), 2);
+}
+
+TEST_F(LoadShedderTest, RejectsWhenSloWouldBeExceeded) {
+    auto config = makeConfig();
+    config.max_in_flight = 100;
+    config.latency_slo = std::chrono::milliseconds(1);
+    LoadShedder shedder(config);
+
+    auto cost = shedder.estimateCost(makeHeader("/archive/compress", 1000 * 1000));
+    ASSERT_TRUE(shedder.admit(cost).accepted());
+    LoadShedder::Ticket running(shedder, cost);
+
+    EXPECT_EQ(shedder.admit(cost).decision, AdmissionDecision::OVERLOADED);
+}
+
+TEST_F(LoadShedderTest, TicketReleasesSlot) {
+    LoadShedder shedder(makeConfig());
+    auto cost = shedder.estimateCost(makeHeader("/archive/extract", 1000));
+
+    {
+        ASSERT_TRUE(shedder.admit(cost).accepted());
+        LoadShedder::Ticket ticket(shedder, cost);
+        EXPECT_EQ(shedder.getInFlight(), 1);
+    }
+
+    EXPECT_EQ(shedder.getInFlight(), 0);
+    EXPECT_DOUBLE_EQ(shedder.getBacklogSeconds(), 0.0);
+}
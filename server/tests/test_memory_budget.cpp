@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+#include "../src/memory/memory_budget.h"
+#include "../src/server/request/request_handler.h"
+#include <thread>
+
+class MemoryBudgetTest : public ::testing::Test {
+protected:
+    void SetUp() override {}
+    void TearDown() override {}
+};
+
+TEST_F(MemoryBudgetTest, TracksUsageAndHighWaterMark) {
+    MemoryBudget budget(1000, 1000, std::chrono::milliseconds(10));
+
+    {
+        MemoryAccount first(budget);
+        MemoryAccount second(budget);
+        first.reserve(300);
+        second.reserve(400);
+
+        EXPECT_EQ(budget.getUsage(), 700);
+        EXPECT_EQ(first.getReserved(), 300);
+        EXPECT_EQ(second.getReserved(), 400);
+    }
+
+    EXPECT_EQ(budget.getUsage(), 0);
+    EXPECT_EQ(budget.getHighWaterMark(), 700);
+}
+
+TEST_F(MemoryBudgetTest, PerRequestLimit) {
+    MemoryBudget budget(1000, 500, std::chrono::milliseconds(10));
+    MemoryAccount account(budget);
+
+    account.reserve(400);
+    EXPECT_THROW(account.reserve(200), RequestTooLarge);
+    EXPECT_EQ(budget.getUsage(), 400);
+
+    account.release(100);
+    EXPECT_NO_THROW(account.reserve(200));
+    EXPECT_EQ(budget.getUsage(), 500);
+}
+
+TEST_F(MemoryBudgetTest, RejectsWhenBudgetExhausted) {
+    MemoryBudget budget(1000, 1000, std::chrono::milliseconds(10));
+    MemoryAccount holder(budget);
+    holder.reserve(800);
+
+    MemoryAccount account(budget);
+    EXPECT_THROW(account.reserve(300), MemoryBudgetExceeded);
+    EXPECT_EQ(account.getReserved(), 0);
+    EXPECT_EQ(budget.getRejectedCount(), 1);
+    EXPECT_FALSE(budget.tryReserve(300));
+}
+
+TEST_F(MemoryBudgetTest, ReserveRejectsWithoutWaiting) {
+    MemoryBudget budget(1000, 1000, std::chrono::milliseconds(5000));
+    MemoryAccount holder(budget);
+    holder.reserve(800);
+
+    MemoryAccount account(budget);
+    auto started = std::chrono::steady_clock::now();
+    try {
+        account.reserve(300);
+        FAIL() << "reserve should throw";
+    } catch (const MemoryBudgetExceeded& e) {
+        EXPECT_EQ(e.getRetryAfter(), 5);
+    }
+    EXPECT_LT(std::chrono::steady_clock::now() - started, std::chrono::seconds(1));
+    EXPECT_FALSE(account.tryReserve(300));
+}
+
+TEST_F(MemoryBudgetTest, QueuedReservationProceedsAfterRelease) {
+    MemoryBudget budget(1000, 1000, std::chrono::milliseconds(5000));
+    auto holder = std::make_unique<MemoryAccount>(budget);
+    holder->reserve(800);
+
+    MemoryAccount account(budget);
+    uint64_t generation = budget.getReleaseGeneration();
+    ASSERT_FALSE(account.tryReserve(300));
+
+    boost::asio::io_context service;
+    boost::system::error_code result = boost::asio::error::timed_out;
+    budget.asyncWaitForRelease(service.get_executor(), generation,
+                               std::chrono::steady_clock::now() + std::chrono::seconds(5),
+                               [&result](boost::system::error_code ec) { result = ec; });
+
+    std::thread releaser([&holder]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        holder.reset();
+    });
+    service.run();
+    releaser.join();
+
+    EXPECT_FALSE(result);
+    EXPECT_TRUE(account.tryReserve(300));
+    EXPECT_EQ(budget.getUsage(), 300);
+}
+
+TEST_F(MemoryBudgetTest, QueuedReservationTimesOut) {
+    MemoryBudget budget(1000, 1000, std::chrono::milliseconds(5000));
+    MemoryAccount holder(budget);
+    holder.reserve(800);
+
+    boost::asio::io_context service;
+    boost::system::error_code result;
+    budget.asyncWaitForRelease(service.get_executor(), budget.getReleaseGeneration(),
+                               std::chrono::steady_clock::now() + std::chrono::milliseconds(20),
+                               [&result](boost::system::error_code ec) { result = ec; });
+    service.run();
+
+    EXPECT_EQ(result, boost::asio::error::timed_out);
+}
+
+TEST_F(MemoryBudgetTest, ReleaseBeforeWaitIsNotMissed) {
+    MemoryBudget budget(1000, 1000, std::chrono::milliseconds(5000));
+    auto holder = std::make_unique<MemoryAccount>(budget);
+    holder->reserve(800);
+
+    uint64_t generation = budget.getReleaseGeneration();
+    holder.reset();
+
+    boost::asio::io_context service;
+    boost::system::error_code result = boost::asio::error::timed_out;
+    auto started = std::chrono::steady_clock::now();
+    budget.asyncWaitForRelease(service.get_executor(), generation,
+                               started + std::chrono::seconds(5),
+                               [&result](boost::system::error_code ec) { result = ec; });
+    service.run();
+
+    EXPECT_FALSE(result);
+    EXPECT_LT(std::chrono::steady_clock::now() - started, std::chrono::seconds(1));
+}
+
+TEST_F(MemoryBudgetTest, HandlerRejectsOversizedRequest) {
+    MemoryBudget budget(1000, 100, std::chrono::milliseconds(10));
+    MemoryAccount account(budget);
+
+    HttpRequest req{http::verb::post, "/archive/extract", 11};
+    req.body() = std::string(200, 'x');
+    req.prepare_payload();
+
+    auto resp = handle_request(req, account);
+    EXPECT_EQ(resp.result(), http::status::payload_too_large);
+}
@@ -2,8 +2,10 @@
 #include "../src/processor/processor.h"
 #include "../src/factory/factory.h"
 #include "../src/compressor/compressor.h"
+#include "../src/zstd/seekable_zstd.h"
 #include <fstream>
 #include <filesystem>
+#include <random>
 
 class ArchiveProcessorTest : public ::testing::Test {
 protected:
@@ -228,3 +230,282 @@ TEST_F(ArchiveProcessorTest, DirectoryStructure) {
     
     EXPECT_EQ(expected_names, actual_names);
 }
+
+TEST_F(ArchiveProcessorTest, ReproducibleCompression) {
+    for (auto format : {CompressionFormat::ZIP, CompressionFormat::TAR_GZ}) {
+        ArchiveRequest request;
+        request.operation = ArchiveOperation::COMPRESS;
+        request.format = format;
+        request.archive_name = "reproducible";
+        request.reproducible = true;
+        request.files = createTestFiles();
+
+        auto early = CompressorFactory::createCompressor(format);
+        early->setClock([]() { return time_t(1000000000); });
+        ArchiveProcessor first(request, early);
+        first.process();
+
+        auto late = CompressorFactory::createCompressor(format);
+        late->setClock([]() { return time_t(2000000000); });
+        std::reverse(request.files.begin(), request.files.end());
+        ArchiveProcessor second(request, late);
+        second.process();
+
+        EXPECT_EQ(first.getArchiveData(), second.getArchiveData());
+    }
+}
+
+TEST_F(ArchiveProcessorTest, DeduplicatedCompressionRoundTrip) {
+    std::vector<FileEntry> files = createTestFiles();
+    FileEntry copy = files[2];
+    copy.name = "copy/binary.dat";
+    files.push_back(copy);
+
+    auto stats = LibArchiveCompressor::measureDuplicates(files);
+    EXPECT_EQ(stats.entries, 1);
+    EXPECT_EQ(stats.saved_bytes, 256);
+
+    for (auto format : {CompressionFormat::ZIP, CompressionFormat::TAR_GZ}) {
+        ArchiveRequest request;
+        request.operation = ArchiveOperation::COMPRESS;
+        request.format = format;
+        request.archive_name = "dedup";
+        request.deduplicate = true;
+        request.files = files;
+
+        ArchiveProcessor processor(request, CompressorFactory::createCompressor(format));
+        processor.process();
+        EXPECT_EQ(processor.getCompressStats().dedup.entries, stats.entries);
+        EXPECT_EQ(processor.getCompressStats().dedup.saved_bytes, stats.saved_bytes);
+
+        ArchiveRequest extract_request;
+        extract_request.operation = ArchiveOperation::EXTRACT;
+        extract_request.format = format;
+        extract_request.archive_data = processor.getArchiveData();
+
+        ArchiveProcessor extractor(extract_request, CompressorFactory::createCompressor(format));
+        extractor.process();
+
+        const auto& extracted = extractor.getExtractedFiles();
+        ASSERT_EQ(extracted.size(), files.size());
+        for (size_t i = 0; i < files.size(); ++i) {
+            EXPECT_EQ(extracted[i].name, files[i].name);
+            EXPECT_EQ(extracted[i].data, files[i].data);
+        }
+    }
+}
+
+TEST_F(ArchiveProcessorTest, SelectiveExtraction) {
+    std::vector<FileEntry> files = createTestFiles();
+    FileEntry copy = files[2];
+    copy.name = "copy/binary.dat";
+    files.push_back(copy);
+
+    for (auto format : {CompressionFormat::ZIP, CompressionFormat::TAR_GZ}) {
+        auto compressor = CompressorFactory::createCompressor(format);
+        compressor->setDeduplicate(true);
+        std::vector<uint8_t> archive = compressor->compress(files);
+
+        ArchiveRequest request;
+        request.operation = ArchiveOperation::EXTRACT;
+        request.format = format;
+        request.archive_data = archive;
+        request.filter.include = {"*.txt", "copy/*"};
+        request.filter.exclude = {"test2.*"};
+
+        ArchiveProcessor extractor(request, CompressorFactory::createCompressor(format));
+        extractor.process();
+
+        const auto& extracted = extractor.getExtractedFiles();
+        ASSERT_EQ(extracted.size(), 2);
+        EXPECT_EQ(extracted[0].name, "test1.txt");
+        EXPECT_EQ(extracted[1].name, "copy/binary.dat");
+        EXPECT_EQ(extracted[1].data, files[2].data);
+
+        request.filter = EntryFilter{};
+        request.filter.max_entry_size = 20;
+        ArchiveProcessor small(request, CompressorFactory::createCompressor(format));
+        small.process();
+        ASSERT_EQ(small.getExtractedFiles().size(), 1);
+        EXPECT_EQ(small.getExtractedFiles()[0].name, "test1.txt");
+    }
+}
+
+TEST_F(ArchiveProcessorTest, ConvertBetweenFormats) {
+    std::vector<FileEntry> files = createTestFiles();
+    FileEntry copy = files[2];
+    copy.name = "copy/binary.dat";
+    files.push_back(copy);
+
+    auto source = CompressorFactory::createCompressor(CompressionFormat::TAR_GZ);
+    source->setDeduplicate(true);
+    std::vector<uint8_t> archive = source->compress(files);
+
+    for (auto format : {CompressionFormat::ZIP, CompressionFormat::TAR_BZ2, CompressionFormat::TAR_ZST}) {
+        ArchiveRequest request;
+        request.operation = ArchiveOperation::CONVERT;
+        request.format = format;
+        request.archive_data = archive;
+
+        ArchiveProcessor converter(request, CompressorFactory::createCompressor(format));
+        converter.process();
+        EXPECT_EQ(CompressorFactory::detectFormatFromData(converter.getArchiveData()), format);
+
+        auto extracted = CompressorFactory::createCompressor(format)->extract(converter.getArchiveData());
+        ASSERT_EQ(extracted.size(), files.size());
+        for (size_t i = 0; i < files.size(); ++i) {
+            EXPECT_EQ(extracted[i].name, files[i].name);
+            EXPECT_EQ(extracted[i].data, files[i].data) << files[i].name;
+        }
+    }
+}
+
+TEST_F(ArchiveProcessorTest, ConvertWritesLinksToFilteredTargetsAsFiles) {
+    std::vector<FileEntry> files = createTestFiles();
+    FileEntry copy = files[2];
+    copy.name = "copy/binary.dat";
+    files.push_back(copy);
+
+    auto source = CompressorFactory::createCompressor(CompressionFormat::TAR_GZ);
+    source->setDeduplicate(true);
+    std::vector<uint8_t> archive = source->compress(files);
+
+    MemoryBudget budget(1 << 30, 1 << 30, std::chrono::milliseconds(10));
+    MemoryAccount account(budget);
+    ArchiveRequest request;
+    request.operation = ArchiveOperation::CONVERT;
+    request.format = CompressionFormat::TAR_BZ2;
+    request.archive_data = archive;
+    request.filter.exclude = {files[2].name};
+    request.memory = &account;
+
+    ArchiveProcessor converter(request, CompressorFactory::createCompressor(request.format));
+    converter.process();
+    EXPECT_GE(account.getReserved(), converter.getArchiveData().size());
+
+    auto extracted =
+        CompressorFactory::createCompressor(request.format)->extract(converter.getArchiveData());
+    ASSERT_EQ(extracted.size(), 3);
+    EXPECT_EQ(extracted[2].name, "copy/binary.dat");
+    EXPECT_EQ(extracted[2].data, files[2].data);
+}
+
+TEST_F(ArchiveProcessorTest, CompressSeveralFormatsConcurrently) {
+    ArchiveRequest request;
+    request.files = createTestFiles();
+    std::vector<CompressionFormat> formats = {CompressionFormat::ZIP, CompressionFormat::TAR_GZ,
+                                              CompressionFormat::SEVEN_Z};
+
+    auto archives = ArchiveProcessor::compressFormats(request, formats);
+    ASSERT_EQ(archives.size(), formats.size());
+
+    for (size_t i = 0; i < formats.size(); ++i) {
+        EXPECT_EQ(CompressorFactory::detectFormatFromData(archives[i]), formats[i]);
+
+        auto extracted = CompressorFactory::createCompressor(formats[i])->extract(archives[i]);
+        ASSERT_EQ(extracted.size(), request.files.size());
+        for (size_t j = 0; j < extracted.size(); ++j) {
+            EXPECT_EQ(extracted[j].data, request.files[j].data);
+        }
+    }
+}
+
+TEST_F(ArchiveProcessorTest, CompressionLevels) {
+    std::vector<uint8_t> text;
+    std::string line = "level controls the trade between time and ratio\n";
+    for (int i = 0; i < 2000; ++i) {
+        text.insert(text.end(), line.begin(), line.end());
+        text.push_back(static_cast<uint8_t>(i));
+    }
+    std::vector<FileEntry> files = {{"text.txt", text}};
+
+    for (auto format : {CompressionFormat::TAR_GZ, CompressionFormat::TAR_ZST, CompressionFormat::ZIP}) {
+        auto fast = CompressorFactory::createCompressor(format);
+        fast->setLevel(1);
+        auto archive = fast->compress(files);
+
+        auto extracted = CompressorFactory::createCompressor(format)->extract(archive);
+        ASSERT_EQ(extracted.size(), 1);
+        EXPECT_EQ(extracted[0].data, text);
+    }
+
+    auto invalid = CompressorFactory::createCompressor(CompressionFormat::TAR_GZ);
+    invalid->setLevel(42);
+    EXPECT_THROW(invalid->compress(files), std::runtime_error);
+}
+
+TEST_F(ArchiveProcessorTest, StoresIncompressibleEntries) {
+    std::mt19937 gen(5);
+    std::vector<uint8_t> noise(256 * 1024);
+    for (auto& byte : noise) {
+        byte = gen() & 0xff;
+    }
+    std::vector<uint8_t> text(128 * 1024, 'a');
+
+    EXPECT_TRUE(LibArchiveCompressor::isIncompressible(noise));
+    EXPECT_FALSE(LibArchiveCompressor::isIncompressible(text));
+
+    // Only the last window shrinks, so sampling the middle alone would miss it.
+    std::vector<uint8_t> mostly_noise = noise;
+    std::fill(mostly_noise.end() - 64 * 1024, mostly_noise.end(), 'a');
+    EXPECT_FALSE(LibArchiveCompressor::isIncompressible(mostly_noise));
+
+    std::vector<FileEntry> files = {{"noise.bin", noise}, {"text.txt", text}};
+    for (auto format : {CompressionFormat::ZIP, CompressionFormat::TAR_GZ}) {
+        LibArchiveCompressor compressor(format);
+        compressor.setLevel(1);
+        compressor.setStoreIncompressible(true);
+        auto archive = compressor.compress(files);
+        EXPECT_LT(archive.size(), noise.size() + text.size() / 10);
+
+        auto extracted = LibArchiveCompressor(format).extract(archive);
+        ASSERT_EQ(extracted.size(), 2);
+        EXPECT_EQ(extracted[0].data, noise);
+        EXPECT_EQ(extracted[1].data, text);
+    }
+
+    // Falling back to level 0 for one upload leaves the next one compressed.
+    LibArchiveCompressor compressor(CompressionFormat::TAR_GZ);
+    compressor.setLevel(1);
+    compressor.setStoreIncompressible(true);
+    compressor.compress({{"noise.bin", noise}});
+    EXPECT_LT(compressor.compress({{"text.txt", text}}).size(), text.size() / 10);
+}
+
+TEST_F(ArchiveProcessorTest, CompressionOptions) {
+    std::vector<uint8_t> data;
+    for (int i = 0; i < 200000; ++i) {
+        data.push_back(static_cast<uint8_t>((i * 7) % 251));
+    }
+    std::vector<FileEntry> files = {{"table.bin", data}};
+
+    ArchiveRequest request;
+    request.operation = ArchiveOperation::COMPRESS;
+    request.files = files;
+    request.archive_name = "options";
+
+    request.format = CompressionFormat::TAR_ZST;
+    request.options.threads = 2;
+    request.options.block_size = 64 * 1024;
+    ArchiveProcessor zst(request, CompressorFactory::createCompressor(request.format));
+    zst.process();
+    SeekableZstd seekable(zst.getArchiveData().data(), zst.getArchiveData().size());
+    EXPECT_GT(seekable.getFrames().size(), 1);
+
+    request.format = CompressionFormat::TAR_BZ2;
+    request.options = CompressionOptions{};
+    request.options.block_size = 100000;
+    ArchiveProcessor bz2(request, CompressorFactory::createCompressor(request.format));
+    bz2.process();
+    auto extracted = CompressorFactory::createCompressor(request.format)
+                         ->extract(bz2.getArchiveData());
+    ASSERT_EQ(extracted.size(), 1);
+    EXPECT_EQ(extracted[0].data, data);
+
+    request.format = CompressionFormat::TAR_GZ;
+    request.options = CompressionOptions{};
+    request.options.archive_options = "gzip:compression-level=1";
+    ArchiveProcessor gz(request, CompressorFactory::createCompressor(request.format));
+    gz.process();
+    EXPECT_FALSE(gz.getArchiveData().empty());
+}
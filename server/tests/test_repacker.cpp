@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include "../src/factory/factory.h"
+#include "../src/repack/repacker.h"
+#include "../src/server/request/request_params.h"
+#include "../src/store/archive_store.h"
+
+class RepackerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        first = {
+            {"a.txt", std::vector<uint8_t>(3000, 'a')},
+            {"shared.txt", std::vector<uint8_t>{'o', 'n', 'e'}},
+        };
+        second = {
+            {"b.bin", std::vector<uint8_t>(5000, 7)},
+            {"shared.txt", std::vector<uint8_t>{'t', 'w', 'o'}},
+            {"empty.txt", std::vector<uint8_t>{}},
+        };
+    }
+
+    StoredArchive store(const std::string& id, CompressionFormat format, const std::vector<FileEntry>& files) {
+        auto compressor = CompressorFactory::createCompressor(format);
+        return StoredArchive(id, std::make_shared<const std::vector<uint8_t>>(compressor->compress(files)));
+    }
+
+    std::vector<uint8_t> repack(CompressionFormat format, const std::vector<const StoredArchive*>& archives,
+                                RepackStats& stats) {
+        Repacker repacker(format, 0);
+        for (const StoredArchive* archive : archives) {
+            for (const auto& entry : archive->getEntries()) {
+                repacker.add(*archive, entry);
+            }
+        }
+        auto output = repacker.finish();
+        stats = repacker.getStats();
+        return output;
+    }
+
+    std::vector<FileEntry> first;
+    std::vector<FileEntry> second;
+};
+
+TEST_F(RepackerTest, MergesZipEntriesWithoutRecompression) {
+    StoredArchive a = store("a", CompressionFormat::ZIP, first);
+    StoredArchive b = store("b", CompressionFormat::ZIP, second);
+
+    RepackStats stats;
+    auto output = repack(CompressionFormat::ZIP, {&a, &b}, stats);
+    EXPECT_EQ(stats.entries, 4);
+    EXPECT_EQ(stats.copied, 4);
+    EXPECT_EQ(stats.recompressed, 0);
+
+    StoredArchive merged("merged", std::make_shared<const std::vector<uint8_t>>(output));
+    ASSERT_EQ(merged.getEntries().size(), 4);
+    EXPECT_EQ(merged.find("a.txt")->compressed_size, a.find("a.txt")->compressed_size);
+    EXPECT_EQ(merged.readEntry(*merged.find("shared.txt")), first[1].data);
+    EXPECT_EQ(merged.readEntry(*merged.find("b.bin")), second[0].data);
+
+    auto extracted = CompressorFactory::createCompressor(CompressionFormat::ZIP)->extract(output);
+    EXPECT_EQ(extracted.size(), 4);
+}
+
+TEST_F(RepackerTest, CopiesTarGzMembersOnEntryBoundaries) {
+    StoredArchive a = store("a", CompressionFormat::ZIP, first);
+    StoredArchive b = store("b", CompressionFormat::TAR_GZ, second);
+
+    RepackStats stats;
+    auto output = repack(CompressionFormat::TAR_GZ, {&a, &b}, stats);
+    EXPECT_EQ(stats.entries, 4);
+    EXPECT_EQ(stats.copied, 0);
+
+    StoredArchive repacked("repacked", std::make_shared<const std::vector<uint8_t>>(output));
+    ASSERT_EQ(repacked.getEntries().size(), 4);
+    EXPECT_EQ(repacked.readEntry(*repacked.find("b.bin")), second[0].data);
+
+    auto again = repack(CompressionFormat::TAR_GZ, {&repacked}, stats);
+    EXPECT_EQ(stats.copied, 4);
+    EXPECT_EQ(stats.recompressed, 0);
+
+    auto extracted = CompressorFactory::createCompressor(CompressionFormat::TAR_GZ)->extract(again);
+    ASSERT_EQ(extracted.size(), 4);
+    EXPECT_EQ(extracted[0].data, first[0].data);
+    EXPECT_EQ(extracted[2].data, second[0].data);
+}
+
+TEST_F(RepackerTest, ParsesRepackManifest) {
+    auto selections = parse_repack_manifest("abc docs/*.md\r\n\ndef\n");
+    ASSERT_EQ(selections.size(), 2);
+    EXPECT_EQ(selections[0].archive_id, "abc");
+    EXPECT_EQ(selections[0].pattern, "docs/*.md");
+    EXPECT_EQ(selections[1].pattern, "*");
+
+    EXPECT_THROW(parse_repack_manifest("\n"), std::runtime_error);
+    EXPECT_THROW(Repacker(CompressionFormat::TAR_BZ2, 0), std::runtime_error);
+}
@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include "../src/server/request/request_handler.h"
 #include "../src/server/request/request_params.h"
 #include "../src/server/request/multipart_parser.h"
 #include "../src/processor/processor.h"
@@ -337,3 +338,122 @@ TEST_F(RequestParamsTest, ParseMultipartBinaryFileData) {
         EXPECT_EQ(params.files[0].data[i], static_cast<uint8_t>(i));
     }
 }
+
+TEST_F(RequestParamsTest, ParseMultipartReproducibleFields) {
+    std::string boundary = "----WebKitFormBoundaryReproducible";
+    std::string body = createMultipartBody(boundary);
+    body.resize(body.size() - std::string("--" + boundary + "--\r\n").size());
+
+    body += "--" + boundary + "\r\n";
+    body += "content-disposition: form-data; name=\"mtime\"\r\n";
+    body += "\r\n";
+    body += "1700000000\r\n";
+    body += "--" + boundary + "--\r\n";
+
+    ArchiveRequestParams params = parse_multipart_body(body, boundary);
+    EXPECT_TRUE(params.reproducible);
+
+    ArchiveRequest request = params.toArchiveRequest();
+    EXPECT_TRUE(request.reproducible);
+    EXPECT_EQ(request.mtime, 1700000000);
+}
+
+TEST_F(RequestParamsTest, ParseMultipartFormatList) {
+    std::string boundary = "----WebKitFormBoundaryFormatList";
+    std::string body = createMultipartBody(boundary);
+    body.replace(body.find("\r\nzip\r\n"), 7, "\r\nzip,tar.gz,7z,zip\r\n");
+
+    ArchiveRequestParams params = parse_multipart_body(body, boundary);
+    EXPECT_EQ(params.format, "zip");
+    ASSERT_EQ(params.formats.size(), 3);
+
+    ArchiveRequest request = params.toArchiveRequest();
+    EXPECT_EQ(request.formats[0], CompressionFormat::ZIP);
+    EXPECT_EQ(request.formats[1], CompressionFormat::TAR_GZ);
+    EXPECT_EQ(request.formats[2], CompressionFormat::SEVEN_Z);
+
+    body.replace(body.find("7z"), 2, "rar");
+    EXPECT_THROW(parse_multipart_body(body, boundary), std::runtime_error);
+}
+
+TEST_F(RequestParamsTest, ArchiveStemStripsOnlyTheFormatExtension) {
+    EXPECT_EQ(archive_stem("backup.2024.tar.gz"), "backup.2024");
+    EXPECT_EQ(archive_stem("v1.2.zip"), "v1.2");
+    EXPECT_EQ(archive_stem("notes.txt"), "notes.txt");
+    EXPECT_EQ(archive_stem(".zip"), ".zip");
+}
+
+TEST_F(RequestParamsTest, ParseMultipartAutoFormat) {
+    std::string boundary = "----WebKitFormBoundaryAuto";
+    std::string body = createMultipartBody(boundary);
+    body.replace(body.find("\r\nzip\r\n"), 7, "\r\nauto\r\n");
+    body.resize(body.size() - std::string("--" + boundary + "--\r\n").size());
+    body += "--" + boundary + "\r\n";
+    body += "content-disposition: form-data; name=\"objective\"\r\n";
+    body += "\r\n";
+    body += "min_size\r\n";
+    body += "--" + boundary + "--\r\n";
+
+    ArchiveRequestParams params = parse_multipart_body(body, boundary);
+    EXPECT_EQ(params.format, "auto");
+    EXPECT_EQ(params.objective, "min_size");
+
+    body.replace(body.find("min_size"), 8, "smallest");
+    EXPECT_THROW(parse_multipart_body(body, boundary), std::runtime_error);
+}
+
+TEST_F(RequestParamsTest, ParseMultipartCompressionOptions) {
+    std::string boundary = "----WebKitFormBoundaryOptions";
+    std::string body = createMultipartBody(boundary);
+    body.replace(body.find("\r\nzip\r\n"), 7, "\r\ntar.zst\r\n");
+    body.resize(body.size() - std::string("--" + boundary + "--\r\n").size());
+
+    auto field = [&](const std::string& name, const std::string& value) {
+        body += "--" + boundary + "\r\n";
+        body += "content-disposition: form-data; name=\"" + name + "\"\r\n";
+        body += "\r\n";
+        body += value + "\r\n";
+    };
+    field("level", "12");
+    field("threads", "2");
+    field("block_size", "65536");
+    field("solid", "true");
+    field("options", "gnutar:hdrcharset=UTF-8");
+    body += "--" + boundary + "--\r\n";
+
+    ArchiveRequestParams params = parse_multipart_body(body, boundary);
+    EXPECT_EQ(params.options.level, 12);
+    EXPECT_EQ(params.options.threads, 2);
+    EXPECT_EQ(params.options.block_size, 65536);
+    EXPECT_EQ(params.options.solid, true);
+    EXPECT_EQ(params.options.archive_options, "gnutar:hdrcharset=UTF-8");
+
+    ArchiveRequest request = params.toArchiveRequest();
+    EXPECT_EQ(request.options.level, 12);
+
+    params.format = "zip";
+    EXPECT_THROW(params.toArchiveRequest(), std::runtime_error);
+
+    body.replace(body.find("\r\n12\r\n"), 6, "\r\nhigh\r\n");
+    EXPECT_THROW(parse_multipart_body(body, boundary), std::runtime_error);
+}
+
+TEST_F(RequestParamsTest, SharedMultipartPartsMatchCopiedResponse) {
+    std::vector<FileEntry> files = {
+        {"a.zip", std::vector<uint8_t>{'a', 'b', 'c'}},
+        {"a.tar.gz", std::vector<uint8_t>(1000, 7)},
+    };
+    std::vector<SharedPart> shared;
+    for (const auto& file : files) {
+        shared.push_back({file.name, std::make_shared<const std::vector<uint8_t>>(file.data)});
+    }
+
+    auto parts = MultipartParser::createMultipartParts(shared, "XYZ");
+    std::string joined;
+    for (const auto& part : parts) {
+        joined.append(part->begin(), part->end());
+    }
+    EXPECT_EQ(joined, MultipartParser::createMultipartResponse(files, "XYZ"));
+    EXPECT_EQ(parts[1], shared[0].data);
+    EXPECT_EQ(parts[3], shared[1].data);
+}
@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+#include "../src/cache/inflight_table.h"
+#include "../src/cache/result_cache.h"
+#include "../src/memory/memory_budget.h"
+#include "../src/processor/processor.h"
+#include "../src/server/request/request_handler.h"
+#include <filesystem>
+
+class ResultCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        spill_directory = std::filesystem::temp_directory_path() / "archiver_cache_test";
+        std::filesystem::remove_all(spill_directory);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(spill_directory);
+    }
+
+    ResultCache::Config makeConfig(size_t memory_limit, size_t disk_limit) {
+        ResultCache::Config config;
+        config.memory_limit = memory_limit;
+        config.disk_limit = disk_limit;
+        config.spill_directory = spill_directory.string();
+        return config;
+    }
+
+    SharedBuffer makeBuffer(size_t size, uint8_t value) {
+        return std::make_shared<const std::vector<uint8_t>>(size, value);
+    }
+
+    std::filesystem::path spill_directory;
+};
+
+TEST_F(ResultCacheTest, KeyDependsOnFormatNamesAndContent) {
+    ArchiveRequest request;
+    request.format = CompressionFormat::ZIP;
+    request.files.emplace_back("a.txt", std::vector<uint8_t>{'a'});
+    request.files.emplace_back("b.txt", std::vector<uint8_t>{'b'});
+    std::string key = ResultCache::keyFor(request);
+
+    ArchiveRequest renamed = request;
+    renamed.archive_name = "other.zip";
+    EXPECT_EQ(ResultCache::keyFor(renamed), key);
+
+    ArchiveRequest reordered = request;
+    std::swap(reordered.files[0], reordered.files[1]);
+    EXPECT_NE(ResultCache::keyFor(reordered), key);
+
+    ArchiveRequest modified = request;
+    modified.files[0].data = {'c'};
+    EXPECT_NE(ResultCache::keyFor(modified), key);
+
+    ArchiveRequest reformatted = request;
+    reformatted.format = CompressionFormat::TAR_GZ;
+    EXPECT_NE(ResultCache::keyFor(reformatted), key);
+}
+
+TEST_F(ResultCacheTest, ReproducibleKeyIgnoresUploadOrder) {
+    ArchiveRequest request;
+    request.format = CompressionFormat::ZIP;
+    request.reproducible = true;
+    request.files.emplace_back("a.txt", std::vector<uint8_t>{'a'});
+    request.files.emplace_back("b.txt", std::vector<uint8_t>{'b'});
+
+    ArchiveRequest reordered = request;
+    std::swap(reordered.files[0], reordered.files[1]);
+    EXPECT_EQ(ResultCache::keyFor(reordered), ResultCache::keyFor(request));
+}
+
+TEST_F(ResultCacheTest, HitsAndMisses) {
+    ResultCache cache(makeConfig(1024, 0));
+
+    EXPECT_EQ(cache.get("key"), nullptr);
+    cache.put("key", makeBuffer(100, 1));
+
+    auto data = cache.get("key");
+    ASSERT_NE(data, nullptr);
+    EXPECT_EQ(data->size(), 100);
+
+    auto stats = cache.getStats();
+    EXPECT_EQ(stats.memory_hits, 1);
+    EXPECT_EQ(stats.misses, 1);
+    EXPECT_EQ(stats.bytes_saved, 100);
+}
+
+TEST_F(ResultCacheTest, SpillsEvictedEntriesToDisk) {
+    ResultCache cache(makeConfig(150, 1024));
+
+    cache.put("first", makeBuffer(100, 1));
+    cache.put("second", makeBuffer(100, 2));
+
+    auto stats = cache.getStats();
+    EXPECT_EQ(stats.memory_bytes, 100);
+    EXPECT_EQ(stats.disk_bytes, 100);
+
+    auto data = cache.get("first");
+    ASSERT_NE(data, nullptr);
+    EXPECT_EQ((*data)[0], 1);
+    EXPECT_EQ(cache.getStats().disk_hits, 1);
+}
+
+TEST_F(ResultCacheTest, KeepsCompressStatsWithEntries) {
+    ResultCache cache(makeConfig(150, 1024));
+
+    CompressStats stats;
+    stats.entry_order = {2, 0, 1};
+    stats.dedup.entries = 1;
+    stats.sparse.hole_bytes = 4096;
+    cache.put("first", makeBuffer(100, 1), stats);
+    cache.put("second", makeBuffer(100, 2));
+    EXPECT_EQ(cache.statsFor("first").entry_order, stats.entry_order);
+
+    CompressStats cached;
+    ASSERT_NE(cache.get("first", &cached), nullptr);
+    EXPECT_EQ(cache.getStats().disk_hits, 1);
+    EXPECT_EQ(cached.entry_order, stats.entry_order);
+    EXPECT_EQ(cached.dedup.entries, 1);
+    EXPECT_EQ(cached.sparse.hole_bytes, 4096);
+
+    ASSERT_NE(cache.get("first", &cached), nullptr);
+    EXPECT_EQ(cache.getStats().memory_hits, 1);
+    EXPECT_EQ(cached.entry_order, stats.entry_order);
+}
+
+TEST_F(ResultCacheTest, EvictsLeastRecentlyUsedFromDisk) {
+    ResultCache cache(makeConfig(100, 100));
+
+    cache.put("first", makeBuffer(100, 1));
+    cache.put("second", makeBuffer(100, 2));
+    cache.put("third", makeBuffer(100, 3));
+
+    EXPECT_EQ(cache.get("first"), nullptr);
+    EXPECT_NE(cache.get("second"), nullptr);
+    EXPECT_LE(cache.getStats().disk_bytes, 100);
+}
+
+TEST_F(ResultCacheTest, FormatListSharesResultsAndStats) {
+    auto compress = [](const std::string& extra_field) {
+        std::string boundary = "----FormatListCache";
+        std::string body;
+        auto field = [&](const std::string& name, const std::string& value) {
+            body += "--" + boundary + "\r\n";
+            body += "content-disposition: form-data; name=\"" + name + "\"\r\n\r\n";
+            body += value + "\r\n";
+        };
+        field("operation", "compress");
+        field("format", "zip,tar.gz");
+        field("archive_name", "release.v2.zip");
+        if (!extra_field.empty()) {
+            field(extra_field, "true");
+        }
+        body += "--" + boundary + "\r\n";
+        body += "content-disposition: form-data; name=\"file\"; filename=\"list.txt\"\r\n";
+        body += "content-type: text/plain\r\n\r\n";
+        body += "format list cache test\r\n";
+        body += "--" + boundary + "--\r\n";
+
+        HttpRequest req{http::verb::post, "/archive/compress", 11};
+        req.set(http::field::content_type, "multipart/form-data; boundary=" + boundary);
+        req.body() = body;
+        req.prepare_payload();
+        MemoryAccount account;
+        return handle_request(req, account);
+    };
+
+    size_t leaders = InflightTable::instance().getLeaderCount();
+    auto first = compress("");
+    ASSERT_EQ(first.result(), http::status::ok);
+    EXPECT_EQ(first["X-Archive-Cache"], "miss,miss");
+    EXPECT_EQ(InflightTable::instance().getLeaderCount(), leaders + 2);
+
+    auto second = compress("");
+    ASSERT_EQ(second.result(), http::status::ok);
+    EXPECT_EQ(second["X-Archive-Cache"], "hit,hit");
+
+    std::string body;
+    for (size_t i = 0; i < second.body().getBufferCount(); ++i) {
+        auto buffer = second.body().getBuffer(i);
+        body.append(static_cast<const char*>(buffer.data()), buffer.size());
+    }
+    EXPECT_NE(body.find("release.v2.tar.gz"), std::string::npos);
+
+    EXPECT_EQ(compress("adaptive").result(), http::status::bad_request);
+}
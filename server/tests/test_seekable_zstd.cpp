@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include "../src/factory/factory.h"
+#include "../src/memory/memory_budget.h"
+#include "../src/store/archive_store.h"
+#include "../src/zstd/seekable_zstd.h"
+#include <random>
+#include <zstd.h>
+
+class SeekableZstdTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::mt19937 gen(7);
+        std::uniform_int_distribution<> dis('a', 'p');
+        content.resize(300000);
+        for (auto& byte : content) {
+            byte = dis(gen);
+        }
+    }
+
+    std::vector<uint8_t> content;
+};
+
+TEST_F(SeekableZstdTest, WritesStandardSeekTable) {
+    auto compressed = SeekableZstd::compress(content, 64 * 1024);
+
+    ASSERT_TRUE(SeekableZstd::hasSeekTable(compressed.data(), compressed.size()));
+    SeekableZstd seekable(compressed.data(), compressed.size());
+    EXPECT_EQ(seekable.getFrames().size(), 5);
+    EXPECT_EQ(seekable.getDecompressedSize(), content.size());
+    EXPECT_EQ(seekable.decompress(), content);
+
+    std::vector<uint8_t> plain(content.size());
+    size_t decoded = ZSTD_decompress(plain.data(), plain.size(), compressed.data(), compressed.size());
+    ASSERT_FALSE(ZSTD_isError(decoded));
+    EXPECT_EQ(plain, content);
+}
+
+TEST_F(SeekableZstdTest, WriterStreamsInputInPieces) {
+    SeekableZstd::Writer writer(64 * 1024);
+    for (size_t offset = 0; offset < content.size(); offset += 1000) {
+        size_t length = std::min<size_t>(1000, content.size() - offset);
+        writer.write(content.data() + offset, length);
+    }
+    auto compressed = writer.finish();
+
+    SeekableZstd seekable(compressed.data(), compressed.size());
+    EXPECT_EQ(seekable.getFrames().size(), 5);
+    EXPECT_EQ(seekable.decompress(), content);
+    EXPECT_EQ(seekable.read(65000, 2000),
+              std::vector<uint8_t>(content.begin() + 65000, content.begin() + 67000));
+
+    auto empty = SeekableZstd::Writer(64 * 1024).finish();
+    EXPECT_EQ(SeekableZstd(empty.data(), empty.size()).getFrames().size(), 0);
+}
+
+TEST_F(SeekableZstdTest, ReadsRangesAcrossFrames) {
+    auto compressed = SeekableZstd::compress(content, 64 * 1024);
+    SeekableZstd seekable(compressed.data(), compressed.size());
+
+    for (uint64_t offset : {0ULL, 65530ULL, 200000ULL}) {
+        auto data = seekable.read(offset, 70000);
+        EXPECT_TRUE(std::equal(data.begin(), data.end(), content.begin() + offset)) << offset;
+    }
+    EXPECT_THROW(seekable.read(content.size() - 10, 11), std::runtime_error);
+    EXPECT_THROW(SeekableZstd::compress(content, 100), std::runtime_error);
+}
+
+TEST_F(SeekableZstdTest, ChecksFrameSizesBeforeAllocating) {
+    auto compressed = SeekableZstd::compress(content, 64 * 1024);
+    MemoryBudget budget(1 << 30, 1 << 30, std::chrono::milliseconds(10));
+
+    {
+        SeekableZstd seekable(compressed.data(), compressed.size());
+        MemoryAccount whole(budget);
+        EXPECT_EQ(seekable.read(64 * 1024, 128 * 1024, &whole).size(), 128 * 1024);
+        EXPECT_EQ(whole.getReserved(), 0);
+
+        MemoryAccount part(budget);
+        seekable.read(10, 100, &part);
+        EXPECT_EQ(part.getReserved(), 64 * 1024);
+    }
+
+    // The first seek table entry claims a 4 GiB frame.
+    size_t table = compressed.size() - (5 * 12 + 9);
+    for (size_t i = 0; i < 4; ++i) {
+        compressed[table + 4 + i] = 0xff;
+    }
+    EXPECT_THROW(SeekableZstd(compressed.data(), compressed.size()), std::runtime_error);
+}
+
+TEST_F(SeekableZstdTest, TarZstRoundTrip) {
+    std::vector<FileEntry> files = {
+        {"first.txt", std::vector<uint8_t>(content.begin(), content.begin() + 150000)},
+        {"second.txt", std::vector<uint8_t>(content.begin() + 150000, content.end())},
+    };
+
+    auto compressor = CompressorFactory::createCompressor(CompressionFormat::TAR_ZST);
+    compressor->setFrameSize(32 * 1024);
+    auto archive = compressor->compress(files);
+    EXPECT_EQ(CompressorFactory::detectFormatFromData(archive), CompressionFormat::TAR_ZST);
+
+    auto extracted = CompressorFactory::createCompressor(CompressionFormat::TAR_ZST)->extract(archive);
+    ASSERT_EQ(extracted.size(), 2);
+    EXPECT_EQ(extracted[1].data, files[1].data);
+
+    StoredArchive stored("id", std::make_shared<const std::vector<uint8_t>>(archive));
+    EXPECT_GT(stored.getAccessPointCount(), 8);
+    const ArchiveEntryInfo* entry = stored.find("second.txt");
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(stored.readEntry(*entry), files[1].data);
+
+    auto zip = CompressorFactory::createCompressor(CompressionFormat::ZIP)->compress(files);
+    compressor = CompressorFactory::createCompressor(CompressionFormat::TAR_ZST);
+    compressor->setFrameSize(32 * 1024);
+    auto converted = compressor->convert(zip);
+    StoredArchive streamed("converted", std::make_shared<const std::vector<uint8_t>>(converted));
+    EXPECT_GT(streamed.getAccessPointCount(), 8);
+    entry = streamed.find("second.txt");
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(streamed.readEntry(*entry), files[1].data);
+}
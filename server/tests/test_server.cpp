@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include "../src/server/server.h"
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <thread>
+
+class ServerTest : public ::testing::Test {
+protected:
+    int freePort() {
+        boost::asio::io_context service;
+        ip::tcp::acceptor probe(service, ip::tcp::endpoint(ip::address_v4::loopback(), 0));
+        return probe.local_endpoint().port();
+    }
+
+    bool connect(ip::tcp::socket& client, int port) {
+        boost::system::error_code ec;
+        client.connect(ip::tcp::endpoint(ip::address_v4::loopback(), port), ec);
+        return !ec;
+    }
+
+    std::string get(boost::asio::io_context& service, int port, const std::string& target) {
+        ip::tcp::socket client(service);
+        if (!connect(client, port)) {
+            return "";
+        }
+        std::string request = "GET " + target + " HTTP/1.1\r\nConnection: close\r\n\r\n";
+        boost::asio::write(client, boost::asio::buffer(request));
+
+        std::string response;
+        boost::system::error_code ec;
+        char chunk[4096];
+        size_t read;
+        while ((read = client.read_some(boost::asio::buffer(chunk), ec)) > 0) {
+            response.append(chunk, read);
+        }
+        return response;
+    }
+};
+
+TEST_F(ServerTest, PerCoreModeServesOnEveryAcceptor) {
+    ServerConfig config;
+    config.port = freePort();
+    config.mode = ServerMode::PER_CORE;
+    config.thread_count = 4;
+    std::thread server([&config]() { start_server(config); });
+
+    boost::asio::io_context service;
+    for (int attempt = 0; attempt < 500; ++attempt) {
+        ip::tcp::socket probe(service);
+        if (connect(probe, config.port)) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    for (int i = 0; i < 64; ++i) {
+        EXPECT_EQ(get(service, config.port, "/formats").rfind("HTTP/1.1 200 OK", 0), 0u);
+    }
+
+    stop_server();
+    server.join();
+
+    auto accepted = accepted_connections();
+    ASSERT_EQ(accepted.size(), 4u);
+    EXPECT_GE(std::accumulate(accepted.begin(), accepted.end(), size_t(0)), 64u);
+    // SO_REUSEPORT spreads connections by their address hash, so several
+    // acceptors share the load.
+    EXPECT_GT(std::count_if(accepted.begin(), accepted.end(), [](size_t count) { return count > 0; }),
+              1);
+}
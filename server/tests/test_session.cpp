@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include "../src/server/session.h"
+#include <thread>
+
+class SessionTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        acceptor = std::make_unique<ip::tcp::acceptor>(
+            service, ip::tcp::endpoint(ip::address_v4::loopback(), 0));
+    }
+
+    void TearDown() override {
+        service.stop();
+        if (server_thread.joinable()) {
+            server_thread.join();
+        }
+    }
+
+    void startServer(Session::Handler handler, size_t offload_threshold = 64 * 1024,
+                     Session::Timeouts timeouts = {}) {
+        acceptor->async_accept([this, handler, offload_threshold, timeouts](
+                                   boost::system::error_code ec, ip::tcp::socket socket) {
+            ASSERT_FALSE(ec);
+            session = std::make_shared<Session>(std::move(socket), handler);
+            session->setOffloadThreshold(offload_threshold);
+            session->setTimeouts(timeouts);
+            session->start();
+        });
+        server_thread = std::thread([this]() {
+            auto work = boost::asio::make_work_guard(service);
+            service.run();
+        });
+    }
+
+    std::string roundTrip(ip::tcp::socket& client, const std::string& request, size_t response_size) {
+        boost::asio::write(client, boost::asio::buffer(request));
+        std::string response(response_size, '\0');
+        boost::asio::read(client, boost::asio::buffer(response));
+        return response;
+    }
+
+    boost::asio::io_context service;
+    std::unique_ptr<ip::tcp::acceptor> acceptor;
+    std::shared_ptr<Session> session;
+    std::thread server_thread;
+};
+
+TEST_F(SessionTest, ServesKeepAliveRequests) {
+    startServer([](const Session::Request& req, MemoryAccount&,
+                   Session::Response& resp) -> boost::asio::awaitable<void> {
+        resp = {};
+        resp.result(http::status::ok);
+        resp.body() = std::string(req.target());
+        resp.prepare_payload();
+        co_return;
+    });
+
+    ip::tcp::socket client(service);
+    client.connect(acceptor->local_endpoint());
+
+    const std::string expected_first = "HTTP/1.1 200 OK\r\nContent-Length: 4\r\n\r\n/one";
+    const std::string expected_second = "HTTP/1.1 200 OK\r\nContent-Length: 4\r\n\r\n/two";
+
+    EXPECT_EQ(roundTrip(client, "GET /one HTTP/1.1\r\n\r\n", expected_first.size()), expected_first);
+    EXPECT_EQ(roundTrip(client, "GET /two HTTP/1.1\r\n\r\n", expected_second.size()), expected_second);
+}
+
+TEST_F(SessionTest, WritesSharedPartsInOrder) {
+    startServer([](const Session::Request&, MemoryAccount&,
+                   Session::Response& resp) -> boost::asio::awaitable<void> {
+        auto part = [](const std::string& text) {
+            return std::make_shared<const std::vector<uint8_t>>(text.begin(), text.end());
+        };
+        resp = {};
+        resp.result(http::status::ok);
+        resp.body().share(std::vector<SharedBuffer>{part("ab"), part(""), part("cde")});
+        resp.prepare_payload();
+        co_return;
+    });
+
+    ip::tcp::socket client(service);
+    client.connect(acceptor->local_endpoint());
+
+    const std::string expected = "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nabcde";
+    EXPECT_EQ(roundTrip(client, "GET / HTTP/1.1\r\n\r\n", expected.size()), expected);
+}
+
+TEST_F(SessionTest, KeepsPipelinedRequests) {
+    startServer([](const Session::Request& req, MemoryAccount&,
+                   Session::Response& resp) -> boost::asio::awaitable<void> {
+        resp = {};
+        resp.result(http::status::ok);
+        resp.body() = std::string(req.target());
+        resp.prepare_payload();
+        co_return;
+    });
+
+    ip::tcp::socket client(service);
+    client.connect(acceptor->local_endpoint());
+
+    const std::string expected =
+        "HTTP/1.1 200 OK\r\nContent-Length: 4\r\n\r\n/one"
+        "HTTP/1.1 200 OK\r\nContent-Length: 4\r\n\r\n/two";
+    EXPECT_EQ(roundTrip(client, "GET /one HTTP/1.1\r\n\r\nGET /two HTTP/1.1\r\n\r\n", expected.size()),
+              expected);
+}
+
+TEST_F(SessionTest, OffloadsLargeBodiesToCpuPool) {
+    std::thread::id handler_thread;
+    startServer(
+        [&handler_thread](const Session::Request& req, MemoryAccount&,
+                          Session::Response& resp) -> boost::asio::awaitable<void> {
+            handler_thread = std::this_thread::get_id();
+            resp = {};
+            resp.result(http::status::ok);
+            resp.body() = std::to_string(req.body().size());
+            resp.prepare_payload();
+            co_return;
+        },
+        16);
+
+    ip::tcp::socket client(service);
+    client.connect(acceptor->local_endpoint());
+
+    const std::string expected = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\n32";
+    std::string request = "POST /big HTTP/1.1\r\nContent-Length: 32\r\n\r\n" + std::string(32, 'x');
+    EXPECT_EQ(roundTrip(client, request, expected.size()), expected);
+    EXPECT_NE(handler_thread, server_thread.get_id());
+    EXPECT_EQ(roundTrip(client, request, expected.size()), expected);
+}
+
+TEST_F(SessionTest, ClosesConnectionsThatMissTheHeaderDeadline) {
+    Session::Timeouts timeouts;
+    timeouts.header = std::chrono::seconds(1);
+    startServer(
+        [](const Session::Request&, MemoryAccount&,
+           Session::Response& resp) -> boost::asio::awaitable<void> {
+            resp = {};
+            resp.result(http::status::ok);
+            resp.prepare_payload();
+            co_return;
+        },
+        64 * 1024, timeouts);
+
+    ip::tcp::socket client(service);
+    client.connect(acceptor->local_endpoint());
+
+    const std::string expected = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+    EXPECT_EQ(roundTrip(client, "GET / HTTP/1.1\r\n\r\n", expected.size()), expected);
+
+    auto started = std::chrono::steady_clock::now();
+    boost::asio::write(client, boost::asio::buffer(std::string("GET / HTTP/1.1\r\n")));
+    char byte;
+    boost::system::error_code ec;
+    client.read_some(boost::asio::buffer(&byte, 1), ec);
+    EXPECT_EQ(ec, boost::asio::error::eof);
+    EXPECT_LT(std::chrono::steady_clock::now() - started, std::chrono::seconds(3));
+}
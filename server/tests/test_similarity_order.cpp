@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include "../src/order/similarity_order.h"
+#include "../src/factory/factory.h"
+#include "../src/processor/processor.h"
+#include <random>
+
+class SimilarityOrderTest : public ::testing::Test {
+protected:
+    std::vector<uint8_t> randomBlock(uint32_t seed, size_t size) {
+        std::mt19937 gen(seed);
+        std::vector<uint8_t> data(size);
+        for (auto& byte : data) {
+            byte = gen() & 0xff;
+        }
+        return data;
+    }
+
+    std::vector<uint8_t> variant(std::vector<uint8_t> data, uint32_t seed) {
+        std::mt19937 gen(seed);
+        for (int i = 0; i < 16; ++i) {
+            data[gen() % data.size()] ^= 0xff;
+        }
+        return data;
+    }
+
+    std::vector<const FileEntry*> pointers(const std::vector<FileEntry>& files) {
+        std::vector<const FileEntry*> result;
+        for (const auto& file : files) {
+            result.push_back(&file);
+        }
+        return result;
+    }
+};
+
+TEST_F(SimilarityOrderTest, SignaturesTrackSimilarity) {
+    auto base = randomBlock(1, 32 * 1024);
+    auto close = variant(base, 2);
+    auto other = randomBlock(3, 32 * 1024);
+
+    auto signature = SimilarityOrder::signature(base);
+    EXPECT_DOUBLE_EQ(SimilarityOrder::similarity(signature, signature), 1.0);
+    EXPECT_GT(SimilarityOrder::similarity(signature, SimilarityOrder::signature(close)), 0.7);
+    EXPECT_LT(SimilarityOrder::similarity(signature, SimilarityOrder::signature(other)), 0.2);
+    EXPECT_NO_THROW(SimilarityOrder::signature({}));
+}
+
+TEST_F(SimilarityOrderTest, GroupsByExtensionThenContent) {
+    auto a = randomBlock(10, 16 * 1024);
+    auto b = randomBlock(20, 16 * 1024);
+    std::vector<FileEntry> files = {{"a1.log", a},
+                                    {"b1.log", b},
+                                    {"x.csv", randomBlock(30, 1024)},
+                                    {"a2.log", variant(a, 1)},
+                                    {"b2.log", variant(b, 2)},
+                                    {"a3.log", variant(a, 3)}};
+
+    auto order = SimilarityOrder::order(pointers(files));
+    EXPECT_EQ(order, (std::vector<size_t>{0, 3, 5, 1, 4, 2}));
+}
+
+TEST_F(SimilarityOrderTest, ReorderingImprovesSolidRatio) {
+    std::vector<FileEntry> files;
+    std::vector<std::vector<uint8_t>> bases;
+    for (uint32_t i = 0; i < 4; ++i) {
+        bases.push_back(randomBlock(100 + i, 12 * 1024));
+    }
+    for (uint32_t copy = 0; copy < 3; ++copy) {
+        for (uint32_t i = 0; i < 4; ++i) {
+            files.emplace_back("file" + std::to_string(copy) + "_" + std::to_string(i) + ".bin",
+                               variant(bases[i], copy * 10 + i));
+        }
+    }
+
+    ArchiveRequest request;
+    request.operation = ArchiveOperation::COMPRESS;
+    request.format = CompressionFormat::TAR_GZ;
+    request.archive_name = "similar.tar.gz";
+    request.files = files;
+
+    auto compress = [&request]() {
+        auto compressor = CompressorFactory::createCompressor(request.format);
+        ArchiveProcessor processor(request, compressor);
+        processor.process();
+        return processor.getArchiveData();
+    };
+    auto upload = compress();
+    request.order_by_similarity = true;
+    auto similar = compress();
+    EXPECT_LT(similar.size(), upload.size() * 3 / 4);
+
+    auto order = ArchiveProcessor::entryOrder(request);
+    ASSERT_EQ(order.size(), files.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        EXPECT_EQ(order[i] % 4, order[i / 3 * 3] % 4);
+    }
+
+    auto extracted = CompressorFactory::createCompressor(request.format)->extract(similar);
+    ASSERT_EQ(extracted.size(), files.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        EXPECT_EQ(extracted[i].name, files[order[i]].name);
+    }
+}
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include "../src/planner/size_estimator.h"
+#include "../src/factory/factory.h"
+#include "../src/memory/memory_budget.h"
+#include "../src/server/request/request_handler.h"
+#include <random>
+
+class SizeEstimatorTest : public ::testing::Test {
+protected:
+    std::vector<FileEntry> mixedFiles() {
+        std::mt19937 gen(11);
+        std::vector<FileEntry> files;
+        for (int i = 0; i < 4; ++i) {
+            std::string text;
+            while (text.size() < 256 * 1024) {
+                text += "line " + std::to_string(gen() % 1000) + " of a server log\n";
+            }
+            files.emplace_back("logs/app" + std::to_string(i) + ".log",
+                               std::vector<uint8_t>(text.begin(), text.end()));
+        }
+        std::vector<uint8_t> noise(512 * 1024);
+        for (auto& byte : noise) {
+            byte = gen() & 0xff;
+        }
+        files.emplace_back("media/photo.JPG", noise);
+        return files;
+    }
+};
+
+TEST_F(SizeEstimatorTest, RejectsInvalidFraction) {
+    SizeEstimator::Config config;
+    config.fraction = 0.0;
+    EXPECT_THROW(SizeEstimator{config}, std::runtime_error);
+    config.fraction = 1.5;
+    EXPECT_THROW(SizeEstimator{config}, std::runtime_error);
+}
+
+TEST_F(SizeEstimatorTest, RouteRejectsInvalidFractionAsBadRequest) {
+    auto estimate = [](const std::string& fraction) {
+        std::string boundary = "----EstimateFraction";
+        std::string body;
+        body += "--" + boundary + "\r\n";
+        body += "content-disposition: form-data; name=\"fraction\"\r\n\r\n";
+        body += fraction + "\r\n";
+        body += "--" + boundary + "\r\n";
+        body += "content-disposition: form-data; name=\"file\"; filename=\"a.txt\"\r\n";
+        body += "content-type: text/plain\r\n\r\n";
+        body += "estimate me\r\n";
+        body += "--" + boundary + "--\r\n";
+
+        HttpRequest req{http::verb::post, "/archive/estimate", 11};
+        req.set(http::field::content_type, "multipart/form-data; boundary=" + boundary);
+        req.body() = body;
+        req.prepare_payload();
+        MemoryAccount account;
+        return handle_request(req, account).result();
+    };
+
+    EXPECT_EQ(estimate("1"), http::status::ok);
+    EXPECT_EQ(estimate("abc"), http::status::bad_request);
+    EXPECT_EQ(estimate("0.5x"), http::status::bad_request);
+    EXPECT_EQ(estimate("0"), http::status::bad_request);
+    EXPECT_EQ(estimate("1.5"), http::status::bad_request);
+    EXPECT_EQ(estimate("nan"), http::status::bad_request);
+}
+
+TEST_F(SizeEstimatorTest, EstimatesEverySupportedFormat) {
+    auto files = mixedFiles();
+    SizeEstimator::Config config;
+    config.fraction = 0.1;
+    EstimateReport report = SizeEstimator(config).estimate(files);
+
+    EXPECT_EQ(report.strata, 2);
+    uint64_t total = 0;
+    for (const auto& file : files) {
+        total += file.data.size();
+    }
+    EXPECT_EQ(report.input_bytes, total);
+    EXPECT_LT(report.sampled_bytes, report.input_bytes / 2);
+    ASSERT_EQ(report.formats.size(), CompressorFactory::getSupportedFormats().size());
+
+    for (const auto& estimate : report.formats) {
+        SCOPED_TRACE(CompressorFactory::formatToString(estimate.format));
+        ASSERT_TRUE(estimate.error.empty()) << estimate.error;
+        EXPECT_LE(estimate.size.low, estimate.size.estimate);
+        EXPECT_GE(estimate.size.high, estimate.size.estimate);
+        EXPECT_GT(estimate.compress_seconds.estimate, 0.0);
+        EXPECT_GT(estimate.extract_seconds.estimate, 0.0);
+
+        auto actual = CompressorFactory::createCompressor(estimate.format)->compress(files);
+        double error = std::abs(estimate.size.estimate - static_cast<double>(actual.size()));
+        EXPECT_LT(error / actual.size(), 0.25);
+    }
+}
+
+TEST_F(SizeEstimatorTest, FullSampleHasNoUncertainty) {
+    std::vector<FileEntry> files = {{"a.txt", std::vector<uint8_t>(8 * 1024, 'a')}};
+    SizeEstimator::Config config;
+    config.fraction = 1.0;
+    EstimateReport report = SizeEstimator(config).estimate(files);
+
+    EXPECT_EQ(report.sampled_bytes, report.input_bytes);
+    for (const auto& estimate : report.formats) {
+        EXPECT_DOUBLE_EQ(estimate.size.low, estimate.size.estimate);
+        EXPECT_DOUBLE_EQ(estimate.size.high, estimate.size.estimate);
+    }
+}
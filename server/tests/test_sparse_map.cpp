@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include "../src/sparse/sparse_map.h"
+#include "../src/factory/factory.h"
+#include <random>
+
+class SparseMapTest : public ::testing::Test {
+protected:
+    // Random data at the given offsets, zeros everywhere else.
+    std::vector<uint8_t> image(size_t size, const std::vector<SparseRegion>& extents) {
+        std::mt19937 gen(11);
+        std::vector<uint8_t> data(size, 0);
+        for (const auto& extent : extents) {
+            for (uint64_t i = 0; i < extent.length; ++i) {
+                data[extent.offset + i] = gen() & 0xff;
+            }
+        }
+        return data;
+    }
+};
+
+TEST_F(SparseMapTest, DetectsZeroWords) {
+    std::vector<uint8_t> data(1000, 0);
+    EXPECT_TRUE(SparseMap::isZero(data.data(), data.size()));
+    data[999] = 1;
+    EXPECT_FALSE(SparseMap::isZero(data.data(), data.size()));
+    EXPECT_TRUE(SparseMap::isZero(data.data(), 999));
+    EXPECT_TRUE(SparseMap::isZero(data.data(), 0));
+}
+
+TEST_F(SparseMapTest, MapsDataAroundHoles) {
+    const size_t mib = 1024 * 1024;
+    auto data = image(4 * mib, {{0, 100}, {2 * mib + 10, 5000}});
+
+    auto regions = SparseMap::scan(data.data(), data.size());
+    std::vector<SparseRegion> expected = {{0, 4096}, {2 * mib, 8192}};
+    EXPECT_EQ(regions, expected);
+    EXPECT_EQ(SparseMap::dataBytes(regions), 12288u);
+}
+
+TEST_F(SparseMapTest, IgnoresShortZeroRuns) {
+    auto data = image(128 * 1024, {{0, 4096}, {64 * 1024, 4096}});
+    EXPECT_TRUE(SparseMap::scan(data.data(), data.size()).empty());
+
+    std::vector<uint8_t> zeros(1024 * 1024, 0);
+    auto regions = SparseMap::scan(zeros.data(), zeros.size());
+    EXPECT_EQ(regions, (std::vector<SparseRegion>{{zeros.size(), 0}}));
+    EXPECT_TRUE(SparseMap::scan(nullptr, 0).empty());
+}
+
+TEST_F(SparseMapTest, TarFormatsStoreHoles) {
+    const size_t mib = 1024 * 1024;
+    std::vector<FileEntry> files = {
+        {"disk.img", image(8 * mib, {{0, 8192}, {5 * mib, 4096}})},
+        {"zeros.bin", std::vector<uint8_t>(mib, 0)},
+        {"notes.txt", std::vector<uint8_t>(100, 'n')}};
+
+    auto stats = LibArchiveCompressor::measureSparse(files);
+    EXPECT_EQ(stats.entries, 2u);
+    EXPECT_EQ(stats.hole_bytes, 8 * mib - 12288 + mib);
+
+    for (auto format : {CompressionFormat::TAR_GZ, CompressionFormat::TAR_BZ2,
+                        CompressionFormat::TAR_ZST, CompressionFormat::TAR_XZ}) {
+        auto compressor = CompressorFactory::createCompressor(format);
+        auto archive = compressor->compress(files);
+        EXPECT_LT(archive.size(), 64u * 1024) << static_cast<int>(format);
+
+        auto extracted = compressor->extract(archive);
+        ASSERT_EQ(extracted.size(), files.size());
+        for (size_t i = 0; i < files.size(); ++i) {
+            EXPECT_EQ(extracted[i].name, files[i].name);
+            EXPECT_EQ(extracted[i].data, files[i].data);
+        }
+    }
+}
+
+TEST_F(SparseMapTest, ZipKeepsZeroRuns) {
+    EXPECT_FALSE(LibArchiveCompressor::supportsSparse(CompressionFormat::ZIP));
+    EXPECT_FALSE(LibArchiveCompressor::supportsSparse(CompressionFormat::SEVEN_Z));
+
+    std::vector<FileEntry> files = {{"zeros.bin", std::vector<uint8_t>(1024 * 1024, 0)}};
+    auto compressor = CompressorFactory::createCompressor(CompressionFormat::ZIP);
+    auto extracted = compressor->extract(compressor->compress(files));
+    ASSERT_EQ(extracted.size(), 1u);
+    EXPECT_EQ(extracted[0].data, files[0].data);
+}
@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+#include "../src/xz/xz_writer.h"
+#include "../src/compressor/compressor.h"
+#include <lzma.h>
+#include <random>
+
+class XzWriterTest : public ::testing::Test {
+protected:
+    std::vector<uint8_t> elfBinary() {
+        std::mt19937 gen(7);
+        std::vector<uint8_t> data(96 * 1024);
+        for (size_t i = 0; i < data.size(); ++i) {
+            // Near calls to a handful of targets, like real x86 code.
+            data[i] = i % 5 == 0 ? 0xE8 : static_cast<uint8_t>(gen() % 16);
+        }
+        const uint8_t header[] = {0x7f, 'E', 'L', 'F', 2, 1, 1, 0};
+        std::copy(std::begin(header), std::end(header), data.begin());
+        data[18] = 62;
+        data[19] = 0;
+        return data;
+    }
+
+    std::vector<uint8_t> counterTable() {
+        std::vector<uint8_t> data;
+        for (uint32_t i = 0; i < 64 * 1024; ++i) {
+            uint32_t value = 1000000 + i * 3;
+            for (int b = 0; b < 4; ++b) {
+                data.push_back((value >> (8 * b)) & 0xff);
+            }
+        }
+        return data;
+    }
+
+    std::vector<uint8_t> text() {
+        std::string line = "xz blocks carry their own filter chains\n";
+        std::vector<uint8_t> data;
+        while (data.size() < 64 * 1024) {
+            data.insert(data.end(), line.begin(), line.end());
+        }
+        return data;
+    }
+};
+
+TEST_F(XzWriterTest, DetectsPrefilters) {
+    auto elf = elfBinary();
+    EXPECT_EQ(XzWriter::detect(elf.data(), elf.size()).kind, Prefilter::X86);
+
+    auto table = counterTable();
+    PrefilterChoice delta = XzWriter::detect(table.data(), table.size());
+    EXPECT_EQ(delta.kind, Prefilter::DELTA);
+    EXPECT_EQ(delta.distance, 4);
+    EXPECT_EQ(XzWriter::describe(delta), "delta:4");
+
+    auto plain = text();
+    EXPECT_EQ(XzWriter::detect(plain.data(), plain.size()).kind, Prefilter::NONE);
+
+    std::mt19937 gen(1);
+    std::vector<uint8_t> noise(64 * 1024);
+    for (auto& byte : noise) {
+        byte = gen() & 0xff;
+    }
+    EXPECT_EQ(XzWriter::detect(noise.data(), noise.size()).kind, Prefilter::NONE);
+}
+
+TEST_F(XzWriterTest, GroupsEntriesIntoFilteredBlocks) {
+    std::vector<FileEntry> files = {{"a.txt", text()},
+                                    {"bin/tool", elfBinary()},
+                                    {"b.txt", text()},
+                                    {"table.bin", counterTable()},
+                                    {"lib/tool.so", elfBinary()}};
+
+    LibArchiveCompressor compressor(CompressionFormat::TAR_XZ);
+    auto archive = compressor.compress(files);
+    ASSERT_GE(archive.size(), 6);
+    EXPECT_EQ(archive[0], 0xFD);
+
+    auto extracted = LibArchiveCompressor(CompressionFormat::TAR_XZ).extract(archive);
+    ASSERT_EQ(extracted.size(), files.size());
+    std::vector<std::string> names;
+    for (const auto& file : extracted) {
+        names.push_back(file.name);
+        auto original = std::find_if(files.begin(), files.end(),
+                                     [&](const FileEntry& entry) { return entry.name == file.name; });
+        ASSERT_NE(original, files.end());
+        EXPECT_EQ(file.data, original->data);
+    }
+    EXPECT_EQ(names, (std::vector<std::string>{"a.txt", "b.txt", "bin/tool", "lib/tool.so",
+                                               "table.bin"}));
+}
+
+TEST_F(XzWriterTest, StreamStartsBlockWhenFilterChanges) {
+    auto plain = text();
+    auto elf = elfBinary();
+    std::vector<uint8_t> expected;
+
+    XzWriter::Stream stream;
+    auto write = [&](const std::vector<uint8_t>& data) {
+        for (size_t offset = 0; offset < data.size(); offset += 4000) {
+            size_t length = std::min<size_t>(4000, data.size() - offset);
+            stream.write(data.data() + offset, length);
+        }
+        expected.insert(expected.end(), data.begin(), data.end());
+    };
+    write(plain);
+    stream.setFilter({Prefilter::X86, 0});
+    write(elf);
+    stream.setFilter({Prefilter::X86, 0});
+    write(elf);
+    stream.setFilter({Prefilter::DELTA, 4});
+    write(counterTable());
+    auto archive = stream.finish();
+
+    lzma_stream_flags footer;
+    ASSERT_EQ(lzma_stream_footer_decode(&footer, archive.data() + archive.size() - 12), LZMA_OK);
+    uint64_t memory_limit = UINT64_MAX;
+    size_t in_position = archive.size() - 12 - footer.backward_size;
+    lzma_index* index = nullptr;
+    ASSERT_EQ(lzma_index_buffer_decode(&index, &memory_limit, nullptr, archive.data(),
+                                       &in_position, archive.size() - 12),
+              LZMA_OK);
+    EXPECT_EQ(lzma_index_block_count(index), 3);
+    lzma_index_end(index, nullptr);
+
+    std::vector<uint8_t> decoded(expected.size());
+    size_t out_position = 0;
+    in_position = 0;
+    memory_limit = UINT64_MAX;
+    ASSERT_EQ(lzma_stream_buffer_decode(&memory_limit, 0, nullptr, archive.data(), &in_position,
+                                        archive.size(), decoded.data(), &out_position,
+                                        decoded.size()),
+              LZMA_OK);
+    EXPECT_EQ(out_position, expected.size());
+    EXPECT_EQ(decoded, expected);
+
+    std::vector<FileEntry> files = {{"a.txt", plain}, {"bin/tool", elf}};
+    auto zip = LibArchiveCompressor(CompressionFormat::ZIP).compress(files);
+    auto converted = LibArchiveCompressor(CompressionFormat::TAR_XZ).convert(zip);
+    EXPECT_EQ(converted[0], 0xFD);
+    auto extracted = LibArchiveCompressor(CompressionFormat::TAR_XZ).extract(converted);
+    ASSERT_EQ(extracted.size(), files.size());
+    EXPECT_EQ(extracted[1].data, elf);
+}
+
+TEST_F(XzWriterTest, DeltaImprovesTableRatio) {
+    std::vector<FileEntry> files = {{"table.bin", counterTable()}};
+    auto filtered = LibArchiveCompressor(CompressionFormat::TAR_XZ).compress(files);
+    auto plain = LibArchiveCompressor(CompressionFormat::SEVEN_Z).compress(files);
+    EXPECT_LT(filtered.size(), plain.size());
+
+    std::vector<XzBlock> blocks;
+    XzWriter::compress(std::vector<uint8_t>(10240, 0), 6, &blocks);
+    ASSERT_EQ(blocks.size(), 1);
+    EXPECT_EQ(blocks[0].filter.kind, Prefilter::NONE);
+    EXPECT_EQ(blocks[0].size, 10240);
+}